@@ -0,0 +1,413 @@
+#pragma once
+
+// src/ 与 template/ 共用的基准测试框架，需要保持 c++11 可编译。
+// 输出为 csv，每行一个 (实现, 负载, 规模, 操作) 的测量结果：
+//   impl,workload,n,op,ops,ns_per_op,mops,p50_ns,p99_ns,peak_rss_kb
+// 用法：bench [--sizes=1000,1000000]
+//             [--workloads=seq,random,zipf,mixed,scan,append,batch,destroy]
+//             [--impls=a,b]
+//             [--suites=a,b] [--read-ratio=0.9] [--seed=42]
+//             [--threads=1,2,4]
+// 通用负载之外的测试组（suite）由各个 bench 自行定义，workload 列可自定义含义。
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+struct Options {
+  std::vector<size_t> sizes;
+  std::vector<std::string> workloads;
+  std::vector<std::string> impls;   // 为空表示全部
+  std::vector<std::string> suites;  // 为空表示全部
+  std::vector<unsigned> threads;    // 多线程测试的线程数，默认 1,2,4... 直到核数
+  double read_ratio = 0.9;
+  uint64_t seed = 42;
+
+  bool has_impl(const std::string& impl) const {
+    return impls.empty() ||
+           std::find(impls.begin(), impls.end(), impl) != impls.end();
+  }
+  bool has_suite(const std::string& suite) const {
+    return suites.empty() ||
+           std::find(suites.begin(), suites.end(), suite) != suites.end();
+  }
+};
+
+inline std::vector<std::string> split_list(const char* s) {
+  std::vector<std::string> items;
+  std::string cur;
+  for (; *s != '\0'; ++s) {
+    if (*s == ',') {
+      if (!cur.empty()) items.push_back(cur);
+      cur.clear();
+    } else {
+      cur.push_back(*s);
+    }
+  }
+  if (!cur.empty()) items.push_back(cur);
+  return items;
+}
+
+inline Options parse_options(int argc, char** argv) {
+  Options opt;
+  opt.sizes = {1000, 10000, 100000, 1000000};
+  opt.workloads = {"seq",    "random", "zipf",  "mixed",
+                   "scan",   "append", "batch", "destroy"};
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strncmp(arg, "--sizes=", 8) == 0) {
+      opt.sizes.clear();
+      for (auto& item : split_list(arg + 8)) {
+        opt.sizes.push_back(static_cast<size_t>(strtod(item.c_str(), nullptr)));
+      }
+    } else if (strncmp(arg, "--workloads=", 12) == 0) {
+      opt.workloads = split_list(arg + 12);
+    } else if (strncmp(arg, "--impls=", 8) == 0) {
+      opt.impls = split_list(arg + 8);
+    } else if (strncmp(arg, "--suites=", 9) == 0) {
+      opt.suites = split_list(arg + 9);
+    } else if (strncmp(arg, "--threads=", 10) == 0) {
+      for (auto& item : split_list(arg + 10)) {
+        opt.threads.push_back(static_cast<unsigned>(atoi(item.c_str())));
+      }
+    } else if (strncmp(arg, "--read-ratio=", 13) == 0) {
+      opt.read_ratio = strtod(arg + 13, nullptr);
+    } else if (strncmp(arg, "--seed=", 7) == 0) {
+      opt.seed = strtoull(arg + 7, nullptr, 10);
+    } else {
+      fprintf(stderr, "unknown option: %s\n", arg);
+      exit(1);
+    }
+  }
+  if (opt.threads.empty()) {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 1; t < cores; t *= 2) opt.threads.push_back(t);
+    opt.threads.push_back(cores);
+  }
+  return opt;
+}
+
+// 第i个key：乘以奇数在 2^32 上是双射，保证 n <= 2^32 时key互不相同且分布打散
+inline int scrambled_key(uint64_t i) {
+  return static_cast<int>(static_cast<uint32_t>(i * 2654435761u));
+}
+
+// YCSB 使用的 Zipf 生成器（Gray et al., "Quickly Generating Billion-Record
+// Synthetic Databases"），返回 [0, n) 的排名，0 最热
+class ZipfGenerator {
+ public:
+  explicit ZipfGenerator(uint64_t n, double theta = 0.99)
+      : n_(n), theta_(theta), zetan_(zeta(n, theta)) {
+    alpha_ = 1.0 / (1.0 - theta_);
+    eta_ = (1.0 - std::pow(2.0 / n_, 1.0 - theta_)) /
+           (1.0 - zeta(2, theta_) / zetan_);
+  }
+
+  template <class Gen>
+  uint64_t operator()(Gen& gen) {
+    double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+    double uz = u * zetan_;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + std::pow(0.5, theta_)) return n_ > 1 ? 1 : 0;
+    uint64_t rank = static_cast<uint64_t>(
+        n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return rank < n_ ? rank : n_ - 1;
+  }
+
+ private:
+  static double zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; ++i) sum += 1.0 / std::pow(i, theta);
+    return sum;
+  }
+
+  uint64_t n_;
+  double theta_;
+  double zetan_;
+  double alpha_;
+  double eta_;
+};
+
+// 通过 /proc/self/clear_refs 重置峰值RSS，使每组测量的 VmHWM 互不影响
+inline void reset_peak_rss() {
+  FILE* f = fopen("/proc/self/clear_refs", "w");
+  if (f == nullptr) return;
+  fputs("5", f);
+  fclose(f);
+}
+
+inline long peak_rss_kb() {
+  FILE* f = fopen("/proc/self/status", "r");
+  if (f == nullptr) return -1;
+  char line[256];
+  long kb = -1;
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    if (strncmp(line, "VmHWM:", 6) == 0) {
+      kb = strtol(line + 6, nullptr, 10);
+      break;
+    }
+  }
+  fclose(f);
+  return kb;
+}
+
+using Clock = std::chrono::steady_clock;
+
+inline double ns_between(Clock::time_point a, Clock::time_point b) {
+  return std::chrono::duration<double, std::nano>(b - a).count();
+}
+
+// 累计一段操作的总耗时，并按固定步长抽样单次操作的延迟
+class Recorder {
+ public:
+  explicit Recorder(size_t ops)
+      : stride_(ops >= 64000 ? 64 : std::max<size_t>(1, ops / 1000)) {
+    samples_.reserve(ops / stride_ + 1);
+  }
+
+  template <class Op>
+  void run(size_t ops, Op op) {
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+      if (i % stride_ == 0) {
+        Clock::time_point t0 = Clock::now();
+        op(i);
+        samples_.push_back(ns_between(t0, Clock::now()));
+      } else {
+        op(i);
+      }
+    }
+    total_ns_ += ns_between(start, Clock::now());
+    ops_ += ops;
+  }
+
+  // 记录一段整体计时的操作（例如一次批量运算覆盖 ops 个元素），不做单次抽样
+  void add(size_t ops, double ns) {
+    total_ns_ += ns;
+    ops_ += ops;
+    samples_.push_back(ops == 0 ? 0 : ns / ops);
+  }
+
+  void report(const char* impl, const char* workload, size_t n,
+              const char* op) {
+    std::sort(samples_.begin(), samples_.end());
+    double p50 = percentile(0.50), p99 = percentile(0.99);
+    double ns_per_op = ops_ == 0 ? 0 : total_ns_ / ops_;
+    printf("%s,%s,%zu,%s,%zu,%.2f,%.3f,%.0f,%.0f,%ld\n", impl, workload, n, op,
+           ops_, ns_per_op, ns_per_op == 0 ? 0 : 1e3 / ns_per_op, p50, p99,
+           peak_rss_kb());
+    fflush(stdout);
+  }
+
+ private:
+  double percentile(double p) const {
+    if (samples_.empty()) return 0;
+    return samples_[static_cast<size_t>(p * (samples_.size() - 1))];
+  }
+
+  size_t stride_;
+  size_t ops_ = 0;
+  double total_ns_ = 0;
+  std::vector<double> samples_;
+};
+
+inline void print_header() {
+  printf("impl,workload,n,op,ops,ns_per_op,mops,p50_ns,p99_ns,peak_rss_kb\n");
+}
+
+// 防止查询结果被优化掉
+static volatile size_t sink;
+
+// 区间扫描每次从 lower_bound 开始读取的元素个数
+static const size_t kScanLength = 100;
+
+// Set 需要提供 bool insert(int)、bool contains(int)、bool remove(int)，
+// 以及 size_t scan(int lo, size_t count)：从第一个 >= lo 的元素开始顺序读取
+// 至多 count 个元素，返回读取的个数；count 为 SIZE_MAX 时即完整遍历；
+// 以及 void append(int key)：以 end() 为提示插入大于所有已有元素的 key；
+// 以及 void contains_batch(const int* keys, size_t n, bool* out)：批量查找；
+// 以及 void clear()：删除全部元素
+//   seq    : 升序插入、升序查询、升序删除
+//   random : 乱序插入、均匀随机查询、乱序删除
+//   zipf   : 乱序插入、Zipf(0.99) 分布查询、乱序删除
+//   mixed  : 乱序预填充n个key后执行n次操作，read_ratio 比例为 Zipf 查询，
+//            其余交替插入新key和删除最旧的key，保持规模不变
+//   scan   : 乱序插入后，range_scan 为随机起点的 kScanLength 个元素的区间扫描，
+//            按每个元素统计耗时；full_scan 为完整的中序遍历
+//   append : 单调递增的 key 流，append 为带提示的尾部插入，insert 为同样的
+//            key 不带提示插入。大规模如 --sizes=1e8 --workloads=append
+//   batch  : 乱序插入后做 n 次均匀随机查找，一半命中。find 为逐个查找，
+//            batch16/64/256 为每批若干个 key 的 contains_batch，按每个 key 统计耗时
+//   destroy: 乱序插入后整体释放，clear 为调用 clear()，destroy 为析构，
+//            按每个元素统计耗时
+template <class Set>
+void run_workload(const char* impl, const std::string& workload, size_t n,
+                  const Options& opt) {
+  std::mt19937_64 gen(opt.seed);
+  bool seq = workload == "seq";
+  auto key_of = [seq](uint64_t i) {
+    return seq ? static_cast<int>(i) : scrambled_key(i);
+  };
+
+  std::vector<int> lookups(n);
+  if (workload == "random") {
+    std::uniform_int_distribution<uint64_t> dis(0, n - 1);
+    for (auto& key : lookups) key = key_of(dis(gen));
+  } else if (workload == "zipf" || workload == "mixed") {
+    ZipfGenerator zipf(n);
+    // 热点key随机打散在整个key空间上
+    for (auto& key : lookups) key = key_of(zipf(gen) * 7919 % n);
+  } else {
+    for (size_t i = 0; i < n; ++i) lookups[i] = key_of(i);
+  }
+
+  reset_peak_rss();
+  Set* set = new Set();
+  const char* name = workload.c_str();
+  if (workload == "scan") {
+    for (size_t i = 0; i < n; ++i) set->insert(key_of(i));
+    size_t scans = std::max<size_t>(1, n / kScanLength);
+    std::uniform_int_distribution<uint64_t> dis(0, n - 1);
+    Recorder range(scans);
+    size_t visited = 0;
+    for (size_t i = 0; i < scans; ++i) {
+      int lo = key_of(dis(gen));
+      Clock::time_point t0 = Clock::now();
+      size_t count = set->scan(lo, kScanLength);
+      range.add(count, ns_between(t0, Clock::now()));
+      visited += count;
+    }
+    sink = visited;
+    range.report(impl, name, n, "range_scan");
+
+    Recorder full(1);
+    Clock::time_point t0 = Clock::now();
+    size_t count = set->scan(INT32_MIN, SIZE_MAX);
+    full.add(count, ns_between(t0, Clock::now()));
+    sink = count;
+    full.report(impl, name, n, "full_scan");
+    delete set;
+    return;
+  }
+  if (workload == "mixed") {
+    for (size_t i = 0; i < n; ++i) set->insert(key_of(i));
+    std::vector<uint8_t> is_read(n);
+    std::bernoulli_distribution coin(opt.read_ratio);
+    for (size_t i = 0; i < n; ++i) is_read[i] = coin(gen);
+    Recorder mixed(n);
+    size_t next_insert = n, next_remove = 0, writes = 0, hits = 0;
+    mixed.run(n, [&](size_t i) {
+      if (is_read[i]) {
+        hits += set->contains(lookups[i]);
+      } else if (writes++ % 2 == 0) {
+        set->insert(key_of(next_insert++));
+      } else {
+        set->remove(key_of(next_remove++));
+      }
+    });
+    sink = hits;
+    mixed.report(impl, name, n, "mixed");
+    delete set;
+    return;
+  }
+
+  if (workload == "batch") {
+    for (size_t i = 0; i < n; ++i) set->insert(key_of(i));
+    // [n, 2n) 的 key 不在集合中
+    std::uniform_int_distribution<uint64_t> dis(0, 2 * n - 1);
+    for (auto& key : lookups) key = key_of(dis(gen));
+    Recorder find(n);
+    size_t hits = 0;
+    find.run(n, [&](size_t i) { hits += set->contains(lookups[i]); });
+    sink = hits;
+    find.report(impl, name, n, "find");
+
+    const size_t batches[] = {16, 64, 256};
+    for (size_t batch : batches) {
+      std::unique_ptr<bool[]> found(new bool[batch]);
+      Recorder recorder(n / batch + 1);
+      hits = 0;
+      for (size_t i = 0; i < n; i += batch) {
+        size_t count = std::min(batch, n - i);
+        Clock::time_point t0 = Clock::now();
+        set->contains_batch(lookups.data() + i, count, found.get());
+        recorder.add(count, ns_between(t0, Clock::now()));
+        for (size_t j = 0; j < count; ++j) hits += found[j];
+      }
+      sink = hits;
+      std::string op = "batch" + std::to_string(batch);
+      recorder.report(impl, name, n, op.c_str());
+    }
+    delete set;
+    return;
+  }
+  if (workload == "destroy") {
+    for (size_t i = 0; i < n; ++i) set->insert(key_of(i));
+    Recorder clear(1);
+    Clock::time_point t0 = Clock::now();
+    set->clear();
+    clear.add(n, ns_between(t0, Clock::now()));
+    clear.report(impl, name, n, "clear");
+    delete set;
+
+    set = new Set();
+    for (size_t i = 0; i < n; ++i) set->insert(key_of(i));
+    Recorder destroy(1);
+    t0 = Clock::now();
+    delete set;
+    destroy.add(n, ns_between(t0, Clock::now()));
+    destroy.report(impl, name, n, "destroy");
+    return;
+  }
+  if (workload == "append") {
+    Recorder append(n);
+    append.run(n, [&](size_t i) { set->append(static_cast<int>(i)); });
+    append.report(impl, name, n, "append");
+    delete set;
+    set = new Set();
+    Recorder insert(n);
+    insert.run(n, [&](size_t i) { set->insert(static_cast<int>(i)); });
+    insert.report(impl, name, n, "insert");
+    delete set;
+    return;
+  }
+
+  Recorder insert(n);
+  insert.run(n, [&](size_t i) { set->insert(key_of(i)); });
+  insert.report(impl, name, n, "insert");
+
+  Recorder find(n);
+  size_t hits = 0;
+  find.run(n, [&](size_t i) { hits += set->contains(lookups[i]); });
+  sink = hits;
+  find.report(impl, name, n, "find");
+
+  Recorder remove(n);
+  remove.run(n, [&](size_t i) { set->remove(key_of(i)); });
+  remove.report(impl, name, n, "remove");
+  delete set;
+}
+
+template <class Set>
+void run(const char* impl, const Options& opt) {
+  if (!opt.has_impl(impl)) return;
+  for (size_t n : opt.sizes) {
+    for (const std::string& workload : opt.workloads) {
+      run_workload<Set>(impl, workload, n, opt);
+    }
+  }
+}
+
+}  // namespace bench
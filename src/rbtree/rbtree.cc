@@ -6,38 +6,213 @@
 #include <queue>
 #include <vector>
 
+// 统计语句，未定义 RBTREE_STATS 时展开为空。以下几个宏未定义时就是原本的表达式，
+// 生成的代码与没有统计时相同：
+//   RBTREE_COMPARE(expr)  查找路径上的一次比较
+//   RBTREE_NEW_NODE(val) / RBTREE_DELETE_NODE(node)  节点的申请与释放
+#ifdef RBTREE_STATS
+#define RBTREE_STAT(stmt) (stmt)
+#define RBTREE_COMPARE(expr) (++stats_.compares, (expr))
+#define RBTREE_NEW_NODE(val) (stats_.allocate(sizeof(Node)), new Node(val))
+#define RBTREE_DELETE_NODE(node) \
+  (stats_.deallocate(sizeof(Node)), delete (node))
+#else
+#define RBTREE_STAT(stmt) ((void)0)
+#define RBTREE_COMPARE(expr) (expr)
+#define RBTREE_NEW_NODE(val) new Node(val)
+#define RBTREE_DELETE_NODE(node) delete (node)
+#endif
+
+RBTree::RBTree(const int* first, const int* last) {
+  assign_sorted(first, last);
+}
+
+void RBTree::assign_sorted(const int* first, const int* last) {
+  for (const int* it = first; it + 1 < last; ++it) {
+    assert(it[0] < it[1]);
+  }
+  clear();
+  size_t n = last - first;
+  if (n == 0) return;
+  int red_depth = 0;  // floor(log2(n))
+  while ((n >> (red_depth + 1)) != 0) ++red_depth;
+  root = build_sorted(first, n, 0, red_depth);
+  leftmost_ = leftmost(root);
+  rightmost_ = rightmost(root);
+}
+
+Node* RBTree::build_sorted(const int*& it, size_t n, int depth,
+                           int red_depth) {
+  if (n == 0) return nullptr;
+  size_t lsize = (n - 1) / 2;
+  Node* lchild = build_sorted(it, lsize, depth + 1, red_depth);
+  Node* node = RBTREE_NEW_NODE(*it++);
+  node->color = depth == red_depth && depth > 0 ? Color::RED : Color::BLACK;
+  node->lchild = lchild;
+  if (lchild != nullptr) lchild->parent = node;
+  node->rchild = build_sorted(it, n - 1 - lsize, depth + 1, red_depth);
+  if (node->rchild != nullptr) node->rchild->parent = node;
+  return node;
+}
+
 Node* RBTree::find(int val) const {
   Node* cur = root;
+#ifdef RBTREE_STATS
+  int depth = 0;
+#endif
   while (cur != nullptr) {
-    if (val < cur->value) {
+    RBTREE_STAT(++depth);
+    if (RBTREE_COMPARE(val < cur->value)) {
       cur = cur->lchild;
-    } else if (val > cur->value) {
+    } else if (RBTREE_COMPARE(val > cur->value)) {
       cur = cur->rchild;
     } else {
+      RBTREE_STAT(stats_.find(depth));
       return cur;
     }
   }
+  RBTREE_STAT(stats_.find(depth));
   return nullptr;
 }
 
+void RBTree::find_batch(const int* keys, size_t n, Node** out) const {
+  if (root == nullptr) {
+    for (size_t i = 0; i < n; ++i) out[i] = nullptr;
+    return;
+  }
+  // [0, active) 为进行中的查找，cur 为下一步要比较的节点（已预取）。
+  // 完成的查找立即由下一个 key 接替，没有剩余的 key 时用最后一个查找填补
+  struct Probe {
+    Node* cur;
+    size_t index;
+  };
+  Probe probes[kBatchInflight];
+#ifdef RBTREE_STATS
+  // 每个查找经过的节点数
+  int depth[kBatchInflight] = {};
+#endif
+  size_t next = 0, active = 0;
+  for (; active < kBatchInflight && next < n; ++active, ++next) {
+    probes[active].cur = root;
+    probes[active].index = next;
+  }
+  while (active > 0) {
+    for (size_t s = 0; s < active;) {
+      Probe& p = probes[s];
+      int val = keys[p.index];
+      Node* child = p.cur;
+      RBTREE_STAT(++depth[s]);
+      if (RBTREE_COMPARE(val < child->value)) {
+        child = child->lchild;
+      } else if (RBTREE_COMPARE(val > child->value)) {
+        child = child->rchild;
+      }
+      if (child == p.cur || child == nullptr) {
+        RBTREE_STAT(stats_.find(depth[s]));
+        RBTREE_STAT(depth[s] = 0);
+        out[p.index] = child;
+        if (next < n) {
+          p.cur = root;
+          p.index = next++;
+        } else {
+          p = probes[--active];
+          RBTREE_STAT(depth[s] = depth[active]);
+          continue;
+        }
+      } else {
+        __builtin_prefetch(child);
+        p.cur = child;
+      }
+      ++s;
+    }
+  }
+}
+
+void RBTree::contains_batch(const int* keys, size_t n, bool* out) const {
+  Node* nodes[256];
+  for (size_t i = 0; i < n; i += 256) {
+    size_t count = n - i < 256 ? n - i : 256;
+    find_batch(keys + i, count, nodes);
+    for (size_t j = 0; j < count; ++j) out[i + j] = nodes[j] != nullptr;
+  }
+}
+
 bool RBTree::insert(int val) {
-  Node** pparent = &root;  // 二级指针：用于指向Node应该所在的位置
-  Node* parent = nullptr;  // 维护要插入的node的父亲节点
-  while (*pparent != nullptr) {
-    parent = *pparent;
-    if (val < parent->value) {
-      pparent = &parent->lchild;
-    } else if (val > parent->value) {
-      pparent = &parent->rchild;
+  Node* parent;
+  Direction dir;
+  if (find_position(val, parent, dir) != nullptr) return false;
+  link(RBTREE_NEW_NODE(val), parent, dir);
+  return true;
+}
+
+RBTree::const_iterator RBTree::insert(const_iterator hint, int val) {
+  Node* next = hint.node_;
+  Node* prev = next == nullptr    ? rightmost_
+               : next == leftmost_ ? nullptr
+                                   : predecessor(next);
+  Node* parent;
+  Direction dir;
+  if ((next == nullptr || val < next->value) &&
+      (prev == nullptr || prev->value < val)) {
+    // val 位于 prev 和 next 之间：next 没有左孩子时挂在 next 左侧，
+    // 否则 prev 是 next 左子树的最大值，一定没有右孩子
+    if (next != nullptr && next->lchild == nullptr) {
+      parent = next;
+      dir = Direction::LEFT;
     } else {
-      return false;
+      parent = prev;
+      dir = Direction::RIGHT;
     }
+  } else if (Node* found = find_position(val, parent, dir)) {
+    return const_iterator(this, found);
+  }
+  Node* node = RBTREE_NEW_NODE(val);
+  link(node, parent, dir);
+  return const_iterator(this, node);
+}
+
+Node* RBTree::find_position(int val, Node*& parent, Direction& dir) const {
+  parent = nullptr;
+  dir = Direction::RIGHT;
+  if (root == nullptr) return nullptr;
+  if (RBTREE_COMPARE(rightmost_->value < val)) {
+    parent = rightmost_;
+    return nullptr;
+  }
+  if (RBTREE_COMPARE(val < leftmost_->value)) {
+    parent = leftmost_;
+    dir = Direction::LEFT;
+    return nullptr;
+  }
+  Node* cur = root;
+  while (cur != nullptr) {
+    parent = cur;
+    if (RBTREE_COMPARE(val < cur->value)) {
+      cur = cur->lchild;
+      dir = Direction::LEFT;
+    } else if (RBTREE_COMPARE(val > cur->value)) {
+      cur = cur->rchild;
+      dir = Direction::RIGHT;
+    } else {
+      return cur;
+    }
+  }
+  return nullptr;
+}
+
+void RBTree::link(Node* node, Node* parent, Direction dir) {
+  if (parent == nullptr) {
+    root = leftmost_ = rightmost_ = node;
+  } else if (dir == Direction::LEFT) {
+    parent->lchild = node;
+    if (parent == leftmost_) leftmost_ = node;
+  } else {
+    parent->rchild = node;
+    if (parent == rightmost_) rightmost_ = node;
   }
-  Node* node = new Node(val);
-  *pparent = node;
   node->parent = parent;
+  RBTREE_STAT(++stats_.inserts);
   insert_fix(node);
-  return true;
 }
 
 void RBTree::insert_fix(Node* node) {
@@ -64,25 +239,31 @@ void RBTree::insert_fix(Node* node) {
     }
     Direction node_direction =
         parent->lchild == node ? Direction::LEFT : Direction::RIGHT;
+    RBTREE_STAT(++stats_.insert_fix_loops);
     if (uncle != nullptr &&
         uncle->color == Color::RED) {  // case 2 : uncle is red
       uncle->color = Color::BLACK;
       parent->color = Color::BLACK;
       grandpa->color = Color::RED;
+      RBTREE_STAT(stats_.insert_case(RBTreeStats::InsertCase::kRecolor));
       node = grandpa;
     } else {  // case 3 : uncle is black
       if (node_direction == parent_diretion) {
         if (node_direction == Direction::RIGHT) {  // RR
+          RBTREE_STAT(stats_.insert_case(RBTreeStats::InsertCase::kRR));
           left_rotate(grandpa);
         } else {  // LL
+          RBTREE_STAT(stats_.insert_case(RBTreeStats::InsertCase::kLL));
           right_rotate(grandpa);
         }
         std::swap(grandpa->color, parent->color);
         node = grandpa;
       } else {
         if (node_direction == Direction::RIGHT) {  // LR
+          RBTREE_STAT(stats_.insert_case(RBTreeStats::InsertCase::kLR));
           left_rotate(parent);
         } else {  // RL
+          RBTREE_STAT(stats_.insert_case(RBTreeStats::InsertCase::kRL));
           right_rotate(parent);
         }
         node = parent;
@@ -99,6 +280,7 @@ void RBTree::insert_fix(Node* node) {
              y       z         x        y
 */
 void RBTree::left_rotate(Node* node) {
+  RBTREE_STAT(++stats_.rotations);
   Node* rchild = node->rchild;
   node->rchild = rchild->lchild;
   if (rchild->lchild != nullptr) {
@@ -125,6 +307,7 @@ void RBTree::left_rotate(Node* node) {
     x         y                      y          z
 */
 void RBTree::right_rotate(Node* node) {
+  RBTREE_STAT(++stats_.rotations);
   Node* lchild = node->lchild;
   node->lchild = lchild->rchild;
   if (lchild->rchild != nullptr) {
@@ -155,6 +338,78 @@ void RBTree::transplant(Node* node, Node* replace) noexcept {
   replace->parent = node->parent;
 }
 
+Node* RBTree::predecessor(Node* node) noexcept {
+  if (node->lchild != nullptr) return rightmost(node->lchild);
+  // 找到第一个node在其右子树的祖先
+  Node* p = node->parent;
+  Node* cur = node;
+  while (p != nullptr && cur == p->lchild) {
+    cur = p;
+    p = p->parent;
+  }
+  return p;
+}
+
+Node* RBTree::leftmost(Node* node) noexcept {
+  while (node->lchild != nullptr) node = node->lchild;
+  return node;
+}
+
+Node* RBTree::rightmost(Node* node) noexcept {
+  while (node->rchild != nullptr) node = node->rchild;
+  return node;
+}
+
+RBTree::const_iterator& RBTree::const_iterator::operator++() {
+  node_ = successor(node_);
+  return *this;
+}
+
+RBTree::const_iterator& RBTree::const_iterator::operator--() {
+  node_ = node_ == nullptr ? tree_->rightmost_ : predecessor(node_);
+  return *this;
+}
+
+RBTree::const_iterator RBTree::begin() const {
+  return const_iterator(this, leftmost_);
+}
+
+RBTree::const_iterator RBTree::lower_bound(int val) const {
+  Node* cur = root;
+  Node* result = nullptr;
+  while (cur != nullptr) {
+    if (RBTREE_COMPARE(cur->value < val)) {
+      cur = cur->rchild;
+    } else {
+      result = cur;
+      cur = cur->lchild;
+    }
+  }
+  return const_iterator(this, result);
+}
+
+RBTree::const_iterator RBTree::upper_bound(int val) const {
+  Node* cur = root;
+  Node* result = nullptr;
+  while (cur != nullptr) {
+    if (RBTREE_COMPARE(cur->value <= val)) {
+      cur = cur->rchild;
+    } else {
+      result = cur;
+      cur = cur->lchild;
+    }
+  }
+  return const_iterator(this, result);
+}
+
+std::pair<RBTree::const_iterator, RBTree::const_iterator> RBTree::equal_range(
+    int val) const {
+  const_iterator first = lower_bound(val);
+  const_iterator last = first;
+  if (last != end() && *last == val) ++last;
+  return std::make_pair(first, last);
+}
+
 Node* RBTree::successor(Node* node) noexcept {
   if (node->rchild != nullptr) {
     Node* p = node->rchild;
@@ -211,8 +466,12 @@ void RBTree::print_graphvis() const {
 }
 
 void RBTree::check() const {
-  if (root == nullptr) return;
+  if (root == nullptr) {
+    assert(leftmost_ == nullptr && rightmost_ == nullptr);
+    return;
+  }
   assert(root->color == Color::BLACK);
+  assert(leftmost_ == leftmost(root) && rightmost_ == rightmost(root));
   post_travel(root);
 }
 
@@ -242,10 +501,16 @@ bool RBTree::remove(int val) {
 }
 
 void RBTree::erase(Node* node) {
+  RBTREE_STAT(++stats_.removes);
+  // 最小、最大节点至多有一个孩子，一定是被删除的节点本身
+  if (node == leftmost_) leftmost_ = successor(node);
+  if (node == rightmost_) rightmost_ = predecessor(node);
   // 如果左右子树都不为空，那么找后继，用后继替换当前节点，删除后继
   if (node->lchild != nullptr && node->rchild != nullptr) {
     Node* s = successor(node);
     node->value = s->value;
+    // 后继是最大节点时，最大值移到了node上
+    if (s == rightmost_) rightmost_ = node;
     node = s;
   }
   // 此时左右子树一定有一个为空
@@ -272,17 +537,19 @@ void RBTree::erase(Node* node) {
       }
     }
   }
-  delete node;
+  RBTREE_DELETE_NODE(node);
 }
 
 void RBTree::remove_fix(Node* node) {
   while (node != root && node->color == Color::BLACK) {
     Node *parent = node->parent, *sibling;
+    RBTREE_STAT(++stats_.remove_fix_loops);
     if (node == parent->lchild) {
       sibling = parent->rchild;
       if (sibling->color == Color::RED) {
         sibling->color = Color::BLACK;
         parent->color = Color::RED;
+        RBTREE_STAT(stats_.remove_case(RBTreeStats::RemoveCase::kRedSibling));
         left_rotate(parent);
         // parent绕着node左旋，左旋完成后，原来的node一定还是新节点的左儿子，因此这里sibling直接取rchild
         parent = node->parent;
@@ -291,11 +558,14 @@ void RBTree::remove_fix(Node* node) {
       if ((!sibling->lchild || sibling->lchild->color == Color::BLACK) &&
           (!sibling->rchild || sibling->rchild->color == Color::BLACK)) {
         sibling->color = Color::RED;
+        RBTREE_STAT(stats_.remove_case(RBTreeStats::RemoveCase::kRecolor));
         node = parent;
       } else {
         if (!sibling->rchild || sibling->rchild->color == Color::BLACK) {  // RL
           // sibling->lchild->color = Color::BLACK;
           // sibling->color = Color::RED;
+          RBTREE_STAT(
+              stats_.remove_case(RBTreeStats::RemoveCase::kNearNephew));
           right_rotate(sibling);
           // parent = node->parent;
           sibling = parent->rchild;
@@ -304,6 +574,7 @@ void RBTree::remove_fix(Node* node) {
         sibling->color = parent->color;
         parent->color = Color::BLACK;
         sibling->rchild->color = Color::BLACK;
+        RBTREE_STAT(stats_.remove_case(RBTreeStats::RemoveCase::kFarNephew));
         left_rotate(parent);
         node = root;
       }
@@ -312,6 +583,7 @@ void RBTree::remove_fix(Node* node) {
       if (sibling->color == Color::RED) {
         sibling->color = Color::BLACK;
         parent->color = Color::RED;
+        RBTREE_STAT(stats_.remove_case(RBTreeStats::RemoveCase::kRedSibling));
         right_rotate(parent);
         parent = node->parent;
         sibling = parent->lchild;
@@ -319,11 +591,14 @@ void RBTree::remove_fix(Node* node) {
       if ((!sibling->rchild || sibling->rchild->color == Color::BLACK) &&
           (!sibling->lchild || sibling->lchild->color == Color::BLACK)) {
         sibling->color = Color::RED;
+        RBTREE_STAT(stats_.remove_case(RBTreeStats::RemoveCase::kRecolor));
         node = parent;
       } else {
         if (!sibling->lchild || sibling->lchild->color == Color::BLACK) {  // LR
           // sibling->rchild->color = Color::BLACK;
           // sibling->color = Color::RED;
+          RBTREE_STAT(
+              stats_.remove_case(RBTreeStats::RemoveCase::kNearNephew));
           left_rotate(sibling);
           // parent = node->parent;
           sibling = parent->lchild;
@@ -331,6 +606,7 @@ void RBTree::remove_fix(Node* node) {
         sibling->color = parent->color;
         parent->color = Color::BLACK;
         sibling->lchild->color = Color::BLACK;
+        RBTREE_STAT(stats_.remove_case(RBTreeStats::RemoveCase::kFarNephew));
         right_rotate(parent);
         node = root;
       }
@@ -339,15 +615,89 @@ void RBTree::remove_fix(Node* node) {
   node->color = Color::BLACK;
 }
 
-RBTree::~RBTree() {
-  if (root == nullptr) return;
-  std::queue<Node*> q;
-  q.push(root);
-  while (!q.empty()) {
-    Node* node = q.front();
-    q.pop();
-    if (node->lchild != nullptr) q.push(node->lchild);
-    if (node->rchild != nullptr) q.push(node->rchild);
-    delete node;
+RBTree::~RBTree() { clear(); }
+
+RBTree::RBTree(const RBTree& other) {
+  if (other.root == nullptr) return;
+  root = RBTREE_NEW_NODE(other.root->value);
+  root->color = other.root->color;
+  try {
+    copy_children(other.root, root);
+  } catch (...) {
+    // 已复制的节点都已挂在树上
+    clear();
+    throw;
+  }
+  leftmost_ = leftmost(root);
+  rightmost_ = rightmost(root);
+}
+
+RBTree& RBTree::operator=(const RBTree& other) {
+  if (this != &other) {
+    RBTree copy(other);
+    swap(copy);
+  }
+  return *this;
+}
+
+// 先挂到 dst 下再继续复制，出错时已复制的部分仍连在树上
+void RBTree::copy_children(const Node* src, Node* dst) {
+  if (src->lchild != nullptr) {
+    dst->lchild = RBTREE_NEW_NODE(src->lchild->value);
+    dst->lchild->color = src->lchild->color;
+    dst->lchild->parent = dst;
+    copy_children(src->lchild, dst->lchild);
+  }
+  if (src->rchild != nullptr) {
+    dst->rchild = RBTREE_NEW_NODE(src->rchild->value);
+    dst->rchild->color = src->rchild->color;
+    dst->rchild->parent = dst;
+    copy_children(src->rchild, dst->rchild);
+  }
+}
+
+RBTree::RBTree(RBTree&& other) noexcept
+    : root(other.root),
+      leftmost_(other.leftmost_),
+      rightmost_(other.rightmost_) {
+  other.root = other.leftmost_ = other.rightmost_ = nullptr;
+#ifdef RBTREE_STATS
+  stats_ = other.stats_;
+#endif
+}
+
+RBTree& RBTree::operator=(RBTree&& other) noexcept {
+  if (this != &other) {
+    clear();
+    swap(other);
+  }
+  return *this;
+}
+
+void RBTree::swap(RBTree& other) noexcept {
+  std::swap(root, other.root);
+  std::swap(leftmost_, other.leftmost_);
+  std::swap(rightmost_, other.rightmost_);
+#ifdef RBTREE_STATS
+  std::swap(stats_, other.stats_);
+#endif
+}
+
+void RBTree::clear() {
+  // 有左孩子时右旋，把左子树逐步转到右侧；没有左孩子时释放节点并走向右孩子。
+  // 每个节点至多被右旋一次，总共 O(n)，不需要队列或栈
+  Node* node = root;
+  while (node != nullptr) {
+    Node* l = node->lchild;
+    if (l == nullptr) {
+      Node* r = node->rchild;
+      RBTREE_DELETE_NODE(node);
+      node = r;
+    } else {
+      node->lchild = l->rchild;
+      l->rchild = node;
+      node = l;
+    }
   }
+  root = leftmost_ = rightmost_ = nullptr;
 }
\ No newline at end of file
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <iterator>
+#include <utility>
+
 enum class Color { RED, BLACK };
 enum class Direction { LEFT, RIGHT };
 struct Node {
@@ -16,17 +22,183 @@ struct Node {
         color(Color::RED) {}
 };
 
+#ifdef RBTREE_STATS
+// 编译时定义 RBTREE_STATS 才统计，未定义时树中不含任何统计代码。
+// 启用后 const 的查找也会修改计数，不能再并发读
+struct RBTreeStats {
+  // insert_fix 每一轮的情形：叔叔为红时变色上移，否则按父亲、节点的方向旋转
+  enum class InsertCase { kRecolor, kLL, kLR, kRL, kRR };
+  // remove_fix 每一轮的情形：兄弟为红时先旋转父亲；兄弟的孩子都为黑时变色上移；
+  // 否则近侄子为红时先旋转兄弟，再旋转父亲结束
+  enum class RemoveCase { kRedSibling, kRecolor, kNearNephew, kFarNephew };
+  // 超过 kMaxDepth 的深度计入最后一格
+  static const int kMaxDepth = 64;
+
+  // 查找路径上的比较（find、插入位置、lower/upper_bound）
+  uint64_t compares = 0;
+  uint64_t finds = 0;
+  uint64_t inserts = 0;
+  uint64_t removes = 0;
+  uint64_t insert_fix_loops = 0;
+  uint64_t insert_cases[5] = {};  // 按 InsertCase 下标
+  uint64_t remove_fix_loops = 0;
+  uint64_t remove_cases[4] = {};  // 按 RemoveCase 下标
+  uint64_t rotations = 0;
+  uint64_t allocations = 0;
+  uint64_t allocated_bytes = 0;
+  uint64_t deallocations = 0;
+  uint64_t deallocated_bytes = 0;
+  uint64_t depth[kMaxDepth + 1] = {};  // find 经过的节点数的分布
+
+  void find(int d) {
+    ++finds;
+    ++depth[d < kMaxDepth ? d : kMaxDepth];
+  }
+  void allocate(size_t bytes) {
+    ++allocations;
+    allocated_bytes += bytes;
+  }
+  void deallocate(size_t bytes) {
+    ++deallocations;
+    deallocated_bytes += bytes;
+  }
+  void insert_case(InsertCase c) { ++insert_cases[static_cast<int>(c)]; }
+  void remove_case(RemoveCase c) { ++remove_cases[static_cast<int>(c)]; }
+
+  // 平均每次 find 的深度
+  double mean_depth() const {
+    uint64_t sum = 0;
+    for (int d = 0; d <= kMaxDepth; ++d) sum += depth[d] * d;
+    return finds == 0 ? 0 : double(sum) / finds;
+  }
+  // 导出：对每个计数器调用 f(const char* name, uint64_t value)
+  template <class F>
+  void for_each(F f) const {
+    static const char* const kInsertCases[] = {
+        "insert_recolor", "insert_ll", "insert_lr", "insert_rl", "insert_rr"};
+    static const char* const kRemoveCases[] = {
+        "remove_red_sibling", "remove_recolor", "remove_near_nephew",
+        "remove_far_nephew"};
+    f("compares", compares);
+    f("finds", finds);
+    f("inserts", inserts);
+    f("removes", removes);
+    f("insert_fix_loops", insert_fix_loops);
+    for (int i = 0; i < 5; ++i) f(kInsertCases[i], insert_cases[i]);
+    f("remove_fix_loops", remove_fix_loops);
+    for (int i = 0; i < 4; ++i) f(kRemoveCases[i], remove_cases[i]);
+    f("rotations", rotations);
+    f("allocations", allocations);
+    f("allocated_bytes", allocated_bytes);
+    f("deallocations", deallocations);
+    f("deallocated_bytes", deallocated_bytes);
+  }
+  // 对深度直方图中非0的格调用 f(int depth, uint64_t count)
+  template <class F>
+  void for_each_depth(F f) const {
+    for (int d = 0; d <= kMaxDepth; ++d) {
+      if (depth[d] != 0) f(d, depth[d]);
+    }
+  }
+};
+#endif
+
 class RBTree {
  public:
+  // 双向迭代器，end() 对应空节点，--end() 得到最大值。值不可修改。
+  class const_iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = int;
+    using difference_type = ptrdiff_t;
+    using pointer = const int*;
+    using reference = const int&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return node_->value; }
+    pointer operator->() const { return &node_->value; }
+    const_iterator& operator++();
+    const_iterator& operator--();
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+    const_iterator operator--(int) {
+      const_iterator old = *this;
+      --*this;
+      return old;
+    }
+    bool operator==(const const_iterator& other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return node_ != other.node_;
+    }
+    Node* node() const { return node_; }
+
+   private:
+    friend class RBTree;
+    const_iterator(const RBTree* tree, Node* node) : tree_(tree), node_(node) {}
+
+    const RBTree* tree_ = nullptr;
+    Node* node_ = nullptr;
+  };
+  using iterator = const_iterator;
+
+  RBTree() = default;
+  // 由严格升序的 [first, last) 以 O(n) 构建
+  RBTree(const int* first, const int* last);
+  // 按原样复制形状和颜色，不做查找和修复，O(n)。节点按先序申请
+  RBTree(const RBTree& other);
+  RBTree& operator=(const RBTree& other);
+  // 移动只转移根和两侧边界，O(1)，other 变为空树。
+  // 节点指针保持有效，迭代器需要从新的树重新获取
+  RBTree(RBTree&& other) noexcept;
+  RBTree& operator=(RBTree&& other) noexcept;
+  void swap(RBTree& other) noexcept;
+
   Node* find(int val) const;
+  // 批量查找，out[i] 为 keys[i] 对应的节点或空。同时推进 kBatchInflight 个查找，
+  // 每走一步就预取下一个节点，轮到它时节点已经在缓存中，访存延迟相互重叠
+  void find_batch(const int* keys, size_t n, Node** out) const;
+  void contains_batch(const int* keys, size_t n, bool* out) const;
+  static const size_t kBatchInflight = 16;
   bool insert(int val);
+  // 带提示的插入：val 紧邻 hint 之前（hint 为 end() 时即大于最大值）时，
+  // 跳过从根开始的查找，只做 insert_fix，有序追加均摊 O(1)。
+  // 不紧邻时退化为普通插入。返回新插入或已存在的元素
+  const_iterator insert(const_iterator hint, int val);
+  const_iterator emplace_hint(const_iterator hint, int val) {
+    return insert(hint, val);
+  }
   bool remove(int val);
   void erase(Node* node);
+  // 清空后由严格升序的 [first, last) 重新构建，O(n)
+  void assign_sorted(const int* first, const int* last);
+
+  // 中序遍历每一步均摊 O(1)，完整遍历 O(n) 且不申请额外内存
+  const_iterator begin() const;
+  const_iterator end() const { return const_iterator(this, nullptr); }
+  // 第一个 >= val 的位置
+  const_iterator lower_bound(int val) const;
+  // 第一个 > val 的位置
+  const_iterator upper_bound(int val) const;
+  std::pair<const_iterator, const_iterator> equal_range(int val) const;
+  bool empty() const { return root == nullptr; }
+  // 释放全部节点，不申请额外内存
+  void clear();
 
   // for debug
   void print_graphvis() const;
   void check() const;
 
+#ifdef RBTREE_STATS
+  const RBTreeStats& stats() const { return stats_; }
+  void reset_stats() { stats_ = RBTreeStats(); }
+#endif
+
   ~RBTree();
 
  private:
@@ -37,9 +209,21 @@ class RBTree {
   // 移植：
   void transplant(Node* node, Node* replace) noexcept;
   // 后继：
-  Node* successor(Node* node) noexcept;
+  static Node* successor(Node* node) noexcept;
+  // 前驱：
+  static Node* predecessor(Node* node) noexcept;
+  // 最小值、最大值：
+  static Node* leftmost(Node* node) noexcept;
+  static Node* rightmost(Node* node) noexcept;
   // 后序遍历：
   int post_travel(Node* node) const;
+  // 查找val的插入位置：已存在时返回该节点，否则返回空并给出父节点和方向。
+  // 先与缓存的最小、最大节点比较，在两端插入时不需要从根下降
+  Node* find_position(int val, Node*& parent, Direction& dir) const;
+  // 把node挂到parent下并修复，parent为空时作为根
+  void link(Node* node, Node* parent, Direction dir);
+  // 复制 src 的子树挂到它的副本 dst 下
+  void copy_children(const Node* src, Node* dst);
 
   /*
   插入节点默认为红色节点
@@ -71,5 +255,19 @@ class RBTree {
   */
   void remove_fix(Node* node);
 
+  /*
+  有序构建：按中点递归切分，左右子树大小至多差1，所有空链接的深度只可能是
+  floor(log2(n)) 或 floor(log2(n)) + 1。最深一层的节点染红、其余染黑即可满足黑路同。
+  */
+  Node* build_sorted(const int*& it, size_t n, int depth, int red_depth);
+
   Node* root = nullptr;
-};
\ No newline at end of file
+  // 缓存的最小、最大节点，树为空时为空
+  Node* leftmost_ = nullptr;
+  Node* rightmost_ = nullptr;
+#ifdef RBTREE_STATS
+  mutable RBTreeStats stats_;
+#endif
+};
+
+inline void swap(RBTree& a, RBTree& b) noexcept { a.swap(b); }
\ No newline at end of file
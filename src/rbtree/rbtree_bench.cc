@@ -0,0 +1,54 @@
+#include <set>
+
+#include "bench/bench.h"
+#include "src/rbtree/rbtree.h"
+
+struct RBTreeSet {
+  RBTree tree;
+  bool insert(int key) { return tree.insert(key); }
+  void append(int key) { tree.insert(tree.end(), key); }
+  bool contains(int key) const { return tree.find(key) != nullptr; }
+  void contains_batch(const int* keys, size_t n, bool* out) const {
+    tree.contains_batch(keys, n, out);
+  }
+  bool remove(int key) { return tree.remove(key); }
+  void clear() { tree.clear(); }
+  size_t scan(int lo, size_t count) const {
+    size_t read = 0, sum = 0;
+    for (RBTree::const_iterator it = tree.lower_bound(lo);
+         it != tree.end() && read < count; ++it, ++read) {
+      sum += *it;
+    }
+    bench::sink = sum;
+    return read;
+  }
+};
+
+struct StdSet {
+  std::set<int> set;
+  bool insert(int key) { return set.insert(key).second; }
+  void append(int key) { set.insert(set.end(), key); }
+  bool contains(int key) const { return set.find(key) != set.end(); }
+  void contains_batch(const int* keys, size_t n, bool* out) const {
+    for (size_t i = 0; i < n; ++i) out[i] = contains(keys[i]);
+  }
+  bool remove(int key) { return set.erase(key) == 1; }
+  void clear() { set.clear(); }
+  size_t scan(int lo, size_t count) const {
+    size_t read = 0, sum = 0;
+    for (std::set<int>::const_iterator it = set.lower_bound(lo);
+         it != set.end() && read < count; ++it, ++read) {
+      sum += *it;
+    }
+    bench::sink = sum;
+    return read;
+  }
+};
+
+int main(int argc, char** argv) {
+  bench::Options opt = bench::parse_options(argc, argv);
+  bench::print_header();
+  bench::run<RBTreeSet>("rbtree", opt);
+  bench::run<StdSet>("std::set", opt);
+  return 0;
+}
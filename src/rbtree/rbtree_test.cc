@@ -1,10 +1,13 @@
 #include "src/rbtree/rbtree.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <random>
 #include <set>
+#include <string>
 #include <unordered_set>
+#include <vector>
 
 std::random_device rd;
 std::mt19937 gen(rd());
@@ -70,9 +73,262 @@ void batch_test() {
   }
 }
 
+void sorted_build_test() {
+  for (int n = 0; n <= 200; ++n) {
+    std::vector<int> nums(n);
+    for (int i = 0; i < n; ++i) nums[i] = i * 2;
+    RBTree rbtree(nums.data(), nums.data() + n);
+    rbtree.check();
+    for (int i = 0; i < n; ++i) {
+      assert(rbtree.find(i * 2) != nullptr);
+      assert(rbtree.find(i * 2 + 1) == nullptr);
+    }
+    // 构建后的树可以继续正常插入删除
+    for (int i = 0; i < n; ++i) {
+      assert(rbtree.insert(i * 2 + 1));
+      assert(rbtree.remove(i * 2));
+      rbtree.check();
+    }
+  }
+  std::set<int> s;
+  for (int i = 0; i < 100000; ++i) s.insert(random_int());
+  std::vector<int> nums(s.begin(), s.end());
+  RBTree rbtree;
+  rbtree.insert(-1);
+  rbtree.assign_sorted(nums.data(), nums.data() + nums.size());
+  rbtree.check();
+  assert(rbtree.find(-1) == nullptr);
+  for (auto num : nums) assert(rbtree.find(num) != nullptr);
+}
+
+void iterator_test() {
+  RBTree rbtree;
+  assert(rbtree.begin() == rbtree.end());
+  assert(rbtree.lower_bound(0) == rbtree.end());
+  std::set<int> s;
+  for (int i = 0; i < 20000; ++i) {
+    int temp = random_int() % 50000;
+    if (i % 3 == 0) {
+      rbtree.remove(temp);
+      s.erase(temp);
+    } else {
+      rbtree.insert(temp);
+      s.insert(temp);
+    }
+  }
+  std::vector<int> nums(rbtree.begin(), rbtree.end());
+  assert(nums == std::vector<int>(s.begin(), s.end()));
+  // 反向遍历
+  std::vector<int> reversed;
+  for (RBTree::const_iterator it = rbtree.end(); it != rbtree.begin();) {
+    reversed.push_back(*--it);
+  }
+  assert(std::equal(reversed.begin(), reversed.end(), s.rbegin()));
+  for (int i = 0; i < 1000; ++i) {
+    int temp = random_int() % 50002 - 1;
+    RBTree::const_iterator lower = rbtree.lower_bound(temp);
+    RBTree::const_iterator upper = rbtree.upper_bound(temp);
+    assert(lower == rbtree.end() ? s.lower_bound(temp) == s.end()
+                                 : *lower == *s.lower_bound(temp));
+    assert(upper == rbtree.end() ? s.upper_bound(temp) == s.end()
+                                 : *upper == *s.upper_bound(temp));
+    std::pair<RBTree::const_iterator, RBTree::const_iterator> range =
+        rbtree.equal_range(temp);
+    assert(range.first == lower && range.second == upper);
+    assert((lower != upper) == (s.count(temp) == 1));
+  }
+}
+
+void hint_test() {
+  // 以 end() 为提示升序追加，以 begin() 为提示降序插入
+  RBTree rbtree;
+  for (int i = 0; i < 10000; ++i) {
+    RBTree::const_iterator it = rbtree.insert(rbtree.end(), i * 2);
+    assert(*it == i * 2);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    rbtree.emplace_hint(rbtree.begin(), -1 - i * 2);
+  }
+  rbtree.check();
+  assert(*rbtree.begin() == -1999 && *--rbtree.end() == 19998);
+  // 随机提示：提示不相邻时退化为普通插入，已存在时返回已有元素
+  std::set<int> s(rbtree.begin(), rbtree.end());
+  for (int i = 0; i < 20000; ++i) {
+    int temp = random_int() % 30000 - 5000;
+    int near = i % 2 == 0 ? temp : random_int() % 30000 - 5000;
+    RBTree::const_iterator hint = rbtree.lower_bound(near);
+    RBTree::const_iterator it = rbtree.insert(hint, temp);
+    assert(*it == temp);
+    s.insert(temp);
+    if (i % 5 == 0) {
+      rbtree.remove(temp);
+      s.erase(temp);
+    }
+  }
+  rbtree.check();
+  assert(std::vector<int>(rbtree.begin(), rbtree.end()) ==
+         std::vector<int>(s.begin(), s.end()));
+}
+
+void find_batch_test() {
+  RBTree rbtree;
+  std::set<int> s;
+  std::vector<int> keys;
+  bool found[1000];
+  Node* nodes[1000];
+  // 空树
+  rbtree.find_batch(keys.data(), 0, nodes);
+  keys.push_back(1);
+  rbtree.contains_batch(keys.data(), 1, found);
+  assert(!found[0]);
+  for (int i = 0; i < 5000; ++i) {
+    int temp = random_int() % 10000;
+    rbtree.insert(temp);
+    s.insert(temp);
+  }
+  // 批的大小覆盖小于、等于和大于同时进行的查找个数，含重复的 key
+  for (size_t n : {1, 15, 16, 17, 1000}) {
+    keys.clear();
+    for (size_t i = 0; i < n; ++i) keys.push_back(random_int() % 10002 - 1);
+    rbtree.find_batch(keys.data(), n, nodes);
+    rbtree.contains_batch(keys.data(), n, found);
+    for (size_t i = 0; i < n; ++i) {
+      assert(nodes[i] == rbtree.find(keys[i]));
+      assert(found[i] == (s.count(keys[i]) == 1));
+    }
+  }
+}
+
+// 移动和交换只转移根，节点不变；clear 之后可以继续使用
+void move_clear_test() {
+  std::vector<int> nums(5000);
+  for (int i = 0; i < 5000; ++i) nums[i] = i * 2;
+  RBTree a(nums.data(), nums.data() + nums.size());
+  Node* node = a.find(100);
+  RBTree b(std::move(a));
+  assert(a.empty() && a.begin() == a.end());
+  assert(b.find(100) == node);
+  b.check();
+  // 被移动的树仍可使用
+  a.insert(1);
+  a.insert(3);
+  a.check();
+
+  swap(a, b);
+  assert(a.find(100) == node && std::distance(b.begin(), b.end()) == 2);
+  b = std::move(a);
+  assert(a.empty() && b.find(100) == node);
+  assert(std::equal(b.begin(), b.end(), nums.begin()));
+  b.check();
+
+  b.clear();
+  assert(b.empty() && b.begin() == b.end());
+  for (int i = 0; i < 1000; ++i) b.insert(random_int());
+  b.check();
+}
+
+// 副本与原树相同，之后互不影响
+void copy_test() {
+  RBTree a;
+  std::set<int> s;
+  for (int i = 0; i < 20000; ++i) {
+    int x = random_int();
+    assert(a.insert(x) == s.insert(x).second);
+  }
+  RBTree b(a);
+  b.check();
+  std::vector<int> expect(s.begin(), s.end());
+  assert(std::vector<int>(b.begin(), b.end()) == expect);
+  for (int i = 0; i < 1000; ++i) b.remove(random_int());
+  b.insert(0);
+  b.check();
+  assert(std::vector<int>(a.begin(), a.end()) == expect);
+  b = a;
+  b.check();
+  assert(std::vector<int>(b.begin(), b.end()) == expect);
+  RBTree empty;
+  b = empty;
+  assert(b.empty());
+}
+
+#ifdef RBTREE_STATS
+void stats_test() {
+  {
+    // 插入 3 时父亲、节点都是右孩子，RR 旋转一次
+    RBTree rbtree;
+    rbtree.insert(1);
+    rbtree.insert(2);
+    rbtree.insert(3);
+    const RBTreeStats& st = rbtree.stats();
+    assert(st.inserts == 3 && st.rotations == 1);
+    assert(st.insert_cases[int(RBTreeStats::InsertCase::kRR)] == 1);
+    assert(st.insert_fix_loops == 1);
+    assert(st.allocations == 3 && st.allocated_bytes == 3 * sizeof(Node));
+    rbtree.reset_stats();
+    assert(rbtree.find(2) != nullptr && rbtree.find(0) == nullptr);
+    // 2 在根，命中时比较两次；0 经过 2 和 1，每个节点比较一次
+    assert(st.finds == 2 && st.depth[1] == 1 && st.depth[2] == 1);
+    assert(st.compares == 2 + 2);
+  }
+  {
+    RBTree rbtree;
+    std::set<int> s;
+    for (int i = 0; i < 20000; ++i) {
+      int x = random_int();
+      if (i % 3 == 2) {
+        assert(rbtree.remove(x) == (s.erase(x) == 1));
+      } else {
+        assert(rbtree.insert(x) == s.insert(x).second);
+      }
+    }
+    rbtree.check();
+    const RBTreeStats& st = rbtree.stats();
+    const uint64_t* ic = st.insert_cases;
+    const uint64_t* rc = st.remove_cases;
+    // 每次旋转都属于一种情形
+    assert(st.rotations == ic[1] + ic[2] + ic[3] + ic[4] + rc[0] + rc[2] + rc[3]);
+    // insert_fix 每轮恰好一种情形；remove_fix 的红兄弟与其后的情形同属一轮
+    assert(st.insert_fix_loops == ic[0] + ic[1] + ic[2] + ic[3] + ic[4]);
+    assert(st.remove_fix_loops == rc[1] + rc[3]);
+    assert(st.allocations - st.deallocations == s.size());
+    assert(st.inserts - st.removes == s.size());
+    uint64_t exported = 0;
+    st.for_each([&](const char* name, uint64_t value) {
+      if (std::string(name) == "rotations") exported = value;
+    });
+    assert(exported == st.rotations);
+    uint64_t finds = 0;
+    st.for_each_depth([&](int, uint64_t count) { finds += count; });
+    assert(finds == st.finds && st.mean_depth() > 1);
+
+    // 批量查找与逐个查找的比较次数、深度分布相同
+    std::vector<int> keys;
+    for (int i = 0; i < 1000; ++i) keys.push_back(random_int());
+    std::vector<Node*> nodes(keys.size());
+    rbtree.reset_stats();
+    for (int key : keys) rbtree.find(key);
+    RBTreeStats single = st;
+    rbtree.reset_stats();
+    rbtree.find_batch(keys.data(), keys.size(), nodes.data());
+    assert(st.finds == keys.size() && st.compares == single.compares);
+    assert(std::equal(st.depth, st.depth + RBTreeStats::kMaxDepth + 1,
+                      single.depth));
+  }
+}
+#endif
+
 int main() {
   insert_test();
   remove_test();
   batch_test();
+  sorted_build_test();
+  iterator_test();
+  hint_test();
+  find_batch_test();
+  move_clear_test();
+  copy_test();
+#ifdef RBTREE_STATS
+  stats_test();
+#endif
   return 0;
 }
\ No newline at end of file
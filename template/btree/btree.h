@@ -0,0 +1,802 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "template/define.h"
+#include "template/simd_search.h"
+
+/*
+B+ 树：
+  叶子保存全部值，通过 prev/next 串成双向链表，迭代器为（叶子，下标）；
+  内部节点保存 count 个 key 和 count + 1 个孩子，key 是孩子子树的上界：
+    孩子 i 中的值 <= keys[i] < 孩子 i + 1 中的值；删除值之后 key 仍然是上界，不需要更新。
+  节点按 kNodeBytes（4 个缓存行）确定容量并按缓存行对齐，int 的叶子 58 个值、内部节点 21 个孩子，
+  1e7 个 int 只有 5 到 6 层，而红黑树约 25 层、每层一次依赖的访存。
+  节点内查找数出小于 key 的个数作为下标，32/64 位整数（含无符号）与 float/double 配合
+  std::less 时用 SIMD 整段比较（见 simd_search.h），其它类型二分查找。除根以外的节点至少半满，删除时先向兄弟借，借不到再合并。
+与 RBTree<T, Comparator> 相同的接口，只用这部分的代码可以在两者之间互换：
+  insert / emplace / 带提示的 insert、remove、erase(const_iterator)、contains、
+  lower_bound / upper_bound / equal_range、begin / end、assign、clear、empty。
+与 RBTree 的差别：
+  值在节点之间移动，指针和迭代器在下一次修改前有效；RBTree 的节点指针一直有效。
+  find 返回 const T*，RBTree::find 返回 Node*（值为 node->value）；
+  没有 erase(Node*)、iterator_to，try_emplace 返回迭代器而不是 Node*。
+  size() 总是可用，RBTree 需要 OrderStatistic；没有 rank/select、增强数据和统计策略。
+  不可拷贝，没有 join/split、集合运算、批量查找和 freeze。
+  内部节点保存值的副本，T 需要可拷贝。
+*/
+template <class T, class Comparator = std::less<T>,
+          class Allocator = std::allocator<T>>
+  requires KeyComparator<Comparator, T>
+class BTree {
+ public:
+  static constexpr size_t kNodeBytes = 256;
+  static constexpr size_t kLeafSlots =
+      std::max<size_t>(4, (kNodeBytes - 3 * sizeof(void*)) / sizeof(T));
+  static constexpr size_t kInnerSlots = std::max<size_t>(
+      4, (kNodeBytes - 2 * sizeof(void*)) / (sizeof(T) + sizeof(void*)));
+
+ private:
+  struct NodeBase {
+    uint32_t count = 0;
+  };
+  // 值的生命周期由树手动管理，只有 [0, count) 是构造好的
+  struct alignas(64) Leaf : NodeBase {
+    Leaf* prev = nullptr;
+    Leaf* next = nullptr;
+    union {
+      T keys[kLeafSlots];
+    };
+    Leaf() {}
+    ~Leaf() {}
+  };
+  struct alignas(64) Inner : NodeBase {
+    union {
+      T keys[kInnerSlots];
+    };
+    NodeBase* children[kInnerSlots + 1];
+    Inner() {}
+    ~Inner() {}
+  };
+
+ public:
+  using value_type = T;
+  using size_type = size_t;
+  using allocator_type = Allocator;
+
+  // 双向迭代器，end() 为（空，0），--end() 得到最大值。值不可修改。
+  class const_iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return leaf_->keys[index_]; }
+    pointer operator->() const { return &leaf_->keys[index_]; }
+    const_iterator& operator++() {
+      if (++index_ == leaf_->count) {
+        leaf_ = leaf_->next;
+        index_ = 0;
+      }
+      return *this;
+    }
+    const_iterator& operator--() {
+      if (leaf_ == nullptr) {
+        leaf_ = tree_->last_;
+        index_ = leaf_->count;
+      } else if (index_ == 0) {
+        leaf_ = leaf_->prev;
+        index_ = leaf_->count;
+      }
+      --index_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+    const_iterator operator--(int) {
+      const_iterator old = *this;
+      --*this;
+      return old;
+    }
+    bool operator==(const const_iterator& other) const {
+      return leaf_ == other.leaf_ && index_ == other.index_;
+    }
+
+   private:
+    friend class BTree;
+    const_iterator(const BTree* tree, Leaf* leaf, size_t index)
+        : tree_(tree), leaf_(leaf), index_(static_cast<uint32_t>(index)) {}
+
+    const BTree* tree_ = nullptr;
+    Leaf* leaf_ = nullptr;
+    uint32_t index_ = 0;
+  };
+  using iterator = const_iterator;
+
+  BTree() = default;
+  explicit BTree(const Allocator& alloc)
+      : leaf_alloc_(alloc), inner_alloc_(alloc) {}
+  explicit BTree(const Comparator& comp, const Allocator& alloc = Allocator())
+      : comp_(comp), leaf_alloc_(alloc), inner_alloc_(alloc) {}
+  // [first, last) 需按比较器严格升序，O(n) 构建
+  template <std::forward_iterator It>
+  BTree(sorted_unique_t, It first, It last,
+        const Allocator& alloc = Allocator())
+      : leaf_alloc_(alloc), inner_alloc_(alloc) {
+    assign(sorted_unique, first, last);
+  }
+  BTree(const BTree&) = delete;
+  BTree& operator=(const BTree&) = delete;
+
+  // 不存在时返回空指针
+  auto find(const T& key) const -> const T* { return find<T>(key); }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  auto find(const K& key) const -> const T*;
+  bool contains(const T& key) const { return find(key) != nullptr; }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  bool contains(const K& key) const {
+    return find(key) != nullptr;
+  }
+  // 已存在相等的值时不插入，返回false；只有插入时才拷贝（移动）val
+  bool insert(const T& val) { return try_emplace(val, val).second; }
+  bool insert(T&& val) { return try_emplace(val, std::move(val)).second; }
+  template <class... Args>
+  bool emplace(Args&&... args) {
+    T val(std::forward<Args>(args)...);
+    return try_emplace(val, std::move(val)).second;
+  }
+  // 只查找一次：不存在与 key 相等的值时，用 args 构造值插入。
+  // 返回与 key 相等的值的位置以及是否发生了插入；未插入时 args 不会被使用
+  template <class K, class... Args>
+    requires LookupKey<Comparator, K, T>
+  auto try_emplace(const K& key, Args&&... args)
+      -> std::pair<const_iterator, bool>;
+  // 与 RBTree 接口一致；从根下降只需 O(log_B n) 次缓存行访问，hint 不参与查找
+  auto insert(const_iterator, const T& val) -> const_iterator {
+    return try_emplace(val, val).first;
+  }
+  auto insert(const_iterator, T&& val) -> const_iterator {
+    return try_emplace(val, std::move(val)).first;
+  }
+  bool remove(const T& key) { return remove<T>(key); }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  bool remove(const K& key) {
+    return erase_key(key).second;
+  }
+  // 返回被删除值的下一个位置
+  auto erase(const_iterator pos) -> const_iterator {
+    return pos == end() ? end() : erase_key(*pos).first;
+  }
+
+  // 清空后由有序无重复区间重新构建，叶子填满，O(n)
+  template <std::forward_iterator It>
+  void assign(sorted_unique_t, It first, It last);
+  void clear() noexcept;
+
+  auto begin() const -> const_iterator { return {this, first_, 0}; }
+  auto end() const -> const_iterator { return {this, nullptr, 0}; }
+  // 第一个 >= key 的位置
+  auto lower_bound(const T& key) const -> const_iterator {
+    return lower_bound<T>(key);
+  }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  auto lower_bound(const K& key) const -> const_iterator;
+  // 第一个 > key 的位置
+  auto upper_bound(const T& key) const -> const_iterator {
+    return upper_bound<T>(key);
+  }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  auto upper_bound(const K& key) const -> const_iterator {
+    const_iterator it = lower_bound(key);
+    if (it != end() && !comp_(key, *it)) ++it;
+    return it;
+  }
+  auto equal_range(const T& key) const
+      -> std::pair<const_iterator, const_iterator> {
+    return equal_range<T>(key);
+  }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  auto equal_range(const K& key) const
+      -> std::pair<const_iterator, const_iterator> {
+    const_iterator lo = lower_bound(key);
+    const_iterator hi = lo;
+    if (hi != end() && !comp_(key, *hi)) ++hi;
+    return {lo, hi};
+  }
+  bool empty() const noexcept { return size_ == 0; }
+  size_t size() const noexcept { return size_; }
+  // 叶子之上的层数
+  size_t height() const noexcept { return height_; }
+
+  // for debug
+  void check() const;
+
+  Allocator get_allocator() const { return Allocator(leaf_alloc_); }
+
+  ~BTree() { clear(); }
+
+ private:
+  using LeafAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Leaf>;
+  using InnerAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Inner>;
+  using LeafAllocTraits = std::allocator_traits<LeafAllocator>;
+  using InnerAllocTraits = std::allocator_traits<InnerAllocator>;
+
+  // 非根节点的最少 key 个数，保证相邻的两个节点合并后放得下
+  static constexpr size_t kMinLeaf = kLeafSlots / 2;
+  static constexpr size_t kMinInner = (kInnerSlots - 1) / 2;
+  // 非根的内部节点至少 3 个孩子，2^64 个值也不会超过这个高度
+  static constexpr size_t kMaxHeight = 48;
+
+  static auto as_leaf(NodeBase* node) noexcept -> Leaf* {
+    return static_cast<Leaf*>(node);
+  }
+  static auto as_inner(NodeBase* node) noexcept -> Inner* {
+    return static_cast<Inner*>(node);
+  }
+
+  // 节点内小于 key 的个数
+  template <class K>
+  size_t search(const T* keys, size_t count, const K& key) const {
+    if constexpr (SimdSearchable<T, Comparator> && std::same_as<K, T>) {
+      return simd_count_less<T, Comparator>(keys, count, key);
+    } else {
+      return std::lower_bound(keys, keys + count, key, comp_) - keys;
+    }
+  }
+  // 从根下降到 key 所在的叶子，path[h] / slot[h] 记录第 h 层（0为叶子的父亲）
+  // 经过的内部节点和孩子下标
+  template <class K>
+  auto descend(const K& key, Inner** path, size_t* slot) const -> Leaf*;
+
+  // 在 [0, count) 的 pos 处构造新值，要求还有空位
+  template <class... Args>
+  static void insert_at(T* keys, size_t count, size_t pos, Args&&... args);
+  static void erase_at(T* keys, size_t count, size_t pos) noexcept;
+  // 把 [src, src + n) 移动到未构造的 dst，并析构原来的值
+  static void relocate(T* src, size_t n, T* dst) noexcept;
+
+  void insert_child(Inner* node, size_t pos, T&& key, NodeBase* child);
+  // 满的内部节点对半分裂，右半部分移入空节点 right，返回需要上移的中间 key
+  auto split_inner(Inner* node, Inner* right) -> T;
+
+  template <class K>
+  auto erase_key(const K& key) -> std::pair<const_iterator, bool>;
+  // parent 的第 i 个孩子不足半满：向兄弟借一个值，否则与兄弟合并。
+  // 叶子的版本同时修正指向该层的迭代器位置
+  void fix_leaf(Inner* parent, size_t i, Leaf*& leaf, size_t& pos);
+  void fix_inner(Inner* parent, size_t i);
+  // 把第 j + 1 个孩子并入第 j 个，删除 keys[j]
+  void merge_leaves(Inner* parent, size_t j);
+  void merge_inners(Inner* parent, size_t j);
+  void remove_child(Inner* parent, size_t j) noexcept;
+
+  auto new_leaf() -> Leaf*;
+  auto new_inner() -> Inner*;
+  void free_leaf(Leaf* leaf) noexcept;
+  void free_inner(Inner* inner) noexcept;
+  void destroy_subtree(NodeBase* node, size_t height) noexcept;
+
+  // 返回子树中值的个数，子树中的值都在 (lo, hi] 内，空指针表示无界
+  size_t check_subtree(NodeBase* node, size_t height, const T* lo,
+                       const T* hi, Leaf*& prev) const;
+
+  NodeBase* root_ = nullptr;
+  Leaf* first_ = nullptr;
+  Leaf* last_ = nullptr;
+  size_t size_ = 0;
+  size_t height_ = 0;
+  [[no_unique_address]] Comparator comp_;
+  [[no_unique_address]] LeafAllocator leaf_alloc_;
+  [[no_unique_address]] InnerAllocator inner_alloc_;
+};
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+template <class K>
+auto BTree<T, U, A>::descend(const K& key, Inner** path, size_t* slot) const
+    -> Leaf* {
+  NodeBase* node = root_;
+  for (size_t h = height_; h > 0; --h) {
+    Inner* inner = as_inner(node);
+    size_t i = search(inner->keys, inner->count, key);
+    if (path != nullptr) {
+      path[h - 1] = inner;
+      slot[h - 1] = i;
+    }
+    node = inner->children[i];
+  }
+  return as_leaf(node);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+auto BTree<T, U, A>::find(const K& key) const -> const T* {
+  if (root_ == nullptr) return nullptr;
+  Leaf* leaf = descend(key, nullptr, nullptr);
+  size_t pos = search(leaf->keys, leaf->count, key);
+  return pos < leaf->count && !comp_(key, leaf->keys[pos]) ? &leaf->keys[pos]
+                                                          : nullptr;
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+auto BTree<T, U, A>::lower_bound(const K& key) const -> const_iterator {
+  if (root_ == nullptr) return end();
+  Leaf* leaf = descend(key, nullptr, nullptr);
+  size_t pos = search(leaf->keys, leaf->count, key);
+  // key 大于叶子中的所有值时，下一个叶子的第一个值大于上界，也就大于 key
+  if (pos == leaf->count) return {this, leaf->next, 0};
+  return {this, leaf, pos};
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+template <class K, class... Args>
+  requires LookupKey<U, K, T>
+auto BTree<T, U, A>::try_emplace(const K& key, Args&&... args)
+    -> std::pair<const_iterator, bool> {
+  if (root_ == nullptr) {
+    Leaf* leaf = new_leaf();
+    try {
+      std::construct_at(leaf->keys, std::forward<Args>(args)...);
+    } catch (...) {
+      free_leaf(leaf);
+      throw;
+    }
+    leaf->count = 1;
+    root_ = first_ = last_ = leaf;
+    size_ = 1;
+    return {{this, leaf, 0}, true};
+  }
+  Inner* path[kMaxHeight];
+  size_t slot[kMaxHeight];
+  Leaf* leaf = descend(key, path, slot);
+  size_t pos = search(leaf->keys, leaf->count, key);
+  if (pos < leaf->count && !comp_(key, leaf->keys[pos])) {
+    return {{this, leaf, pos}, false};
+  }
+  if (leaf->count < kLeafSlots) {
+    insert_at(leaf->keys, leaf->count, pos, std::forward<Args>(args)...);
+    ++leaf->count;
+    ++size_;
+    return {{this, leaf, pos}, true};
+  }
+
+  // 叶子已满：先构造新值和上移的 key、申请好全部新节点，之后的修改不再抛出异常。
+  // 分裂后左叶子的最大值是新叶子左侧兄弟的上界
+  constexpr size_t mid = kLeafSlots / 2;
+  T val(std::forward<Args>(args)...);
+  T sep = pos == mid ? val : leaf->keys[mid - 1];
+  // 从叶子的父亲开始连续满的内部节点都要分裂，全部分裂时还需要新的根
+  size_t splits = 0;
+  while (splits < height_ && path[splits]->count == kInnerSlots) ++splits;
+  Inner* spare[kMaxHeight];
+  size_t allocated = 0;
+  Leaf* right = new_leaf();
+  try {
+    for (; allocated < splits + (splits == height_); ++allocated) {
+      spare[allocated] = new_inner();
+    }
+  } catch (...) {
+    while (allocated > 0) free_inner(spare[--allocated]);
+    free_leaf(right);
+    throw;
+  }
+
+  // 后一半移入新叶子，再插入到对应的一侧
+  relocate(leaf->keys + mid, kLeafSlots - mid, right->keys);
+  right->count = kLeafSlots - mid;
+  leaf->count = mid;
+  right->prev = leaf;
+  right->next = leaf->next;
+  (leaf->next != nullptr ? leaf->next->prev : last_) = right;
+  leaf->next = right;
+  const_iterator result;
+  if (pos <= mid) {
+    insert_at(leaf->keys, leaf->count, pos, std::move(val));
+    ++leaf->count;
+    result = {this, leaf, pos};
+  } else {
+    pos -= mid;
+    insert_at(right->keys, right->count, pos, std::move(val));
+    ++right->count;
+    result = {this, right, pos};
+  }
+  ++size_;
+
+  // 逐层向上插入新节点和它左侧兄弟的上界，满的内部节点继续分裂
+  NodeBase* child = right;
+  for (size_t h = 0; h < height_; ++h) {
+    Inner* parent = path[h];
+    size_t i = slot[h];
+    if (parent->count < kInnerSlots) {
+      insert_child(parent, i, std::move(sep), child);
+      return {result, true};
+    }
+    constexpr size_t inner_mid = kInnerSlots / 2;
+    Inner* sibling = spare[h];
+    T promoted = split_inner(parent, sibling);
+    if (i <= inner_mid) {
+      insert_child(parent, i, std::move(sep), child);
+    } else {
+      insert_child(sibling, i - inner_mid - 1, std::move(sep), child);
+    }
+    sep = std::move(promoted);
+    child = sibling;
+  }
+  assert(height_ + 1 < kMaxHeight);
+  Inner* root = spare[height_];
+  std::construct_at(root->keys, std::move(sep));
+  root->count = 1;
+  root->children[0] = root_;
+  root->children[1] = child;
+  root_ = root;
+  ++height_;
+  return {result, true};
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+template <class... Args>
+void BTree<T, U, A>::insert_at(T* keys, size_t count, size_t pos,
+                               Args&&... args) {
+  if (pos == count) {
+    std::construct_at(keys + count, std::forward<Args>(args)...);
+    return;
+  }
+  T val(std::forward<Args>(args)...);
+  std::construct_at(keys + count, std::move(keys[count - 1]));
+  std::move_backward(keys + pos, keys + count - 1, keys + count);
+  keys[pos] = std::move(val);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::erase_at(T* keys, size_t count, size_t pos) noexcept {
+  std::move(keys + pos + 1, keys + count, keys + pos);
+  std::destroy_at(keys + count - 1);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::relocate(T* src, size_t n, T* dst) noexcept {
+  std::uninitialized_move(src, src + n, dst);
+  std::destroy(src, src + n);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::insert_child(Inner* node, size_t pos, T&& key,
+                                  NodeBase* child) {
+  insert_at(node->keys, node->count, pos, std::move(key));
+  std::copy_backward(node->children + pos + 1,
+                     node->children + node->count + 1,
+                     node->children + node->count + 2);
+  node->children[pos + 1] = child;
+  ++node->count;
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+auto BTree<T, U, A>::split_inner(Inner* node, Inner* right) -> T {
+  constexpr size_t mid = kInnerSlots / 2;
+  relocate(node->keys + mid + 1, kInnerSlots - mid - 1, right->keys);
+  std::copy(node->children + mid + 1, node->children + kInnerSlots + 1,
+            right->children);
+  right->count = kInnerSlots - mid - 1;
+  T promoted(std::move(node->keys[mid]));
+  std::destroy_at(node->keys + mid);
+  node->count = mid;
+  return promoted;
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+template <class K>
+auto BTree<T, U, A>::erase_key(const K& key)
+    -> std::pair<const_iterator, bool> {
+  if (root_ == nullptr) return {end(), false};
+  Inner* path[kMaxHeight];
+  size_t slot[kMaxHeight];
+  Leaf* leaf = descend(key, path, slot);
+  size_t pos = search(leaf->keys, leaf->count, key);
+  if (pos == leaf->count || comp_(key, leaf->keys[pos])) return {end(), false};
+  // key 可能引用被删除的值，之后不再使用
+  erase_at(leaf->keys, leaf->count, pos);
+  --leaf->count;
+  --size_;
+
+  // 自底向上修复不足半满的节点，(leaf, pos) 始终指向被删除值的下一个值
+  if (height_ > 0 && leaf->count < kMinLeaf) {
+    fix_leaf(path[0], slot[0], leaf, pos);
+    for (size_t h = 1; h < height_ && path[h - 1]->count < kMinInner; ++h) {
+      fix_inner(path[h], slot[h]);
+    }
+  }
+  if (height_ > 0 && root_->count == 0) {
+    Inner* root = as_inner(root_);
+    root_ = root->children[0];
+    free_inner(root);
+    --height_;
+  } else if (height_ == 0 && root_->count == 0) {
+    free_leaf(as_leaf(root_));
+    root_ = first_ = last_ = nullptr;
+    return {end(), true};
+  }
+  if (pos == leaf->count) return {{this, leaf->next, 0}, true};
+  return {{this, leaf, pos}, true};
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::fix_leaf(Inner* parent, size_t i, Leaf*& leaf,
+                              size_t& pos) {
+  Leaf* left = i > 0 ? as_leaf(parent->children[i - 1]) : nullptr;
+  Leaf* right = i < parent->count ? as_leaf(parent->children[i + 1]) : nullptr;
+  if (left != nullptr && left->count > kMinLeaf) {
+    insert_at(leaf->keys, leaf->count, 0,
+              std::move(left->keys[left->count - 1]));
+    ++leaf->count;
+    std::destroy_at(left->keys + --left->count);
+    parent->keys[i - 1] = left->keys[left->count - 1];
+    ++pos;
+  } else if (right != nullptr && right->count > kMinLeaf) {
+    std::construct_at(leaf->keys + leaf->count, std::move(right->keys[0]));
+    ++leaf->count;
+    erase_at(right->keys, right->count--, 0);
+    parent->keys[i] = leaf->keys[leaf->count - 1];
+  } else if (left != nullptr) {
+    pos += left->count;
+    merge_leaves(parent, i - 1);
+    leaf = left;
+  } else {
+    merge_leaves(parent, i);
+  }
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::fix_inner(Inner* parent, size_t i) {
+  Inner* node = as_inner(parent->children[i]);
+  Inner* left = i > 0 ? as_inner(parent->children[i - 1]) : nullptr;
+  Inner* right = i < parent->count ? as_inner(parent->children[i + 1]) : nullptr;
+  if (left != nullptr && left->count > kMinInner) {
+    // 左兄弟的最后一个孩子移到 node 最前，上界随之轮换
+    insert_at(node->keys, node->count, 0, std::move(parent->keys[i - 1]));
+    std::copy_backward(node->children, node->children + node->count + 1,
+                       node->children + node->count + 2);
+    node->children[0] = left->children[left->count];
+    ++node->count;
+    parent->keys[i - 1] = std::move(left->keys[left->count - 1]);
+    std::destroy_at(left->keys + --left->count);
+  } else if (right != nullptr && right->count > kMinInner) {
+    std::construct_at(node->keys + node->count, std::move(parent->keys[i]));
+    node->children[++node->count] = right->children[0];
+    parent->keys[i] = std::move(right->keys[0]);
+    erase_at(right->keys, right->count, 0);
+    std::copy(right->children + 1, right->children + right->count + 1,
+              right->children);
+    --right->count;
+  } else if (left != nullptr) {
+    merge_inners(parent, i - 1);
+  } else {
+    merge_inners(parent, i);
+  }
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::merge_leaves(Inner* parent, size_t j) {
+  Leaf* left = as_leaf(parent->children[j]);
+  Leaf* right = as_leaf(parent->children[j + 1]);
+  relocate(right->keys, right->count, left->keys + left->count);
+  left->count += right->count;
+  right->count = 0;
+  left->next = right->next;
+  (right->next != nullptr ? right->next->prev : last_) = left;
+  remove_child(parent, j);
+  free_leaf(right);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::merge_inners(Inner* parent, size_t j) {
+  Inner* left = as_inner(parent->children[j]);
+  Inner* right = as_inner(parent->children[j + 1]);
+  // 左侧最后一个孩子的上界从父节点下移
+  std::construct_at(left->keys + left->count, std::move(parent->keys[j]));
+  relocate(right->keys, right->count, left->keys + left->count + 1);
+  std::copy(right->children, right->children + right->count + 1,
+            left->children + left->count + 1);
+  left->count += right->count + 1;
+  right->count = 0;
+  remove_child(parent, j);
+  free_inner(right);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::remove_child(Inner* parent, size_t j) noexcept {
+  erase_at(parent->keys, parent->count, j);
+  std::copy(parent->children + j + 2, parent->children + parent->count + 1,
+            parent->children + j + 1);
+  --parent->count;
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+template <std::forward_iterator It>
+void BTree<T, U, A>::assign(sorted_unique_t, It first, It last) {
+  assert(std::adjacent_find(first, last, [this](const T& a, const T& b) {
+           return !comp_(a, b);
+         }) == last);
+  clear();
+  size_t n = std::distance(first, last);
+  if (n == 0) return;
+  // 每层的节点个数取满，再把余数平均分给各个节点，保证都不少于半满
+  struct Built {
+    NodeBase* node;
+    const T* max;
+  };
+  std::vector<Built> level;
+  size_t leaves = (n + kLeafSlots - 1) / kLeafSlots;
+  for (size_t k = 0; k < leaves; ++k) {
+    Leaf* leaf = new_leaf();
+    size_t count = n / leaves + (k < n % leaves);
+    for (size_t j = 0; j < count; ++j, ++first) {
+      std::construct_at(leaf->keys + j, *first);
+    }
+    leaf->count = count;
+    leaf->prev = last_;
+    (last_ != nullptr ? last_->next : first_) = leaf;
+    last_ = leaf;
+    level.push_back({leaf, leaf->keys + count - 1});
+  }
+  size_ = n;
+  while (level.size() > 1) {
+    std::vector<Built> upper;
+    size_t m = level.size();
+    size_t nodes = (m + kInnerSlots) / (kInnerSlots + 1);
+    for (size_t k = 0, c = 0; k < nodes; ++k) {
+      Inner* inner = new_inner();
+      size_t count = m / nodes + (k < m % nodes);
+      for (size_t j = 0; j < count; ++j, ++c) {
+        inner->children[j] = level[c].node;
+        if (j + 1 < count) std::construct_at(inner->keys + j, *level[c].max);
+      }
+      inner->count = count - 1;
+      upper.push_back({inner, level[c - 1].max});
+    }
+    level = std::move(upper);
+    ++height_;
+  }
+  root_ = level[0].node;
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::clear() noexcept {
+  if (root_ == nullptr) return;
+  destroy_subtree(root_, height_);
+  root_ = first_ = last_ = nullptr;
+  size_ = height_ = 0;
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::destroy_subtree(NodeBase* node, size_t height) noexcept {
+  if (height == 0) {
+    Leaf* leaf = as_leaf(node);
+    std::destroy(leaf->keys, leaf->keys + leaf->count);
+    free_leaf(leaf);
+    return;
+  }
+  Inner* inner = as_inner(node);
+  for (size_t i = 0; i <= inner->count; ++i) {
+    destroy_subtree(inner->children[i], height - 1);
+  }
+  std::destroy(inner->keys, inner->keys + inner->count);
+  free_inner(inner);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+auto BTree<T, U, A>::new_leaf() -> Leaf* {
+  Leaf* leaf = LeafAllocTraits::allocate(leaf_alloc_, 1);
+  return std::construct_at(leaf);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+auto BTree<T, U, A>::new_inner() -> Inner* {
+  Inner* inner = InnerAllocTraits::allocate(inner_alloc_, 1);
+  return std::construct_at(inner);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::free_leaf(Leaf* leaf) noexcept {
+  std::destroy_at(leaf);
+  LeafAllocTraits::deallocate(leaf_alloc_, leaf, 1);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::free_inner(Inner* inner) noexcept {
+  std::destroy_at(inner);
+  InnerAllocTraits::deallocate(inner_alloc_, inner, 1);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+void BTree<T, U, A>::check() const {
+  if (root_ == nullptr) {
+    assert(first_ == nullptr && last_ == nullptr);
+    assert(size_ == 0 && height_ == 0);
+    return;
+  }
+  Leaf* prev = nullptr;
+  assert(check_subtree(root_, height_, nullptr, nullptr, prev) == size_);
+  assert(prev == last_ && last_->next == nullptr && first_->prev == nullptr);
+}
+
+template <class T, class U, class A>
+  requires KeyComparator<U, T>
+size_t BTree<T, U, A>::check_subtree(NodeBase* node, size_t height,
+                                     const T* lo, const T* hi,
+                                     Leaf*& prev) const {
+  if (node != root_) {
+    assert(node->count >= (height == 0 ? kMinLeaf : kMinInner));
+  }
+  const T* keys =
+      height == 0 ? as_leaf(node)->keys : as_inner(node)->keys;
+  for (size_t i = 0; i < node->count; ++i) {
+    assert(lo == nullptr || comp_(*lo, keys[i]));
+    assert(hi == nullptr || !comp_(*hi, keys[i]));
+    assert(i == 0 || comp_(keys[i - 1], keys[i]));
+  }
+  if (height == 0) {
+    Leaf* leaf = as_leaf(node);
+    assert(leaf->count > 0 && leaf->count <= kLeafSlots);
+    assert(leaf->prev == prev);
+    assert((prev != nullptr ? prev->next : first_) == leaf);
+    prev = leaf;
+    return leaf->count;
+  }
+  Inner* inner = as_inner(node);
+  assert(inner->count > 0 && inner->count <= kInnerSlots);
+  size_t total = 0;
+  for (size_t i = 0; i <= inner->count; ++i) {
+    total += check_subtree(inner->children[i], height - 1,
+                           i == 0 ? lo : &keys[i - 1],
+                           i == inner->count ? hi : &keys[i], prev);
+  }
+  return total;
+}
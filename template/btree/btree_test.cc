@@ -0,0 +1,345 @@
+#include "template/btree/btree.h"
+
+#include "template/rbtree/rbtree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+std::random_device rd;
+std::mt19937 gen(rd());
+std::uniform_int_distribution<> dis(1, 1000000);
+int random_int() { return dis(gen); }
+
+// 统计存活对象个数，检查值的构造和析构成对出现
+struct Counted {
+  static inline int alive = 0;
+  int key;
+
+  Counted(int k) : key(k) { ++alive; }
+  Counted(const Counted& other) : key(other.key) { ++alive; }
+  Counted(Counted&& other) noexcept : key(other.key) { ++alive; }
+  Counted& operator=(const Counted&) = default;
+  Counted& operator=(Counted&&) noexcept = default;
+  ~Counted() { --alive; }
+  bool operator<(const Counted& other) const { return key < other.key; }
+};
+
+void basic_test() {
+  BTree<int> tree;
+  assert(tree.empty() && tree.find(1) == nullptr && tree.begin() == tree.end());
+  assert(!tree.remove(1));
+  std::set<int> expect;
+  for (int i = 0; i < 200000; ++i) {
+    int temp = random_int() % 20000;
+    if (i % 3 == 0) {
+      assert(tree.remove(temp) == (expect.erase(temp) == 1));
+    } else {
+      assert(tree.insert(temp) == expect.insert(temp).second);
+    }
+    if (i % 10000 == 0) tree.check();
+  }
+  tree.check();
+  assert(tree.size() == expect.size());
+  assert(std::equal(tree.begin(), tree.end(), expect.begin(), expect.end()));
+  for (int i = -1; i <= 20000; ++i) {
+    assert((tree.find(i) != nullptr) == expect.count(i));
+    assert(tree.find(i) == nullptr || *tree.find(i) == i);
+    auto lower = tree.lower_bound(i);
+    auto expect_lower = expect.lower_bound(i);
+    assert(lower == tree.end() ? expect_lower == expect.end()
+                               : *lower == *expect_lower);
+    auto upper = tree.upper_bound(i);
+    auto expect_upper = expect.upper_bound(i);
+    assert(upper == tree.end() ? expect_upper == expect.end()
+                               : *upper == *expect_upper);
+    auto [lo, hi] = tree.equal_range(i);
+    assert(lo == lower && hi == upper);
+  }
+
+  // 全部删除后回到空树
+  for (int v : expect) assert(tree.remove(v));
+  tree.check();
+  assert(tree.empty() && tree.height() == 0);
+}
+
+void order_test() {
+  // 顺序、逆序插入和删除，分别只触发一侧的分裂、借用与合并
+  BTree<int> tree;
+  constexpr int n = 100000;
+  for (int i = 0; i < n; ++i) tree.insert(i);
+  tree.check();
+  for (int i = 0; i < n; i += 2) tree.remove(i);
+  tree.check();
+  for (int i = n - 1; i >= 0; i -= 2) tree.remove(i);
+  tree.check();
+  assert(tree.empty());
+  for (int i = n; i > 0; --i) tree.insert(tree.end(), i);
+  tree.check();
+  assert(tree.size() == n && *tree.begin() == 1 && *--tree.end() == n);
+}
+
+void iterator_test() {
+  BTree<int> tree;
+  std::set<int> expect;
+  for (int i = 0; i < 5000; ++i) {
+    int temp = random_int();
+    tree.insert(temp);
+    expect.insert(temp);
+  }
+  assert(std::equal(tree.begin(), tree.end(), expect.begin(), expect.end()));
+  // 反向遍历
+  auto it = tree.end();
+  for (auto rit = expect.rbegin(); rit != expect.rend(); ++rit) {
+    assert(*--it == *rit);
+  }
+  assert(it == tree.begin());
+  static_assert(std::bidirectional_iterator<BTree<int>::const_iterator>);
+
+  // erase 返回下一个位置，遍历中删除所有奇数
+  for (auto cur = tree.begin(); cur != tree.end();) {
+    if (*cur % 2 != 0) {
+      int next = *expect.upper_bound(*cur);
+      cur = tree.erase(cur);
+      assert(cur == tree.end() || *cur == next);
+    } else {
+      ++cur;
+    }
+  }
+  tree.check();
+  std::erase_if(expect, [](int v) { return v % 2 != 0; });
+  assert(std::equal(tree.begin(), tree.end(), expect.begin(), expect.end()));
+  assert(tree.erase(tree.end()) == tree.end());
+}
+
+void sorted_build_test() {
+  for (int n : {0, 1, 57, 58, 59, 1000, 100000}) {
+    std::vector<int> values(n);
+    for (int i = 0; i < n; ++i) values[i] = i * 3;
+    BTree<int> tree(sorted_unique, values.begin(), values.end());
+    tree.check();
+    assert(tree.size() == values.size());
+    assert(std::equal(tree.begin(), tree.end(), values.begin(), values.end()));
+    // 构建后继续修改
+    for (int i = 0; i < n; i += 2) tree.insert(i * 3 + 1);
+    for (int i = 0; i < n; i += 3) tree.remove(i * 3);
+    tree.check();
+  }
+}
+
+void key_type_test() {
+  // 非 SIMD 路径：字符串与透明比较器
+  BTree<std::string, std::less<>> tree;
+  std::set<std::string, std::less<>> expect;
+  for (int i = 0; i < 30000; ++i) {
+    std::string temp = std::to_string(random_int() % 5000);
+    if (i % 3 == 0) {
+      assert(tree.remove(std::string_view(temp)) == (expect.erase(temp) == 1));
+    } else {
+      assert(tree.insert(temp) == expect.insert(temp).second);
+    }
+  }
+  tree.check();
+  assert(std::equal(tree.begin(), tree.end(), expect.begin(), expect.end()));
+  assert((tree.find(std::string_view("42")) != nullptr) == expect.contains("42"));
+
+  BTree<int, std::greater<int>> desc;
+  for (int i = 0; i < 10000; ++i) desc.insert(random_int());
+  desc.check();
+  assert(std::is_sorted(desc.begin(), desc.end(), std::greater<int>()));
+
+  BTree<float> floats;
+  for (int i = 0; i < 10000; ++i) floats.insert(i * 0.5f);
+  floats.check();
+  assert(floats.find(100.5f) != nullptr && floats.find(100.25f) == nullptr);
+  assert(*floats.lower_bound(100.25f) == 100.5f);
+}
+
+// SIMD 路径的各种数值类型：等差的值跨过 0（无符号数跨过最高位），逐个对照 std::set
+template <class T>
+void arithmetic_key_test(T first, T step) {
+  BTree<T> tree;
+  std::set<T> expect;
+  for (int i = 0; i < 5000; ++i) {
+    T x = first + step * T(random_int() % 10000);
+    assert(tree.insert(x) == expect.insert(x).second);
+  }
+  tree.check();
+  for (int i = -1; i <= 10000; ++i) {
+    for (T x : {first + step * T(i), first + step * T(i) + step / 2}) {
+      auto it = expect.lower_bound(x);
+      auto found = tree.lower_bound(x);
+      assert(it == expect.end() ? found == tree.end() : *found == *it);
+      assert((tree.find(x) != nullptr) == expect.contains(x));
+    }
+  }
+}
+
+// 值很大时节点只放得下最少的 4 个，树很高，频繁分裂与合并
+struct Wide {
+  int key;
+  char pad[60];
+  Wide(int k) : key(k) {}
+  bool operator<(const Wide& other) const { return key < other.key; }
+};
+
+void wide_key_test() {
+  static_assert(BTree<Wide>::kLeafSlots == 4 && BTree<Wide>::kInnerSlots == 4);
+  BTree<Wide> tree;
+  std::set<int> expect;
+  for (int i = 0; i < 50000; ++i) {
+    int temp = random_int() % 3000;
+    if (i % 2 == 0) {
+      assert(tree.remove(temp) == (expect.erase(temp) == 1));
+    } else {
+      assert(tree.insert(temp) == expect.insert(temp).second);
+    }
+    if (i % 1000 == 0) tree.check();
+  }
+  tree.check();
+  assert(tree.height() > 4);
+  assert(std::equal(tree.begin(), tree.end(), expect.begin(), expect.end(),
+                    [](const Wide& a, int b) { return a.key == b; }));
+}
+
+void lifetime_test() {
+  {
+    BTree<Counted> tree;
+    for (int i = 0; i < 20000; ++i) tree.emplace(random_int() % 10000);
+    for (int i = 0; i < 20000; ++i) tree.remove(random_int() % 10000);
+    tree.check();
+    // 内部节点保存值的副本，活着的对象不少于树中的值
+    assert(Counted::alive >= static_cast<int>(tree.size()));
+    tree.clear();
+    assert(Counted::alive == 0);
+    for (int i = 0; i < 1000; ++i) tree.insert(Counted(i));
+  }
+  assert(Counted::alive == 0);
+}
+
+// 构造时可以要求抛出异常
+struct Throwing {
+  int key;
+  Throwing(int k, bool fail) : key(k) {
+    if (fail) throw std::runtime_error("construct");
+  }
+  bool operator<(const Throwing& other) const { return key < other.key; }
+};
+// 剩余的申请次数用完后抛出 bad_alloc
+int alloc_budget = INT_MAX;
+template <class T>
+struct FailingAllocator {
+  using value_type = T;
+  FailingAllocator() = default;
+  template <class U>
+  FailingAllocator(const FailingAllocator<U>&) {}
+  T* allocate(size_t n) {
+    if (alloc_budget-- <= 0) throw std::bad_alloc();
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+  bool operator==(const FailingAllocator&) const = default;
+};
+
+// 构造值或申请节点失败时树保持不变
+void exception_test() {
+  BTree<Throwing> tree;
+  try {
+    tree.try_emplace(Throwing(1, false), 1, true);
+    assert(false);
+  } catch (const std::runtime_error&) {
+  }
+  assert(tree.empty() && tree.begin() == tree.end());
+  std::set<int> expect;
+  for (int i = 0; i < 20000; ++i) {
+    int key = random_int() % 20000;
+    bool fail = i % 2 == 0;
+    try {
+      bool inserted = tree.try_emplace(Throwing(key, false), key, fail).second;
+      assert(expect.insert(key).second == inserted);
+    } catch (const std::runtime_error&) {
+      assert(fail);
+    }
+    if (i % 1000 == 0) tree.check();
+  }
+  tree.check();
+  assert(tree.size() == expect.size());
+  assert(std::equal(tree.begin(), tree.end(), expect.begin(), expect.end(),
+                    [](const Throwing& a, int b) { return a.key == b; }));
+
+  BTree<int, std::less<int>, FailingAllocator<int>> alloc_tree;
+  expect.clear();
+  for (int i = 0; i < 20000; ++i) {
+    int key = random_int() % 20000;
+    // 叶子分裂最多需要 1 + 层数 + 1 个新节点
+    alloc_budget = random_int() % 4;
+    try {
+      bool inserted = alloc_tree.insert(key);
+      assert(inserted == expect.insert(key).second);
+    } catch (const std::bad_alloc&) {
+      assert(expect.count(key) == 0);
+    }
+    alloc_budget = INT_MAX;
+    if (i % 1000 == 0) alloc_tree.check();
+  }
+  alloc_tree.check();
+  assert(alloc_tree.size() == expect.size());
+  assert(std::equal(alloc_tree.begin(), alloc_tree.end(), expect.begin(),
+                    expect.end()));
+}
+
+// 只用两者相同的接口，BTree 与 RBTree 都能编译并得到相同的结果
+template <class Tree>
+void common_interface_test() {
+  Tree tree;
+  std::set<int> expect;
+  for (int i = 0; i < 20000; ++i) {
+    int temp = random_int() % 5000;
+    if (i % 3 == 0) {
+      assert(tree.remove(temp) == (expect.erase(temp) == 1));
+    } else {
+      assert(tree.insert(temp) == expect.insert(temp).second);
+    }
+  }
+  for (int i = 0; i < 5000; i += 2) {
+    assert(tree.contains(i) == (expect.count(i) == 1));
+    // erase 返回下一个位置
+    auto it = tree.lower_bound(i);
+    auto expect_it = expect.lower_bound(i);
+    if (it == tree.end()) continue;
+    auto next = tree.erase(it);
+    auto expect_next = expect.erase(expect_it);
+    assert(next == tree.end() ? expect_next == expect.end()
+                              : *next == *expect_next);
+  }
+  assert(tree.erase(tree.end()) == tree.end());
+  assert(std::equal(tree.begin(), tree.end(), expect.begin(), expect.end()));
+  tree.clear();
+  assert(tree.empty());
+}
+
+int main() {
+  basic_test();
+  order_test();
+  iterator_test();
+  sorted_build_test();
+  key_type_test();
+  arithmetic_key_test<int32_t>(-15000, 3);
+  arithmetic_key_test<uint32_t>(0x7fffffffu - 15000, 3);
+  arithmetic_key_test<int64_t>(-(int64_t(1) << 40), int64_t(1) << 28);
+  arithmetic_key_test<uint64_t>((uint64_t(1) << 63) - 15000, 3);
+  arithmetic_key_test<float>(-2500.0f, 0.5f);
+  arithmetic_key_test<double>(-2500.0, 0.5);
+  wide_key_test();
+  lifetime_test();
+  exception_test();
+  common_interface_test<BTree<int>>();
+  common_interface_test<RBTree<int>>();
+  return 0;
+}
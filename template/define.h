@@ -1,10 +1,30 @@
+#pragma once
+
 #include <concepts>
 
 template <typename T>
-concept Comparable = std::is_trivially_copyable_v<T> && requires(T a, T b) {
+concept Comparable = requires(const T& a, const T& b) {
   { a < b } -> std::same_as<bool>;
   { a > b } -> std::same_as<bool>;
   { a == b } -> std::same_as<bool>;
 };
 
+// 比较器在 T 上构成严格弱序，容器只通过比较器比较元素，不要求 T 自身可比较
+template <typename Comparator, typename T>
+concept KeyComparator =
+    std::strict_weak_order<const Comparator&, const T&, const T&>;
+
+// 比较器声明 is_transparent 时（如 std::less<>），查找接口可以直接使用
+// 与 T 可比较的其它类型，例如以 std::string_view 查找 std::string，不构造临时的 T
+template <class Comparator, class K, class T>
+concept LookupKey = std::same_as<K, T> || requires {
+  typename Comparator::is_transparent;
+};
+
 enum class Color { RED, BLACK };
+
+// 标记输入区间已按比较器严格升序排列（无重复），容器可以直接线性构建
+struct sorted_unique_t {
+  explicit sorted_unique_t() = default;
+};
+inline constexpr sorted_unique_t sorted_unique{};
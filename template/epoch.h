@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/*
+基于 epoch 的延迟回收，适用于多个读者、单个写者：
+读者在访问共享结构期间持有 pin() 返回的 Guard；写者把摘下的节点交给 retire，
+等到摘下之前进入的读者全部离开后才真正释放。
+
+全局 epoch 单调递增。读者按所在线程分散到 kSlots 个计数槽，
+在 epoch 奇偶对应的计数上加一；写者在 epoch e 时 retire 的节点放入 limbo_[e & 1]。
+try_advance 在 e - 1 期间进入的读者全部离开后，释放 limbo_[(e - 1) & 1]
+（e - 1 期间摘下的节点，此后进入的读者不可能再看到它们）并推进到 e + 1。
+retire / try_advance / 析构只能由写者调用，pin 可以在任意线程并发调用。
+*/
+class EpochDomain {
+ public:
+  static constexpr unsigned kSlots = 64;
+
+  class Guard {
+   public:
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+    ~Guard() { counter_->fetch_sub(1, std::memory_order_release); }
+
+   private:
+    friend class EpochDomain;
+    explicit Guard(std::atomic<int64_t>* counter) : counter_(counter) {}
+
+    std::atomic<int64_t>* counter_;
+  };
+
+  EpochDomain() = default;
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+  // 要求此时没有读者
+  ~EpochDomain() {
+    for (auto& limbo : limbo_) free_all(limbo);
+  }
+
+  [[nodiscard]] Guard pin() const {
+    Slot& slot = slots_[thread_slot()];
+    while (true) {
+      uint64_t e = epoch_.load();
+      std::atomic<int64_t>& counter = slot.active[e & 1];
+      counter.fetch_add(1);
+      // 计数之后 epoch 没有变化，写者推进时一定能看到这次计数
+      if (epoch_.load() == e) return Guard(&counter);
+      counter.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  // p 已经无法从共享结构中到达，读者离开后由 deleter 释放
+  void retire(void* p, void (*deleter)(void*)) {
+    limbo_[epoch_.load(std::memory_order_relaxed) & 1].push_back({p, deleter});
+  }
+
+  // 上一个 epoch 的读者全部离开时释放其间 retire 的节点并推进 epoch，返回是否推进
+  bool try_advance() {
+    uint64_t e = epoch_.load(std::memory_order_relaxed);
+    unsigned old = (e + 1) & 1;
+    for (const Slot& slot : slots_) {
+      if (slot.active[old].load() != 0) return false;
+    }
+    free_all(limbo_[old]);
+    epoch_.store(e + 1);
+    return true;
+  }
+
+  // 等待所有读者离开并释放全部 retire 的节点
+  void synchronize() {
+    while (!try_advance() || !try_advance()) std::this_thread::yield();
+  }
+
+  size_t pending() const noexcept {
+    return limbo_[0].size() + limbo_[1].size();
+  }
+
+ private:
+  struct Retired {
+    void* p;
+    void (*deleter)(void*);
+  };
+  struct alignas(64) Slot {
+    std::atomic<int64_t> active[2] = {0, 0};
+  };
+
+  // 线程首次使用时按顺序分配计数槽，多个 EpochDomain 共用同一个槽号
+  static unsigned thread_slot() noexcept {
+    static std::atomic<unsigned> next{0};
+    thread_local unsigned slot =
+        next.fetch_add(1, std::memory_order_relaxed) % kSlots;
+    return slot;
+  }
+
+  static void free_all(std::vector<Retired>& limbo) noexcept {
+    for (Retired& r : limbo) r.deleter(r.p);
+    limbo.clear();
+  }
+
+  std::atomic<uint64_t> epoch_{0};
+  mutable std::array<Slot, kSlots> slots_;
+  std::vector<Retired> limbo_[2];
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+// slab + 空闲链表的定长内存池：
+// 1. 每次向系统申请一整块slab，按定长chunk顺序切分，相邻申请的节点在内存上也相邻
+// 2. 释放的chunk挂到空闲链表上，下次申请时优先复用
+// 3. release()一次性归还所有slab，不需要逐个节点释放
+class SlabPool {
+ public:
+  SlabPool() = default;
+  SlabPool(const SlabPool&) = delete;
+  SlabPool& operator=(const SlabPool&) = delete;
+  ~SlabPool() { release(); }
+
+  // chunk的大小由第一次申请决定，之后大小或对齐不满足的申请返回false，由调用方自行处理
+  bool fits(std::size_t size, std::size_t align) noexcept {
+    if (chunk_size_ == 0) {
+      chunk_align_ = align < alignof(FreeChunk) ? alignof(FreeChunk) : align;
+      chunk_size_ = round_up(size < sizeof(FreeChunk) ? sizeof(FreeChunk) : size,
+                             chunk_align_);
+    }
+    return size <= chunk_size_ && align <= chunk_align_;
+  }
+
+  void* allocate() {
+    if (reserved_ == 0 && free_list_ != nullptr) {
+      FreeChunk* chunk = free_list_;
+      free_list_ = chunk->next;
+      return chunk;
+    }
+    if (reserved_ > 0) {
+      --reserved_;
+    } else if (cursor_ == limit_) {
+      new_slab(next_slab_chunks_);
+      if (next_slab_chunks_ < kMaxSlabChunks) next_slab_chunks_ *= 2;
+    }
+    void* p = cursor_;
+    cursor_ += chunk_size_;
+    return p;
+  }
+
+  // 保证接下来的n次申请在同一块slab上连续切分：当前slab不够时一次性申请一块
+  // 恰好n个chunk的slab。这n次申请不使用空闲链表，即使链表中有足够的chunk
+  void reserve(std::size_t n) {
+    if (static_cast<std::size_t>(limit_ - cursor_) / chunk_size_ < n) new_slab(n);
+    reserved_ = n;
+  }
+
+  void deallocate(void* p) noexcept {
+    FreeChunk* chunk = static_cast<FreeChunk*>(p);
+    chunk->next = free_list_;
+    free_list_ = chunk;
+  }
+
+  void release() noexcept {
+    reserved_ = 0;
+    while (slabs_ != nullptr) {
+      Slab* next = slabs_->next;
+      ::operator delete(static_cast<void*>(slabs_), std::align_val_t(slab_align()));
+      slabs_ = next;
+    }
+    free_list_ = nullptr;
+    cursor_ = limit_ = nullptr;
+    next_slab_chunks_ = kMinSlabChunks;
+  }
+
+ private:
+  struct FreeChunk {
+    FreeChunk* next;
+  };
+  struct Slab {
+    Slab* next;
+  };
+
+  static constexpr std::size_t kMinSlabChunks = 32;
+  static constexpr std::size_t kMaxSlabChunks = 4096;
+
+  static constexpr std::size_t round_up(std::size_t n, std::size_t align) {
+    return (n + align - 1) / align * align;
+  }
+
+  std::size_t slab_align() const noexcept {
+    return chunk_align_ < alignof(Slab) ? alignof(Slab) : chunk_align_;
+  }
+
+  // slab头部存放链表指针，之后是连续的chunk
+  void new_slab(std::size_t chunks) {
+    std::size_t header = round_up(sizeof(Slab), slab_align());
+    char* mem = static_cast<char*>(::operator new(
+        header + chunks * chunk_size_, std::align_val_t(slab_align())));
+    Slab* slab = reinterpret_cast<Slab*>(mem);
+    slab->next = slabs_;
+    slabs_ = slab;
+    // 旧slab中剩余的chunk挂到空闲链表上，避免浪费
+    while (cursor_ != limit_) {
+      deallocate(cursor_);
+      cursor_ += chunk_size_;
+    }
+    cursor_ = mem + header;
+    limit_ = cursor_ + chunks * chunk_size_;
+  }
+
+  std::size_t chunk_size_ = 0;
+  std::size_t chunk_align_ = 0;
+  std::size_t next_slab_chunks_ = kMinSlabChunks;
+  std::size_t reserved_ = 0;  // 还需从 cursor_ 连续切分的次数
+  FreeChunk* free_list_ = nullptr;
+  char* cursor_ = nullptr;
+  char* limit_ = nullptr;
+  Slab* slabs_ = nullptr;
+};
+
+// 满足std::allocator要求的节点分配器，拷贝（包括rebind）后的分配器共享同一个SlabPool。
+// 只有单个对象的申请走内存池，其余申请退化为operator new。
+template <class T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  PoolAllocator() : pool_(std::make_shared<SlabPool>()) {}
+  template <class U>
+  PoolAllocator(const PoolAllocator<U>& other) noexcept : pool_(other.pool_) {}
+
+  T* allocate(std::size_t n) {
+    if (n == 1 && pool_->fits(sizeof(T), alignof(T))) {
+      return static_cast<T*>(pool_->allocate());
+    }
+    return static_cast<T*>(
+        ::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    if (n == 1 && pool_->fits(sizeof(T), alignof(T))) {
+      pool_->deallocate(p);
+    } else {
+      ::operator delete(static_cast<void*>(p), std::align_val_t(alignof(T)));
+    }
+  }
+
+  void reserve(std::size_t n) {
+    if (pool_->fits(sizeof(T), alignof(T))) pool_->reserve(n);
+  }
+
+  // 当前分配器是内存池唯一的持有者时，整体归还所有slab并返回true。
+  // 调用方需要保证池中的对象都不再需要析构。
+  bool release() noexcept {
+    if (pool_.use_count() != 1) return false;
+    pool_->release();
+    return true;
+  }
+
+  template <class U>
+  bool operator==(const PoolAllocator<U>& other) const noexcept {
+    return pool_ == other.pool_;
+  }
+
+ private:
+  template <class U>
+  friend class PoolAllocator;
+
+  std::shared_ptr<SlabPool> pool_;
+};
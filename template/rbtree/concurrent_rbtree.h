@@ -0,0 +1,532 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "template/define.h"
+#include "template/epoch.h"
+
+/*
+读多写少的并发红黑树：任意多个线程无锁地 contains / find / scan，写操作由内部互斥锁串行化。
+
+  孩子指针和根为原子变量，新节点构造完成后以 release 写入父节点，读者以 acquire 读取。
+  值在节点生命周期内不变，父指针和颜色只有写者访问。
+  被删除的节点交给 EpochDomain，等到删除之前进入的读者全部离开后才释放，
+  因此读者持有的任何节点指针在本次操作期间都有效。
+
+  旋转和删除双孩子节点时的重新链接会让一部分节点暂时不在读者的查找路径上。
+  这些结构调整前后写者各把 version_ 加一（调整期间为奇数），读者：
+    - 找到节点时结果一定正确（节点确实在树中，或是刚被删除）；
+    - 没找到时，若期间 version_ 没有变化则结果正确，否则重试；
+    - 区间扫描每输出一个节点前检查 version_，变化后从上一个输出的值重新定位。
+  挂接新叶子、摘下至多一个孩子的节点不会让其它节点离开查找路径，不需要修改 version_。
+  调整过程中读者可能看到不一致的结构，下降步数超过 kMaxDepth 时同样重试。
+*/
+template <class T, class Comparator = std::less<T>>
+  requires KeyComparator<Comparator, T>
+class ConcurrentRBTree {
+ public:
+  // 红黑树高度不超过 2 log2(n + 1)
+  static constexpr int kMaxDepth = 128;
+  // 每删除这么多个节点尝试推进一次 epoch
+  static constexpr size_t kReclaimBatch = 64;
+
+  ConcurrentRBTree() = default;
+  explicit ConcurrentRBTree(const Comparator& comp) : comp_(comp) {}
+  ConcurrentRBTree(const ConcurrentRBTree&) = delete;
+  ConcurrentRBTree& operator=(const ConcurrentRBTree&) = delete;
+  // 要求此时没有并发的读者和写者
+  ~ConcurrentRBTree();
+
+  // 写操作，可以在任意线程调用，相互之间串行执行
+  bool insert(const T& val);
+  bool remove(const T& key);
+
+  // 读操作，无锁，可以与写操作并发
+  bool contains(const T& key) const { return contains<T>(key); }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  bool contains(const K& key) const;
+  // 找到与 key 相等的值时以该值调用 f 并返回 true，值只在 f 执行期间有效
+  template <class K, class F>
+    requires LookupKey<Comparator, K, T>
+  bool find(const K& key, F&& f) const;
+  // 从第一个 >= lo 的值开始按升序对至多 count 个值调用 f，返回调用次数。
+  // 扫描期间一直存在的值都会被访问到，并发插入或删除的值可能出现也可能不出现
+  template <class F>
+  size_t scan(const T& lo, size_t count, F&& f) const;
+
+  size_t size() const noexcept { return size_.load(std::memory_order_relaxed); }
+  bool empty() const noexcept { return size() == 0; }
+  // 尚未释放的已删除节点数
+  size_t pending_reclaim() const;
+
+  // for debug，要求此时没有并发的写者
+  void check() const;
+
+ private:
+  struct Node {
+    const T value;
+    std::atomic<Node*> lchild{nullptr};
+    std::atomic<Node*> rchild{nullptr};
+    Node* parent = nullptr;
+    Color color = Color::RED;
+
+    explicit Node(const T& val) : value(val) {}
+  };
+
+  // 写者读写链接：只有写者修改，读取无需同步；写入以 release 发布给读者
+  static Node* lchild_of(const Node* node) noexcept {
+    return node->lchild.load(std::memory_order_relaxed);
+  }
+  static Node* rchild_of(const Node* node) noexcept {
+    return node->rchild.load(std::memory_order_relaxed);
+  }
+  static void set_lchild(Node* node, Node* child) noexcept {
+    node->lchild.store(child, std::memory_order_release);
+  }
+  static void set_rchild(Node* node, Node* child) noexcept {
+    node->rchild.store(child, std::memory_order_release);
+  }
+  static bool is_black(const Node* node) noexcept {
+    return node == nullptr || node->color == Color::BLACK;
+  }
+  // 把 parent 指向 old 的链接改为 replace，parent 为空时替换根
+  void replace_child(Node* parent, Node* old, Node* replace) noexcept;
+
+  // 结构调整期间 version_ 为奇数
+  void begin_restructure() noexcept {
+    version_.store(version_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  void end_restructure() noexcept {
+    version_.store(version_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+  }
+  // 读者：此前读到的链接是否都来自 version 时刻之后没有调整过的结构
+  bool validate(uint64_t version) const noexcept {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
+  // 在 epoch 保护下查找，返回的节点在 Guard 释放前有效
+  template <class K>
+  auto find_node(const K& key) const -> Node*;
+
+  void left_rotate(Node* node) noexcept;
+  void right_rotate(Node* node) noexcept;
+  // 后继 s 接替 node 的位置和颜色，node 移到 s 原来的位置
+  void swap_with_successor(Node* node, Node* s) noexcept;
+  void insert_fix(Node* node) noexcept;
+  void remove_fix(Node* node) noexcept;
+  void erase(Node* node);
+  int post_travel(const Node* node) const;
+
+  std::atomic<Node*> root_{nullptr};
+  std::atomic<uint64_t> version_{0};
+  std::atomic<size_t> size_{0};
+  Comparator comp_;
+  mutable std::mutex write_mutex_;
+  size_t retired_ = 0;
+  mutable EpochDomain epoch_;
+};
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+ConcurrentRBTree<T, U>::~ConcurrentRBTree() {
+  std::vector<Node*> stack;
+  if (Node* root = root_.load(std::memory_order_relaxed)) stack.push_back(root);
+  while (!stack.empty()) {
+    Node* node = stack.back();
+    stack.pop_back();
+    if (lchild_of(node) != nullptr) stack.push_back(lchild_of(node));
+    if (rchild_of(node) != nullptr) stack.push_back(rchild_of(node));
+    delete node;
+  }
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool ConcurrentRBTree<T, U>::insert(const T& val) {
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  Node* parent = nullptr;
+  Node* cur = root_.load(std::memory_order_relaxed);
+  bool is_left = false;
+  while (cur != nullptr) {
+    parent = cur;
+    if (comp_(val, cur->value)) {
+      is_left = true;
+      cur = lchild_of(cur);
+    } else if (comp_(cur->value, val)) {
+      is_left = false;
+      cur = rchild_of(cur);
+    } else {
+      return false;
+    }
+  }
+  Node* node = new Node(val);
+  node->parent = parent;
+  if (parent == nullptr) {
+    root_.store(node, std::memory_order_release);
+  } else if (is_left) {
+    set_lchild(parent, node);
+  } else {
+    set_rchild(parent, node);
+  }
+  insert_fix(node);
+  size_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool ConcurrentRBTree<T, U>::remove(const T& key) {
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  Node* cur = root_.load(std::memory_order_relaxed);
+  while (cur != nullptr) {
+    if (comp_(key, cur->value)) {
+      cur = lchild_of(cur);
+    } else if (comp_(cur->value, key)) {
+      cur = rchild_of(cur);
+    } else {
+      erase(cur);
+      size_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+template <class K>
+auto ConcurrentRBTree<T, U>::find_node(const K& key) const -> Node* {
+  while (true) {
+    uint64_t version = version_.load(std::memory_order_acquire);
+    Node* cur = root_.load(std::memory_order_acquire);
+    for (int depth = 0; cur != nullptr && depth < kMaxDepth; ++depth) {
+      if (comp_(key, cur->value)) {
+        cur = cur->lchild.load(std::memory_order_acquire);
+      } else if (comp_(cur->value, key)) {
+        cur = cur->rchild.load(std::memory_order_acquire);
+      } else {
+        return cur;
+      }
+    }
+    if (cur == nullptr && version % 2 == 0 && validate(version)) {
+      return nullptr;
+    }
+    std::this_thread::yield();
+  }
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+bool ConcurrentRBTree<T, U>::contains(const K& key) const {
+  EpochDomain::Guard guard = epoch_.pin();
+  return find_node(key) != nullptr;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+template <class K, class F>
+  requires LookupKey<U, K, T>
+bool ConcurrentRBTree<T, U>::find(const K& key, F&& f) const {
+  EpochDomain::Guard guard = epoch_.pin();
+  Node* node = find_node(key);
+  if (node == nullptr) return false;
+  f(node->value);
+  return true;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+template <class F>
+size_t ConcurrentRBTree<T, U>::scan(const T& lo, size_t count, F&& f) const {
+  EpochDomain::Guard guard = epoch_.pin();
+  Node* stack[kMaxDepth];
+  const T* last = nullptr;  // 上一个输出的值，重新定位时从它之后开始
+  size_t visited = 0;
+  while (visited < count) {
+    uint64_t version = version_.load(std::memory_order_acquire);
+    if (version % 2 == 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    // 下降到第一个 >= lo（或 > *last）的节点，沿途向左转的节点即后续的中序序列
+    int top = 0, depth = 0;
+    Node* cur = root_.load(std::memory_order_acquire);
+    for (; cur != nullptr && depth < kMaxDepth; ++depth) {
+      bool go_left = last != nullptr ? comp_(*last, cur->value)
+                                     : !comp_(cur->value, lo);
+      if (go_left) {
+        stack[top++] = cur;
+        cur = cur->lchild.load(std::memory_order_acquire);
+      } else {
+        cur = cur->rchild.load(std::memory_order_acquire);
+      }
+    }
+    if (cur != nullptr) continue;
+    bool stable = true;
+    while (visited < count && top > 0) {
+      Node* node = stack[--top];
+      if (!validate(version)) {
+        stable = false;
+        break;
+      }
+      f(node->value);
+      last = &node->value;
+      ++visited;
+      for (cur = node->rchild.load(std::memory_order_acquire); cur != nullptr;
+           cur = cur->lchild.load(std::memory_order_acquire)) {
+        if (top == kMaxDepth) break;
+        stack[top++] = cur;
+      }
+      if (cur != nullptr) {
+        stable = false;
+        break;
+      }
+    }
+    // 读到树的末尾时同样需要确认期间没有结构调整
+    if (stable && (visited == count || validate(version))) break;
+  }
+  return visited;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+size_t ConcurrentRBTree<T, U>::pending_reclaim() const {
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  return epoch_.pending();
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void ConcurrentRBTree<T, U>::check() const {
+  Node* root = root_.load(std::memory_order_acquire);
+  if (root == nullptr) {
+    assert(size() == 0);
+    return;
+  }
+  assert(root->color == Color::BLACK);
+  assert(root->parent == nullptr);
+  assert(version_.load() % 2 == 0);
+  post_travel(root);
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+int ConcurrentRBTree<T, U>::post_travel(const Node* node) const {
+  if (node == nullptr) return 1;
+  if (lchild_of(node) != nullptr) {
+    assert(lchild_of(node)->parent == node);
+    assert(comp_(lchild_of(node)->value, node->value));
+    assert(node->color == Color::BLACK || is_black(lchild_of(node)));
+  }
+  if (rchild_of(node) != nullptr) {
+    assert(rchild_of(node)->parent == node);
+    assert(comp_(node->value, rchild_of(node)->value));
+    assert(node->color == Color::BLACK || is_black(rchild_of(node)));
+  }
+  auto lcnt = post_travel(lchild_of(node));
+  auto rcnt = post_travel(rchild_of(node));
+  assert(lcnt == rcnt);
+  return node->color == Color::BLACK ? lcnt + 1 : lcnt;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void ConcurrentRBTree<T, U>::replace_child(Node* parent, Node* old,
+                                           Node* replace) noexcept {
+  if (parent == nullptr) {
+    root_.store(replace, std::memory_order_release);
+  } else if (lchild_of(parent) == old) {
+    set_lchild(parent, replace);
+  } else {
+    set_rchild(parent, replace);
+  }
+}
+
+// 发布顺序：node 先接过 rchild 的左子树，rchild 再指向 node，最后挂到 parent 下。
+// 每一步之后沿孩子指针都不会形成环，且所有节点仍可以从 parent 经 node 到达
+template <class T, class U>
+  requires KeyComparator<U, T>
+void ConcurrentRBTree<T, U>::left_rotate(Node* node) noexcept {
+  begin_restructure();
+  Node* rchild = rchild_of(node);
+  Node* inner = lchild_of(rchild);
+  Node* parent = node->parent;
+  set_rchild(node, inner);
+  if (inner != nullptr) inner->parent = node;
+  set_lchild(rchild, node);
+  replace_child(parent, node, rchild);
+  rchild->parent = parent;
+  node->parent = rchild;
+  end_restructure();
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void ConcurrentRBTree<T, U>::right_rotate(Node* node) noexcept {
+  begin_restructure();
+  Node* lchild = lchild_of(node);
+  Node* inner = rchild_of(lchild);
+  Node* parent = node->parent;
+  set_lchild(node, inner);
+  if (inner != nullptr) inner->parent = node;
+  set_rchild(lchild, node);
+  replace_child(parent, node, lchild);
+  lchild->parent = parent;
+  node->parent = lchild;
+  end_restructure();
+}
+
+// 依次：把 s 从原位置摘下，s 接管 node 的孩子并替换 node，node 挂到 s 原来的位置。
+// 同样保证每一步之后沿孩子指针不会形成环
+template <class T, class U>
+  requires KeyComparator<U, T>
+void ConcurrentRBTree<T, U>::swap_with_successor(Node* node,
+                                                 Node* s) noexcept {
+  begin_restructure();
+  Node* parent = node->parent;
+  Node* lchild = lchild_of(node);
+  Node* rchild = rchild_of(node);
+  Node* s_parent = s->parent;
+  Node* s_rchild = rchild_of(s);  // 后继没有左孩子
+  if (rchild != s) set_lchild(s_parent, s_rchild);
+  set_lchild(s, lchild);
+  lchild->parent = s;
+  if (rchild != s) {
+    set_rchild(s, rchild);
+    rchild->parent = s;
+  }
+  replace_child(parent, node, s);
+  s->parent = parent;
+  set_lchild(node, nullptr);
+  set_rchild(node, s_rchild);
+  if (s_rchild != nullptr) s_rchild->parent = node;
+  if (rchild == s) {
+    set_rchild(s, node);
+    node->parent = s;
+  } else {
+    set_lchild(s_parent, node);
+    node->parent = s_parent;
+  }
+  std::swap(node->color, s->color);
+  end_restructure();
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void ConcurrentRBTree<T, U>::erase(Node* node) {
+  if (lchild_of(node) != nullptr && rchild_of(node) != nullptr) {
+    Node* s = rchild_of(node);
+    while (lchild_of(s) != nullptr) s = lchild_of(s);
+    swap_with_successor(node, s);
+  }
+  // 至多一个孩子：摘下 node 时它的孩子原样保留，正在 node 上的读者仍能继续下降
+  Node* replace = lchild_of(node) != nullptr ? lchild_of(node) : rchild_of(node);
+  if (replace != nullptr) {
+    replace_child(node->parent, node, replace);
+    replace->parent = node->parent;
+    if (node->color == Color::BLACK) remove_fix(replace);
+  } else if (node->parent == nullptr) {
+    root_.store(nullptr, std::memory_order_release);
+  } else {
+    if (node->color == Color::BLACK) remove_fix(node);
+    replace_child(node->parent, node, nullptr);
+  }
+  epoch_.retire(node, [](void* p) { delete static_cast<Node*>(p); });
+  if (++retired_ % kReclaimBatch == 0) epoch_.try_advance();
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void ConcurrentRBTree<T, U>::insert_fix(Node* node) noexcept {
+  while (true) {
+    Node* parent = node->parent;
+    if (parent == nullptr) {
+      node->color = Color::BLACK;
+      return;
+    }
+    if (node->color == Color::BLACK || parent->color == Color::BLACK) return;
+    Node* grandpa = parent->parent;
+    bool is_parent_left = lchild_of(grandpa) == parent;
+    Node* uncle = is_parent_left ? rchild_of(grandpa) : lchild_of(grandpa);
+    bool is_node_left = lchild_of(parent) == node;
+    if (!is_black(uncle)) {
+      uncle->color = Color::BLACK;
+      parent->color = Color::BLACK;
+      grandpa->color = Color::RED;
+      node = grandpa;
+    } else if (is_node_left == is_parent_left) {
+      is_node_left ? right_rotate(grandpa) : left_rotate(grandpa);
+      std::swap(grandpa->color, parent->color);
+      node = grandpa;
+    } else {
+      is_node_left ? right_rotate(parent) : left_rotate(parent);
+      node = parent;
+    }
+  }
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void ConcurrentRBTree<T, U>::remove_fix(Node* node) noexcept {
+  while (node->parent != nullptr && node->color == Color::BLACK) {
+    Node *parent = node->parent, *sibling;
+    if (node == lchild_of(parent)) {
+      sibling = rchild_of(parent);
+      if (sibling->color == Color::RED) {
+        sibling->color = Color::BLACK;
+        parent->color = Color::RED;
+        left_rotate(parent);
+        sibling = rchild_of(parent);
+      }
+      if (is_black(lchild_of(sibling)) && is_black(rchild_of(sibling))) {
+        sibling->color = Color::RED;
+        node = parent;
+      } else {
+        if (is_black(rchild_of(sibling))) {
+          right_rotate(sibling);
+          sibling = rchild_of(parent);
+        }
+        sibling->color = parent->color;
+        parent->color = Color::BLACK;
+        rchild_of(sibling)->color = Color::BLACK;
+        left_rotate(parent);
+        node = root_.load(std::memory_order_relaxed);
+      }
+    } else {
+      sibling = lchild_of(parent);
+      if (sibling->color == Color::RED) {
+        sibling->color = Color::BLACK;
+        parent->color = Color::RED;
+        right_rotate(parent);
+        sibling = lchild_of(parent);
+      }
+      if (is_black(lchild_of(sibling)) && is_black(rchild_of(sibling))) {
+        sibling->color = Color::RED;
+        node = parent;
+      } else {
+        if (is_black(lchild_of(sibling))) {
+          left_rotate(sibling);
+          sibling = lchild_of(parent);
+        }
+        sibling->color = parent->color;
+        parent->color = Color::BLACK;
+        lchild_of(sibling)->color = Color::BLACK;
+        right_rotate(parent);
+        node = root_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+  node->color = Color::BLACK;
+}
@@ -0,0 +1,126 @@
+#include "template/rbtree/concurrent_rbtree.h"
+
+#include <atomic>
+#include <cassert>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+std::random_device rd;
+std::mt19937 gen(rd());
+std::uniform_int_distribution<> dis(1, 1000000);
+int random_int() { return dis(gen); }
+
+// 统计存活对象个数，检查延迟回收最终释放了所有节点
+struct Counted {
+  static inline std::atomic<int> alive = 0;
+  int key;
+
+  Counted(int k) : key(k) { ++alive; }
+  Counted(const Counted& other) : key(other.key) { ++alive; }
+  ~Counted() { --alive; }
+  bool operator<(const Counted& other) const { return key < other.key; }
+};
+
+void basic_test() {
+  ConcurrentRBTree<int> tree;
+  std::set<int> expect;
+  for (int i = 0; i < 50000; ++i) {
+    int temp = random_int() % 10000;
+    if (i % 3 == 0) {
+      assert(tree.remove(temp) == (expect.erase(temp) == 1));
+    } else {
+      assert(tree.insert(temp) == expect.insert(temp).second);
+    }
+  }
+  tree.check();
+  assert(tree.size() == expect.size());
+  for (int i = 0; i < 10000; ++i) assert(tree.contains(i) == expect.count(i));
+  int found = -1;
+  assert(tree.find(*expect.begin(), [&](int v) { found = v; }));
+  assert(found == *expect.begin());
+
+  std::vector<int> scanned;
+  tree.scan(5000, 100, [&](int v) { scanned.push_back(v); });
+  assert(std::equal(scanned.begin(), scanned.end(), expect.lower_bound(5000)));
+  scanned.clear();
+  assert(tree.scan(0, SIZE_MAX, [&](int v) { scanned.push_back(v); }) ==
+         expect.size());
+  assert(std::equal(scanned.begin(), scanned.end(), expect.begin(),
+                    expect.end()));
+}
+
+void reclaim_test() {
+  {
+    ConcurrentRBTree<Counted> tree;
+    for (int i = 0; i < 10000; ++i) tree.insert(i);
+    for (int i = 0; i < 10000; i += 2) tree.remove(i);
+    tree.check();
+    // 没有读者时，被删除的节点只有不足两批还没有释放
+    assert(tree.pending_reclaim() <
+           2 * ConcurrentRBTree<Counted>::kReclaimBatch);
+    assert(Counted::alive == 5000 + static_cast<int>(tree.pending_reclaim()));
+  }
+  assert(Counted::alive == 0);
+}
+
+// 一个写者不断插入删除奇数 key，偶数 key 始终存在，负数 key 从不插入。
+// 读者并发查找和扫描：偶数 key 一定能找到，从未插入的 key 一定找不到，
+// 扫描结果严格递增且覆盖区间内全部偶数 key
+void stress_test() {
+  constexpr int kKeys = 20000;
+  constexpr int kReaders = 4;
+  ConcurrentRBTree<int> tree;
+  for (int i = 0; i < kKeys; i += 2) tree.insert(i);
+  std::atomic<bool> stop = false;
+  std::atomic<size_t> reads = 0;
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < kReaders; ++r) {
+    readers.emplace_back([&, r] {
+      std::mt19937 gen(r);
+      size_t ops = 0;
+      while (!stop.load(std::memory_order_relaxed) || ops < 1000) {
+        int key = gen() % kKeys;
+        if (key % 2 == 0) {
+          assert(tree.contains(key));
+        }
+        assert(!tree.contains(-key - 1));
+        int prev = key - 1, count = 0;
+        tree.scan(key, 50, [&](int v) {
+          assert(v > prev);
+          // prev 与 v 之间的偶数 key 不能被漏掉
+          assert(v <= (prev % 2 == 0 ? prev + 2 : prev + 1));
+          prev = v;
+          ++count;
+        });
+        assert(count == 50 || prev >= kKeys - 2);
+        ++ops;
+      }
+      reads += ops;
+    });
+  }
+
+  std::mt19937 gen(42);
+  for (int i = 0; i < 300000; ++i) {
+    int key = gen() % kKeys | 1;
+    if (gen() % 2 == 0) {
+      tree.insert(key);
+    } else {
+      tree.remove(key);
+    }
+  }
+  stop = true;
+  for (auto& reader : readers) reader.join();
+  tree.check();
+  assert(reads > 0);
+  for (int i = 0; i < kKeys; i += 2) assert(tree.contains(i));
+}
+
+int main() {
+  basic_test();
+  reclaim_test();
+  stress_test();
+  return 0;
+}
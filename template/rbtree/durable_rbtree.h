@@ -0,0 +1,288 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "template/define.h"
+#include "template/rbtree/rbtree.h"
+#include "template/write_ahead_log.h"
+
+/*
+带操作日志的 RBTree：修改先记入 WriteAheadLog 再作用于树，进程崩溃后由检查点和日志恢复。
+  dir 下有两个文件：snapshot 为检查点时全部值的有序数组，wal 为此后的修改记录。
+  只有改变了集合的 insert/remove/erase 写日志，日志按组提交（见 WriteAheadLog）。
+  checkpoint()：日志落盘 → 全部值写入 snapshot.tmp 并 fsync → rename 为 snapshot → 清空日志。
+    在 rename 与清空日志之间崩溃时，旧日志会重放到新检查点上。插入、删除都是幂等的，
+    每个 key 的最终状态只取决于它在日志中的最后一次操作，所以结果不变。
+  启动时 O(n) 由检查点构建，再按批重放日志：每批按 key 排序，每个 key 只保留最后一次操作，
+    构建成有序的插入树和删除树，用 union_with / difference_with 合并，而不是逐条查找。
+T 需要可平凡拷贝。不是线程安全的。
+*/
+template <class T, class Comparator = std::less<T>>
+  requires KeyComparator<Comparator, T>
+class DurableRBTree {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "DurableRBTree stores values as raw bytes");
+
+ public:
+  using Tree = RBTree<T, Comparator>;
+  using Node = typename Tree::Node;
+  using const_iterator = typename Tree::const_iterator;
+
+  struct Config {
+    WriteAheadLog::Options log;
+    // 自上次检查点起写入这么多条日志后自动做检查点，为0时只在调用 checkpoint() 时进行
+    size_t checkpoint_ops = size_t(1) << 20;
+  };
+
+  // dir 需已存在。从其中的检查点和日志恢复，没有时为空集合
+  explicit DurableRBTree(const std::string& dir, Config config = Config(),
+                         const Comparator& comp = Comparator());
+  DurableRBTree(const DurableRBTree&) = delete;
+  DurableRBTree& operator=(const DurableRBTree&) = delete;
+
+  bool insert(const T& val);
+  bool remove(const T& key);
+  void erase(Node* node);
+
+  auto find(const T& key) const -> Node* { return tree_.find(key); }
+  bool contains(const T& key) const { return find(key) != nullptr; }
+  auto lower_bound(const T& key) const -> const_iterator {
+    return tree_.lower_bound(key);
+  }
+  auto begin() const -> const_iterator { return tree_.begin(); }
+  auto end() const -> const_iterator { return tree_.end(); }
+  auto tree() const -> const Tree& { return tree_; }
+
+  // 等待此前的全部修改落盘
+  void sync() { log_.sync(); }
+  void checkpoint();
+  // 启动时从日志重放的记录条数
+  size_t replayed() const noexcept { return replayed_; }
+  auto log() const -> const WriteAheadLog& { return log_; }
+
+ private:
+  enum Op : char { kInsert = 'I', kRemove = 'R' };
+  using Record = std::array<char, 1 + sizeof(T)>;
+  static constexpr size_t kReplayBatch = size_t(1) << 16;
+  static constexpr uint32_t kSnapshotMagic = 0x534e4150;  // "SNAP"
+
+  struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t key_size;
+    uint64_t count;
+    uint64_t checksum;  // 全部值的校验和
+  };
+
+  [[noreturn]] static void throw_errno(const char* what) {
+    throw std::system_error(errno, std::generic_category(),
+                            std::string("DurableRBTree: ") + what);
+  }
+  static void write_all(int fd, const void* data, size_t n);
+
+  void load_snapshot();
+  // 把一批 (key, 是否插入) 合并进树，并清空 ops
+  void apply(std::vector<std::pair<T, bool>>& ops);
+  void log_op(Op op, const T& val);
+  // 修改作用于树之后调用，日志足够多时做检查点
+  void maybe_checkpoint() {
+    if (config_.checkpoint_ops != 0 && logged_ >= config_.checkpoint_ops) {
+      checkpoint();
+    }
+  }
+
+  std::string dir_;
+  Config config_;
+  Comparator comp_;
+  Tree tree_;
+  WriteAheadLog log_;
+  size_t logged_ = 0;  // 自上次检查点起的日志条数
+  size_t replayed_ = 0;
+};
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+DurableRBTree<T, U>::DurableRBTree(const std::string& dir, Config config,
+                                   const U& comp)
+    : dir_(dir),
+      config_(config),
+      comp_(comp),
+      tree_(comp),
+      log_(dir + "/wal", sizeof(Record), config.log) {
+  load_snapshot();
+  std::vector<std::pair<T, bool>> ops;
+  ops.reserve(kReplayBatch);
+  replayed_ = log_.replay([&](const char* record) {
+    T val;
+    std::memcpy(&val, record + 1, sizeof(T));
+    ops.emplace_back(val, record[0] == kInsert);
+    if (ops.size() == kReplayBatch) apply(ops);
+  });
+  apply(ops);
+  logged_ = replayed_;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool DurableRBTree<T, U>::insert(const T& val) {
+  if (tree_.find(val) != nullptr) return false;
+  log_op(kInsert, val);
+  tree_.insert(val);
+  maybe_checkpoint();
+  return true;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool DurableRBTree<T, U>::remove(const T& key) {
+  Node* node = tree_.find(key);
+  if (node == nullptr) return false;
+  erase(node);
+  return true;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void DurableRBTree<T, U>::erase(Node* node) {
+  log_op(kRemove, node->value);
+  tree_.erase(node);
+  maybe_checkpoint();
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void DurableRBTree<T, U>::log_op(Op op, const T& val) {
+  Record record;
+  record[0] = op;
+  std::memcpy(record.data() + 1, &val, sizeof(T));
+  log_.append(record.data());
+  ++logged_;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void DurableRBTree<T, U>::apply(std::vector<std::pair<T, bool>>& ops) {
+  std::stable_sort(ops.begin(), ops.end(), [&](const auto& a, const auto& b) {
+    return comp_(a.first, b.first);
+  });
+  std::vector<T> inserts, removes;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    // 相等的 key 只保留最后一次操作
+    if (i + 1 < ops.size() && !comp_(ops[i].first, ops[i + 1].first)) continue;
+    (ops[i].second ? inserts : removes).push_back(ops[i].first);
+  }
+  ops.clear();
+  if (!removes.empty()) {
+    Tree other(comp_);
+    other.assign(sorted_unique, removes.begin(), removes.end());
+    tree_.difference_with(std::move(other));
+  }
+  if (!inserts.empty()) {
+    Tree other(comp_);
+    other.assign(sorted_unique, inserts.begin(), inserts.end());
+    tree_.union_with(std::move(other));
+  }
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void DurableRBTree<T, U>::load_snapshot() {
+  int fd = ::open((dir_ + "/snapshot").c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) return;
+    throw_errno("open");
+  }
+  SnapshotHeader header;
+  std::vector<T> values;
+  bool ok = ::pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+            header.magic == kSnapshotMagic && header.key_size == sizeof(T);
+  if (ok) {
+    values.resize(header.count);
+    size_t bytes = header.count * sizeof(T);
+    auto data = reinterpret_cast<char*>(values.data());
+    for (size_t read = 0; ok && read < bytes;) {
+      ssize_t n = ::pread(fd, data + read, bytes - read, sizeof(header) + read);
+      ok = n > 0;
+      read += ok ? n : 0;
+    }
+    ok = ok && WriteAheadLog::checksum(data, bytes) == header.checksum;
+  }
+  ::close(fd);
+  // 检查点经 rename 原子替换，不完整说明文件已损坏，不能静默丢弃
+  if (!ok) throw std::runtime_error("DurableRBTree: corrupted snapshot");
+  tree_.assign(sorted_unique, values.begin(), values.end());
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void DurableRBTree<T, U>::checkpoint() {
+  log_.sync();
+  std::string tmp = dir_ + "/snapshot.tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) throw_errno("open");
+  try {
+    // 先占位文件头，写完全部值后再回填数量和校验和
+    SnapshotHeader header{kSnapshotMagic, sizeof(T), 0,
+                          WriteAheadLog::checksum(nullptr, 0)};
+    write_all(fd, &header, sizeof(header));
+    std::vector<T> chunk;
+    chunk.reserve(kReplayBatch);
+    auto flush_chunk = [&] {
+      auto data = reinterpret_cast<const char*>(chunk.data());
+      size_t bytes = chunk.size() * sizeof(T);
+      header.checksum = WriteAheadLog::checksum(data, bytes, header.checksum);
+      header.count += chunk.size();
+      write_all(fd, data, bytes);
+      chunk.clear();
+    };
+    for (const T& val : tree_) {
+      chunk.push_back(val);
+      if (chunk.size() == kReplayBatch) flush_chunk();
+    }
+    flush_chunk();
+    if (::pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+      throw_errno("pwrite");
+    }
+    if (::fsync(fd) != 0) throw_errno("fsync");
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  if (::rename(tmp.c_str(), (dir_ + "/snapshot").c_str()) != 0) {
+    throw_errno("rename");
+  }
+  // rename 本身也要落盘
+  int dir_fd = ::open(dir_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir_fd < 0) throw_errno("open");
+  int ret = ::fsync(dir_fd);
+  ::close(dir_fd);
+  if (ret != 0) throw_errno("fsync");
+  log_.reset();
+  logged_ = 0;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void DurableRBTree<T, U>::write_all(int fd, const void* data, size_t n) {
+  auto p = static_cast<const char*>(data);
+  for (size_t written = 0; written < n;) {
+    ssize_t ret = ::write(fd, p + written, n - written);
+    if (ret < 0 && errno == EINTR) continue;
+    if (ret < 0) throw_errno("write");
+    written += ret;
+  }
+}
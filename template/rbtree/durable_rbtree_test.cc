@@ -0,0 +1,183 @@
+#include "template/rbtree/durable_rbtree.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <string>
+#include <system_error>
+#include <thread>
+
+std::random_device rd;
+std::mt19937 gen(rd());
+std::uniform_int_distribution<> dis(1, 100000);
+int random_int() { return dis(gen); }
+
+namespace fs = std::filesystem;
+
+std::string temp_dir() {
+  char path[] = "/tmp/durable_rbtree_test.XXXXXX";
+  assert(mkdtemp(path) != nullptr);
+  return path;
+}
+
+// 复制磁盘上的文件，模拟此刻崩溃
+void copy_dir(const std::string& from, const std::string& to) {
+  fs::copy(from, to,
+           fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+}
+
+void check_equal(const DurableRBTree<int>& tree, const std::set<int>& expect) {
+  tree.tree().check();
+  assert(std::equal(tree.begin(), tree.end(), expect.begin(), expect.end()));
+}
+
+void random_ops(DurableRBTree<int>& tree, std::set<int>& expect, int n) {
+  for (int i = 0; i < n; ++i) {
+    int x = random_int();
+    if (i % 3 == 2) {
+      assert(tree.remove(x) == (expect.erase(x) == 1));
+    } else {
+      assert(tree.insert(x) == expect.insert(x).second);
+    }
+  }
+}
+
+// 正常关闭后重新打开，含自动检查点
+void reopen_test() {
+  std::string dir = temp_dir();
+  std::set<int> expect;
+  DurableRBTree<int>::Config config;
+  config.checkpoint_ops = 5000;
+  for (int round = 0; round < 4; ++round) {
+    DurableRBTree<int> tree(dir, config);
+    check_equal(tree, expect);
+    random_ops(tree, expect, 12000);
+  }
+  {
+    DurableRBTree<int> tree(dir, config);
+    check_equal(tree, expect);
+    // 12000 * 4 次操作中改变集合的部分，每 5000 条做一次检查点，剩余的从日志重放
+    assert(tree.replayed() < 5000);
+    tree.checkpoint();
+  }
+  {
+    DurableRBTree<int> tree(dir, config);
+    check_equal(tree, expect);
+    assert(tree.replayed() == 0);
+  }
+  fs::remove_all(dir);
+}
+
+// 崩溃：sync 之后复制磁盘上的文件，未提交的修改不应出现在恢复结果中
+void crash_test() {
+  std::string dir = temp_dir(), crashed = temp_dir();
+  DurableRBTree<int>::Config config;
+  config.log.group_ops = 1 << 30;
+  config.log.group_interval = std::chrono::microseconds(0);
+  config.checkpoint_ops = 0;
+  std::set<int> expect;
+  {
+    DurableRBTree<int> tree(dir, config);
+    random_ops(tree, expect, 3000);
+    tree.checkpoint();
+    random_ops(tree, expect, 3000);
+    tree.sync();
+    std::set<int> synced = expect;
+    random_ops(tree, expect, 3000);
+    copy_dir(dir, crashed);
+    DurableRBTree<int> recovered(crashed, config);
+    check_equal(recovered, synced);
+  }
+  fs::remove_all(crashed);
+
+  // 写了一半的组被忽略并截掉
+  {
+    std::FILE* wal = std::fopen((dir + "/wal").c_str(), "ab");
+    std::fputs("partial group", wal);
+    std::fclose(wal);
+    DurableRBTree<int> tree(dir, config);
+    check_equal(tree, expect);
+    random_ops(tree, expect, 100);
+  }
+  {
+    DurableRBTree<int> tree(dir, config);
+    check_equal(tree, expect);
+  }
+
+  // 检查点 rename 之后、清空日志之前崩溃：旧日志重放到新检查点上，结果不变
+  {
+    DurableRBTree<int> tree(dir, config);
+    random_ops(tree, expect, 3000);
+    tree.sync();
+    fs::copy_file(dir + "/wal", dir + "/wal.old");
+    tree.checkpoint();
+  }
+  fs::rename(dir + "/wal.old", dir + "/wal");
+  {
+    DurableRBTree<int> tree(dir, config);
+    assert(tree.replayed() > 0);
+    check_equal(tree, expect);
+  }
+  fs::remove_all(dir);
+}
+
+// 按时间提交：不调用 sync，等待超过 group_interval 后记录也已落盘
+void interval_test() {
+  std::string dir = temp_dir(), crashed = temp_dir();
+  DurableRBTree<int>::Config config;
+  config.log.group_ops = 1 << 30;
+  config.log.group_interval = std::chrono::microseconds(1000);
+  std::set<int> expect;
+  DurableRBTree<int> tree(dir, config);
+  random_ops(tree, expect, 1000);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  assert(tree.log().groups() > 0);
+  copy_dir(dir, crashed);
+  DurableRBTree<int> recovered(crashed, config);
+  check_equal(recovered, expect);
+  fs::remove_all(crashed);
+  fs::remove_all(dir);
+}
+
+template <class F>
+bool throws(F&& f) {
+  try {
+    f();
+  } catch (const std::system_error&) {
+    return true;
+  }
+  return false;
+}
+
+// 写盘失败后日志不再可用，之后的 append/sync 都抛出错误
+void log_error_test() {
+  int record = 0;
+  {
+    WriteAheadLog log("/dev/full", sizeof(record), {4, {}});
+    log.append(&record);
+    assert(throws([&] { log.sync(); }));
+    assert(throws([&] { log.sync(); }));
+    assert(throws([&] { log.append(&record); }));
+    assert(log.groups() == 0);
+  }
+  {
+    // 后台线程提交失败，sync 同样抛出
+    WriteAheadLog log("/dev/full", sizeof(record),
+                      {1 << 30, std::chrono::microseconds(100)});
+    log.append(&record);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert(throws([&] { log.sync(); }));
+    assert(throws([&] { log.sync(); }));
+  }
+}
+
+int main() {
+  reopen_test();
+  crash_test();
+  interval_test();
+  log_error_test();
+  return 0;
+}
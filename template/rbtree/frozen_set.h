@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <vector>
+
+#include "template/define.h"
+#include "template/simd_search.h"
+
+// 按缓存行对齐分配，每个 FrozenSet 节点正好占据整数个缓存行
+template <class T>
+struct CacheAlignedAllocator {
+  using value_type = T;
+  static constexpr std::align_val_t kAlign{64};
+
+  CacheAlignedAllocator() = default;
+  template <class U>
+  CacheAlignedAllocator(const CacheAlignedAllocator<U>&) noexcept {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(::operator new(n * sizeof(T), kAlign));
+  }
+  void deallocate(T* p, size_t) noexcept { ::operator delete(p, kAlign); }
+  bool operator==(const CacheAlignedAllocator&) const = default;
+};
+
+/*
+只读有序集合，由 RBTree::freeze() 或有序无重复区间构建，按静态 B+ 树（S+ 树）布局：
+  叶子层即全部值的有序数组，按 kBlock 个一组；
+  内部层每个节点 kBlock 个 key、kBlock + 1 个孩子，第 j 个 key 为第 j + 1 个孩子子树的最小值，
+  孩子在下一层中连续存放，不保存指针，节点 k 的第 i 个孩子为 k * (kBlock + 1) + i。
+查找从根开始，每层数出节点中小于 x 的 key 的个数作为孩子序号，没有分支。
+int / float 配合 std::less 时，16 个 key 正好是一个缓存行，用 AVX2（或 SSE2）一次比较；
+64 位与无符号数值同样按 SIMD 比较（见 simd_search.h），其它类型逐个比较。每层只访问一个缓存行，1e7 个 int 共 6 层，上面几层常驻缓存。
+*/
+template <class T, class Comparator = std::less<T>>
+  requires KeyComparator<Comparator, T>
+class FrozenSet {
+ public:
+  static constexpr size_t kBlock = 16;
+
+  using value_type = T;
+  using size_type = size_t;
+  using const_iterator = const T*;
+  using iterator = const_iterator;
+
+  FrozenSet() = default;
+  // [first, last) 需按比较器严格升序
+  template <std::forward_iterator It>
+  FrozenSet(sorted_unique_t, It first, It last,
+            const Comparator& comp = Comparator());
+
+  // 第一个 >= x 的位置
+  auto lower_bound(const T& x) const -> const_iterator {
+    return begin() + rank(x);
+  }
+  auto find(const T& x) const -> const_iterator {
+    const_iterator it = lower_bound(x);
+    return it != end() && !comp_(x, *it) ? it : end();
+  }
+  bool contains(const T& x) const { return find(x) != end(); }
+  // 小于 x 的值的个数，O(log n)
+  size_t rank(const T& x) const;
+  // 第 k 小（从0开始）的值，要求 k < size()
+  const T& select(size_t k) const { return leaves_[k]; }
+
+  // 值在叶子层中连续存放，迭代器即指针
+  auto begin() const -> const_iterator { return leaves_.data(); }
+  auto end() const -> const_iterator { return leaves_.data() + size_; }
+  size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  // 各层占用的字节数，含填充
+  size_t memory_bytes() const noexcept {
+    return (leaves_.capacity() + inner_.capacity()) * sizeof(T);
+  }
+
+ private:
+  // 节点中小于 x 的 key 的个数
+  size_t count_less(const T* node, const T& x) const;
+
+  std::vector<T, CacheAlignedAllocator<T>> leaves_;
+  // 内部层从上到下依次存放，offsets_[h] 为第 h 层（0为根）的起点
+  std::vector<T, CacheAlignedAllocator<T>> inner_;
+  std::vector<size_t> offsets_;
+  size_t size_ = 0;
+  [[no_unique_address]] Comparator comp_;
+};
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+template <std::forward_iterator It>
+FrozenSet<T, U>::FrozenSet(sorted_unique_t, It first, It last, const U& comp)
+    : comp_(comp) {
+  leaves_.assign(first, last);
+  size_ = leaves_.size();
+  if (size_ == 0) return;
+  // 填充为最大值：查找前先排除 x 大于最大值的情况，填充的 key 永远不会小于 x
+  T max = leaves_.back();
+  leaves_.resize((size_ + kBlock - 1) / kBlock * kBlock, max);
+
+  // blocks[h] 为自叶子层向上第 h 层的节点数
+  std::vector<size_t> blocks{leaves_.size() / kBlock};
+  while (blocks.back() > 1) {
+    blocks.push_back((blocks.back() + kBlock) / (kBlock + 1));
+  }
+  size_t total = 0;
+  for (size_t h = blocks.size() - 1; h >= 1; --h) {
+    offsets_.push_back(total);
+    total += blocks[h] * kBlock;
+  }
+  inner_.resize(total, max);
+  // 第 h 层节点 k 的第 j 个 key：第 h - 1 层第 k * (kBlock + 1) + j + 1 个节点的
+  // 子树的最小值，即沿最左侧下降到的叶子节点的第一个值
+  for (size_t h = blocks.size() - 1; h >= 1; --h) {
+    T* layer = inner_.data() + offsets_[blocks.size() - 1 - h];
+    for (size_t k = 0; k < blocks[h]; ++k) {
+      for (size_t j = 0; j < kBlock; ++j) {
+        // 存在的节点至少有一个孩子，最左侧的叶子一定存在
+        size_t child = k * (kBlock + 1) + j + 1;
+        if (child >= blocks[h - 1]) break;
+        for (size_t d = h - 1; d > 0; --d) child *= kBlock + 1;
+        layer[k * kBlock + j] = leaves_[child * kBlock];
+      }
+    }
+  }
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+size_t FrozenSet<T, U>::rank(const T& x) const {
+  if (size_ == 0 || comp_(leaves_[size_ - 1], x)) return size_;
+  size_t k = 0;
+  for (size_t offset : offsets_) {
+    k = k * (kBlock + 1) + count_less(inner_.data() + offset + k * kBlock, x);
+  }
+  return k * kBlock + count_less(leaves_.data() + k * kBlock, x);
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+size_t FrozenSet<T, U>::count_less(const T* node, const T& x) const {
+  if constexpr (SimdSearchable<T, U>) {
+    return simd_count_less<T, U>(node, kBlock, x);
+  } else {
+    // 标量版本：逐个比较后累加，不产生分支
+    size_t count = 0;
+    for (size_t j = 0; j < kBlock; ++j) count += comp_(node[j], x);
+    return count;
+  }
+}
@@ -0,0 +1,108 @@
+#include "template/rbtree/frozen_set.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "template/rbtree/rbtree.h"
+
+std::random_device rd;
+std::mt19937 gen(rd());
+std::uniform_int_distribution<> dis(1, 1000000);
+int random_int() { return dis(gen); }
+
+// 与有序数组上的 std::lower_bound 逐个对照
+template <class T, class C>
+void check_against(const FrozenSet<T, C>& set, const std::vector<T>& expect,
+                   const T& x) {
+  auto it = std::lower_bound(expect.begin(), expect.end(), x, C());
+  size_t rank = it - expect.begin();
+  assert(set.rank(x) == rank);
+  assert(set.lower_bound(x) == set.begin() + rank);
+  bool found = it != expect.end() && !C()(x, *it);
+  assert(set.contains(x) == found);
+  assert(set.find(x) == (found ? set.begin() + rank : set.end()));
+}
+
+void int_test() {
+  // 覆盖空集、单个节点、恰好填满和多出一个的边界
+  for (size_t n : {0, 1, 15, 16, 17, 272, 273, 1000, 100000}) {
+    RBTree<int> tree;
+    for (size_t size = 0; size < n;) {
+      size += tree.insert(random_int() * 2 - 1000000);
+    }
+    FrozenSet<int> set = tree.freeze();
+    std::vector<int> expect(tree.begin(), tree.end());
+    assert(set.size() == n && set.empty() == (n == 0));
+    assert(std::equal(set.begin(), set.end(), expect.begin(), expect.end()));
+    for (size_t k = 0; k < n; ++k) assert(set.select(k) == expect[k]);
+    for (int x : expect) {
+      check_against(set, expect, x);
+      check_against(set, expect, x + 1);
+    }
+    for (int x : {INT_MIN, INT_MIN + 1, -1, 0, INT_MAX - 1, INT_MAX}) {
+      check_against(set, expect, x);
+    }
+  }
+
+  // 包含 INT_MIN / INT_MAX 本身
+  std::vector<int> edge{INT_MIN, -5, 0, 7, INT_MAX};
+  FrozenSet<int> set(sorted_unique, edge.begin(), edge.end());
+  for (int x : {INT_MIN, INT_MIN + 1, -5, 0, 1, 7, INT_MAX - 1, INT_MAX}) {
+    check_against(set, edge, x);
+  }
+}
+
+void float_test() {
+  std::vector<float> expect;
+  for (int i = 0; i < 5000; ++i) expect.push_back(i * 0.5f - 1000.0f);
+  FrozenSet<float> set(sorted_unique, expect.begin(), expect.end());
+  for (int i = 0; i < 12000; ++i) {
+    check_against(set, expect, i * 0.25f - 1500.0f);
+  }
+}
+
+// 64 位与无符号键，跨过 0 和无符号数的最高位
+template <class T>
+void wide_test(T first, T step) {
+  std::vector<T> expect;
+  for (int i = 0; i < 5000; ++i) expect.push_back(first + step * T(i));
+  FrozenSet<T> set(sorted_unique, expect.begin(), expect.end());
+  for (int i = -1; i <= 5000; ++i) {
+    check_against(set, expect, T(first + step * T(i)));
+    check_against(set, expect, T(first + step * T(i) + step / 2));
+  }
+}
+
+void generic_test() {
+  // 非 SIMD 路径：字符串与自定义比较器
+  RBTree<std::string> tree;
+  for (int i = 0; i < 3000; ++i) tree.insert(std::to_string(random_int()));
+  auto set = tree.freeze();
+  std::vector<std::string> expect(tree.begin(), tree.end());
+  for (int i = 0; i < 3000; ++i) {
+    check_against(set, expect, std::to_string(random_int()));
+  }
+
+  RBTree<int, std::greater<int>> desc;
+  for (int i = 0; i < 3000; ++i) desc.insert(random_int());
+  auto desc_set = desc.freeze();
+  std::vector<int> desc_expect(desc.begin(), desc.end());
+  for (int i = 0; i < 3000; ++i) {
+    check_against(desc_set, desc_expect, random_int());
+  }
+}
+
+int main() {
+  int_test();
+  float_test();
+  wide_test<uint32_t>(0x7fffffffu - 7000, 3);
+  wide_test<int64_t>(-(int64_t(1) << 40), int64_t(1) << 28);
+  wide_test<uint64_t>((uint64_t(1) << 63) - 7000, 3);
+  wide_test<double>(-1000.0, 0.5);
+  generic_test();
+  return 0;
+}
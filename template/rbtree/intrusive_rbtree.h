@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "template/rbtree/rbtree.h"
+
+/*
+侵入式红黑树的钩子：对象继承 RBTreeHook<Tag> 后可以直接链接进 IntrusiveRBTree，
+树不申请节点也不拷贝对象。继承多个 Tag 不同的钩子即可同时位于多棵树中：
+  struct Timer : RBTreeHook<ByDeadline>, RBTreeHook<ById> { ... };
+未链接时 parent 指向自身。拷贝对象得到未链接的钩子，不会复制链接关系。
+*/
+template <class Tag = void, class Augment = NoAugment>
+struct RBTreeHook {
+  RBTreeHook* parent = this;
+  RBTreeHook* lchild = nullptr;
+  RBTreeHook* rchild = nullptr;
+  Color color = Color::RED;
+  [[no_unique_address]] typename Augment::data aug;
+
+  RBTreeHook() = default;
+  RBTreeHook(const RBTreeHook&) noexcept {}
+  RBTreeHook& operator=(const RBTreeHook&) noexcept { return *this; }
+  // 对象销毁前需要先从树中删除
+  ~RBTreeHook() { assert(!is_linked()); }
+
+  bool is_linked() const noexcept { return parent != this; }
+  void reset() noexcept {
+    parent = this;
+    lchild = rchild = nullptr;
+    color = Color::RED;
+    aug = typename Augment::data();
+  }
+};
+
+// 节点为 T 继承的 RBTreeHook<Tag, Augment>，值即钩子所在的对象
+template <class Tag = void>
+struct IntrusiveLayout {
+  template <class T, class Augment>
+  struct links {
+    using node = RBTreeHook<Tag, Augment>;
+
+    static node* parent(const node* n) noexcept { return n->parent; }
+    static node* lchild(const node* n) noexcept { return n->lchild; }
+    static node* rchild(const node* n) noexcept { return n->rchild; }
+    static void set_parent(node* n, node* p) noexcept { n->parent = p; }
+    static void set_lchild(node* n, node* c) noexcept { n->lchild = c; }
+    static void set_rchild(node* n, node* c) noexcept { n->rchild = c; }
+    static Color color(const node* n) noexcept { return n->color; }
+    static void set_color(node* n, Color c) noexcept { n->color = c; }
+
+    static const T& value(const node* n) noexcept {
+      static_assert(std::is_base_of_v<node, T>,
+                    "T must derive from RBTreeHook<Tag, Augment>");
+      return static_cast<const T&>(*n);
+    }
+    static void unlink(node* n) noexcept { n->reset(); }
+
+    bool operator==(const links&) const = default;
+  };
+};
+
+/*
+侵入式有序集合，平衡部分直接复用 RBTree（旋转、insert_fix、remove_fix 都相同）：
+  insert(obj)  把 obj 的钩子链接进树，不申请内存；已存在相等的对象时不插入
+  erase(obj)   由对象直接删除，不需要查找，修复部分均摊 O(1)
+对象由调用者管理，树中的对象销毁前需要先 erase，树析构或 clear() 时其中的对象变为未链接。
+修改对象中参与比较的部分之前需要先 erase。同一个钩子同一时间只能位于一棵树中。
+*/
+template <class T, class Tag = void, class Comparator = std::less<T>,
+          class Augment = NoAugment>
+  requires KeyComparator<Comparator, T>
+class IntrusiveRBTree {
+ public:
+  using Hook = RBTreeHook<Tag, Augment>;
+  using Tree = RBTree<T, Comparator, std::allocator<T>, Augment,
+                      IntrusiveLayout<Tag>>;
+
+  // 双向迭代器，解引用得到树中的对象
+  class iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    iterator() = default;
+
+    reference operator*() const { return const_cast<T&>(*it_); }
+    pointer operator->() const { return &**this; }
+    iterator& operator++() {
+      ++it_;
+      return *this;
+    }
+    iterator& operator--() {
+      --it_;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator old = *this;
+      ++*this;
+      return old;
+    }
+    iterator operator--(int) {
+      iterator old = *this;
+      --*this;
+      return old;
+    }
+    bool operator==(const iterator& other) const = default;
+
+   private:
+    friend class IntrusiveRBTree;
+    iterator(typename Tree::const_iterator it) : it_(it) {}
+
+    typename Tree::const_iterator it_;
+  };
+  using const_iterator = iterator;
+
+  IntrusiveRBTree() = default;
+  explicit IntrusiveRBTree(const Comparator& comp) : tree_(comp) {}
+  IntrusiveRBTree(const IntrusiveRBTree&) = delete;
+  IntrusiveRBTree& operator=(const IntrusiveRBTree&) = delete;
+  IntrusiveRBTree(IntrusiveRBTree&&) noexcept = default;
+  IntrusiveRBTree& operator=(IntrusiveRBTree&&) noexcept = default;
+
+  // obj 需未链接在这个 Tag 的钩子上
+  bool insert(T& obj) {
+    assert(!hook(obj)->is_linked());
+    return tree_.link_node(hook(obj)).second;
+  }
+  // obj 需位于这棵树中
+  void erase(T& obj) {
+    assert(hook(obj)->is_linked());
+    tree_.erase(hook(obj));
+  }
+  template <class K = T>
+    requires LookupKey<Comparator, K, T>
+  bool remove(const K& key) {
+    return tree_.remove(key);
+  }
+
+  template <class K = T>
+    requires LookupKey<Comparator, K, T>
+  T* find(const K& key) const {
+    return object(tree_.find(key));
+  }
+  template <class K = T>
+    requires LookupKey<Comparator, K, T>
+  bool contains(const K& key) const {
+    return tree_.find(key) != nullptr;
+  }
+  template <class K = T>
+    requires LookupKey<Comparator, K, T>
+  iterator lower_bound(const K& key) const {
+    return tree_.lower_bound(key);
+  }
+  template <class K = T>
+    requires LookupKey<Comparator, K, T>
+  iterator upper_bound(const K& key) const {
+    return tree_.upper_bound(key);
+  }
+  iterator begin() const { return tree_.begin(); }
+  iterator end() const { return tree_.end(); }
+  // obj 需位于这棵树中
+  iterator iterator_to(T& obj) const { return tree_.iterator_to(hook(obj)); }
+  bool empty() const noexcept { return tree_.empty(); }
+  size_t size() const noexcept
+    requires SizeAugment<Augment, Hook>
+  {
+    return tree_.size();
+  }
+  // 把全部对象变为未链接，O(n)
+  void clear() noexcept { tree_.clear(); }
+  void swap(IntrusiveRBTree& other) noexcept { tree_.swap(other.tree_); }
+
+  auto tree() const -> const Tree& { return tree_; }
+
+ private:
+  static Hook* hook(T& obj) noexcept { return static_cast<Hook*>(&obj); }
+  static T* object(Hook* node) noexcept {
+    return node == nullptr ? nullptr : static_cast<T*>(node);
+  }
+
+  Tree tree_;
+};
@@ -0,0 +1,118 @@
+#include "template/rbtree/intrusive_rbtree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <set>
+#include <vector>
+
+std::random_device rd;
+std::mt19937 gen(rd());
+std::uniform_int_distribution<> dis(1, 100000);
+int random_int() { return dis(gen); }
+
+// 统计全局 operator new 的调用次数
+size_t allocations = 0;
+void* operator new(size_t size) {
+  ++allocations;
+  if (void* p = std::malloc(size)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct ByDeadline;
+struct ById;
+
+// 同时位于按截止时间、按 id 排序的两棵树中
+struct Timer : RBTreeHook<ByDeadline>, RBTreeHook<ById, OrderStatistic> {
+  int id;
+  int deadline;
+};
+
+struct DeadlineLess {
+  bool operator()(const Timer& a, const Timer& b) const {
+    return a.deadline != b.deadline ? a.deadline < b.deadline : a.id < b.id;
+  }
+};
+struct IdLess {
+  using is_transparent = void;
+  bool operator()(const Timer& a, const Timer& b) const { return a.id < b.id; }
+  bool operator()(const Timer& a, int b) const { return a.id < b; }
+  bool operator()(int a, const Timer& b) const { return a < b.id; }
+};
+
+using DeadlineTree = IntrusiveRBTree<Timer, ByDeadline, DeadlineLess>;
+using IdTree = IntrusiveRBTree<Timer, ById, IdLess, OrderStatistic>;
+
+// 与 std::set 对照随机插入、删除，插入和删除都不申请内存
+void multi_index_test() {
+  std::vector<Timer> timers(20000);
+  for (size_t i = 0; i < timers.size(); ++i) {
+    timers[i].id = static_cast<int>(i);
+    timers[i].deadline = random_int();
+  }
+  DeadlineTree by_deadline;
+  IdTree by_id;
+  std::set<std::pair<int, int>> expect;  // (deadline, id)
+  size_t tree_allocations = 0;
+  for (int round = 0; round < 100000; ++round) {
+    Timer& t = timers[random_int() % timers.size()];
+    size_t mark = allocations;
+    if (static_cast<IdTree::Hook&>(t).is_linked()) {
+      by_deadline.erase(t);
+      by_id.erase(t);
+      tree_allocations += allocations - mark;
+      expect.erase({t.deadline, t.id});
+      // 修改参与比较的部分前已经删除
+      t.deadline = random_int();
+    } else {
+      assert(by_deadline.insert(t));
+      assert(by_id.insert(t));
+      tree_allocations += allocations - mark;
+      expect.insert({t.deadline, t.id});
+    }
+  }
+  assert(tree_allocations == 0);
+  by_deadline.tree().check();
+  by_id.tree().check();
+  assert(by_id.size() == expect.size());
+  auto it = expect.begin();
+  for (Timer& t : by_deadline) {
+    assert(t.deadline == it->first && t.id == it->second);
+    ++it;
+  }
+  assert(it == expect.end());
+
+  // 透明查找、由对象得到迭代器
+  for (Timer& t : timers) {
+    Timer* found = by_id.find(t.id);
+    bool linked = static_cast<IdTree::Hook&>(t).is_linked();
+    assert(found == (linked ? &t : nullptr));
+    if (linked) {
+      auto pos = by_deadline.iterator_to(t);
+      assert(&*pos == &t);
+      if (pos != by_deadline.begin()) {
+        assert(DeadlineLess()(*std::prev(pos), t));
+      }
+    }
+  }
+  // 拷贝得到未链接的钩子；相等的对象已存在时不插入
+  Timer copy = *by_id.begin();
+  assert(!static_cast<IdTree::Hook&>(copy).is_linked());
+  assert(!by_id.insert(copy));
+  assert(!static_cast<IdTree::Hook&>(copy).is_linked());
+  assert(by_id.remove(copy.id) && by_id.size() == expect.size() - 1);
+  by_id.clear();
+  by_deadline.clear();
+  for (const Timer& t : timers) {
+    assert(!static_cast<const DeadlineTree::Hook&>(t).is_linked());
+  }
+}
+
+int main() {
+  multi_index_test();
+  return 0;
+}
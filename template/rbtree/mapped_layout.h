@@ -0,0 +1,270 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <typeinfo>
+
+#include "template/rbtree/node_layout.h"
+
+/*
+MappedLayout 的节点存储：节点保存在 mmap 映射的文件中，链接为32位的槽位下标
+（槽位在文件中的偏移 = kHeaderBytes + 下标 * sizeof(Node)），与映射地址无关。
+重新打开文件即得到原来的树，不需要反序列化，页面在访问时才由内核按需读入。
+  文件头占第一页：格式版本、节点与 key 的大小、key 的类型、槽位个数、空闲链表和根的下标
+  打开时预留最大可能的地址空间，文件增长时在原地址上重新映射，进程内节点地址保持不变
+  flush() 把脏页和根写回文件（msync）；两次 flush 之间进程崩溃时文件可能不一致，
+  打开后用 RBTree::verify() 检查
+同一个文件同时只能被一个对象打开（flock）。不是线程安全的。
+*/
+template <class Node>
+class MappedArena {
+ public:
+  static constexpr std::size_t kHeaderBytes = 4096;
+  static constexpr std::uint32_t kVersion = 1;
+  static constexpr std::uint32_t kMaxIndex = (std::uint32_t(1) << 31) - 1;
+  static constexpr std::uint64_t kInitialSlots = 4096;
+
+  // 打开 path，不存在或为空时创建。key_size 和 key_type 与文件记录的不一致时抛出异常
+  MappedArena(const char* path, std::uint32_t key_size, std::uint64_t key_type) {
+    fd_ = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) throw_errno("open");
+    try {
+      if (::flock(fd_, LOCK_EX | LOCK_NB) != 0) throw_errno("flock");
+      struct stat st;
+      if (::fstat(fd_, &st) != 0) throw_errno("fstat");
+      reserved_ = kHeaderBytes + (std::uint64_t(kMaxIndex) + 1) * sizeof(Node);
+      void* base = ::mmap(nullptr, reserved_, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (base == MAP_FAILED) throw_errno("mmap");
+      base_ = static_cast<char*>(base);
+      if (st.st_size == 0) {
+        map(kInitialSlots);
+        Header* h = header();
+        std::memcpy(h->magic, kMagic, sizeof(kMagic));
+        h->version = kVersion;
+        h->node_size = sizeof(Node);
+        h->key_size = key_size;
+        h->key_type = key_type;
+        h->capacity = kInitialSlots;
+        h->next = 1;
+      } else {
+        if (static_cast<std::size_t>(st.st_size) < kHeaderBytes) {
+          throw std::runtime_error("MappedArena: file too small");
+        }
+        Header h;
+        if (::pread(fd_, &h, sizeof(h), 0) != sizeof(h)) throw_errno("pread");
+        validate(h, st.st_size, key_size, key_type);
+        map(h.capacity);
+      }
+    } catch (...) {
+      close();
+      throw;
+    }
+  }
+  MappedArena(const MappedArena&) = delete;
+  MappedArena& operator=(const MappedArena&) = delete;
+  ~MappedArena() { close(); }
+
+  Node* at(std::uint32_t index) const noexcept {
+    return index == 0 ? nullptr : nodes() + index;
+  }
+  std::uint32_t index_of(const Node* node) const noexcept {
+    return node == nullptr ? 0 : static_cast<std::uint32_t>(node - nodes());
+  }
+  // node 是否指向已分配过的槽位，用于校验从文件读出的链接
+  bool owns(const Node* node) const noexcept {
+    return node > nodes() && node < nodes() + header()->next;
+  }
+
+  Node* allocate() {
+    Header* h = header();
+    if (h->free != 0) {
+      Node* node = at(h->free);
+      std::memcpy(&h->free, node, sizeof(h->free));
+      return node;
+    }
+    if (h->next == h->capacity) {
+      if (h->capacity > kMaxIndex) {
+        throw std::length_error("MappedArena: too many nodes");
+      }
+      std::uint64_t capacity =
+          std::min<std::uint64_t>(h->capacity * 2, std::uint64_t(kMaxIndex) + 1);
+      map(capacity);
+      header()->capacity = capacity;
+    }
+    return at(header()->next++);
+  }
+
+  // 空闲槽位的前4个字节存放下一个空闲下标
+  void deallocate(Node* node) noexcept {
+    Header* h = header();
+    std::memcpy(static_cast<void*>(node), &h->free, sizeof(h->free));
+    h->free = index_of(node);
+  }
+
+  std::uint32_t root() const noexcept { return header()->root; }
+  void set_root(std::uint32_t index) noexcept { header()->root = index; }
+
+  void flush() const {
+    if (::msync(base_, mapped_, MS_SYNC) != 0) throw_errno("msync");
+  }
+
+ private:
+  static constexpr char kMagic[8] = {'R', 'B', 'T', 'R', 'E', 'E', '\0', '\0'};
+
+  struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t node_size;
+    std::uint32_t key_size;
+    std::uint64_t key_type;  // key 类型名的哈希
+    std::uint64_t capacity;  // 文件中的槽位个数，含表示空链接的第0个
+    std::uint32_t next;      // 从未使用过的第一个槽位
+    std::uint32_t free;      // 空闲链表头
+    std::uint32_t root;
+  };
+  static_assert(sizeof(Header) <= kHeaderBytes);
+
+  [[noreturn]] static void throw_errno(const char* what) {
+    throw std::system_error(errno, std::generic_category(),
+                            std::string("MappedArena: ") + what);
+  }
+
+  static void validate(const Header& h, std::uint64_t file_size,
+                       std::uint32_t key_size, std::uint64_t key_type) {
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+      throw std::runtime_error("MappedArena: not a tree file");
+    }
+    if (h.version != kVersion) {
+      throw std::runtime_error("MappedArena: unsupported version");
+    }
+    if (h.node_size != sizeof(Node) || h.key_size != key_size ||
+        h.key_type != key_type) {
+      throw std::runtime_error("MappedArena: key type mismatch");
+    }
+    if (h.capacity == 0 || h.capacity > std::uint64_t(kMaxIndex) + 1 ||
+        file_size < kHeaderBytes + h.capacity * sizeof(Node) ||
+        h.next == 0 || h.next > h.capacity || h.free >= h.next ||
+        h.root >= h.next) {
+      throw std::runtime_error("MappedArena: corrupted header");
+    }
+  }
+
+  Header* header() const noexcept { return reinterpret_cast<Header*>(base_); }
+  Node* nodes() const noexcept {
+    return reinterpret_cast<Node*>(base_ + kHeaderBytes);
+  }
+
+  // 把文件扩展到 capacity 个槽位，并在预留的地址上重新映射整个文件
+  void map(std::uint64_t capacity) {
+    std::size_t bytes = kHeaderBytes + capacity * sizeof(Node);
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) throw_errno("fstat");
+    if (static_cast<std::size_t>(st.st_size) < bytes &&
+        ::ftruncate(fd_, bytes) != 0) {
+      throw_errno("ftruncate");
+    }
+    if (::mmap(base_, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+               fd_, 0) == MAP_FAILED) {
+      throw_errno("mmap");
+    }
+    mapped_ = bytes;
+  }
+
+  void close() noexcept {
+    if (base_ != nullptr) ::munmap(base_, reserved_);
+    if (fd_ >= 0) ::close(fd_);
+    base_ = nullptr;
+    fd_ = -1;
+  }
+
+  int fd_ = -1;
+  char* base_ = nullptr;
+  std::size_t reserved_ = 0;
+  std::size_t mapped_ = 0;
+};
+
+// 按类型名（FNV-1a）区分 key 类型，同一编译器下稳定
+template <class T>
+std::uint64_t key_type_id() noexcept {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (const char* p = typeid(T).name(); *p != '\0'; ++p) {
+    hash = (hash ^ static_cast<unsigned char>(*p)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// 节点与 IndexLayout 相同，保存在 MappedArena 中。T 和增强数据需要可平凡拷贝。
+// 满足 PersistentLinks：RBTree 由布局对象构造时恢复整棵树，析构时只把根写回
+struct MappedLayout {
+  template <class T, class Augment>
+  class links {
+   public:
+    using node = typename IndexLayout::links<T, Augment>::node;
+    static_assert(std::is_trivially_copyable_v<T> &&
+                      std::is_trivially_copyable_v<typename Augment::data>,
+                  "MappedLayout stores nodes as raw bytes");
+
+    // 打开（不存在时创建）保存树的文件
+    explicit links(const std::string& path)
+        : arena_(std::make_shared<MappedArena<node>>(
+              path.c_str(), sizeof(T), key_type_id<T>())) {}
+
+    node* parent(const node* n) const noexcept {
+      return arena_->at(n->parent_color >> 1);
+    }
+    node* lchild(const node* n) const noexcept { return arena_->at(n->lchild); }
+    node* rchild(const node* n) const noexcept { return arena_->at(n->rchild); }
+    void set_parent(node* n, node* p) const noexcept {
+      n->parent_color = arena_->index_of(p) << 1 | (n->parent_color & 1);
+    }
+    void set_lchild(node* n, node* c) const noexcept {
+      n->lchild = arena_->index_of(c);
+    }
+    void set_rchild(node* n, node* c) const noexcept {
+      n->rchild = arena_->index_of(c);
+    }
+    static Color color(const node* n) noexcept {
+      return n->parent_color & 1 ? Color::BLACK : Color::RED;
+    }
+    static void set_color(node* n, Color c) noexcept {
+      n->parent_color = (n->parent_color & ~std::uint32_t(1)) |
+                        (c == Color::BLACK ? 1 : 0);
+    }
+
+    template <class Alloc>
+    node* allocate(Alloc&) {
+      return arena_->allocate();
+    }
+    template <class Alloc>
+    void deallocate(Alloc&, node* n) noexcept {
+      arena_->deallocate(n);
+    }
+
+    node* root() const noexcept { return arena_->at(arena_->root()); }
+    void set_root(node* n) const noexcept {
+      arena_->set_root(arena_->index_of(n));
+    }
+    void flush() const { arena_->flush(); }
+    bool owns(const node* n) const noexcept { return arena_->owns(n); }
+
+    bool operator==(const links&) const = default;
+
+   private:
+    std::shared_ptr<MappedArena<node>> arena_;
+  };
+};
@@ -0,0 +1,161 @@
+#include "template/rbtree/mapped_layout.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+#include "template/rbtree/rbtree.h"
+
+std::random_device rd;
+std::mt19937 gen(rd());
+std::uniform_int_distribution<> dis(1, 1000000);
+int random_int() { return dis(gen); }
+
+using Tree = RBTree<int, std::less<int>, std::allocator<int>, OrderStatistic,
+                    MappedLayout>;
+
+std::string temp_path() {
+  char path[] = "/tmp/mapped_layout_test.XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+  return path;
+}
+
+void check_equal(const Tree& tree, const std::set<int>& expect) {
+  assert(tree.verify());
+  assert(tree.size() == expect.size());
+  assert(std::equal(tree.begin(), tree.end(), expect.begin(), expect.end()));
+}
+
+// 写入、关闭、重新打开后继续修改，内容与 std::set 一致
+void reopen_test() {
+  std::string path = temp_path();
+  std::set<int> expect;
+  for (int round = 0; round < 5; ++round) {
+    Tree tree(MappedLayout::links<int, OrderStatistic>{path});
+    check_equal(tree, expect);
+    // 第一轮插入的节点数超过初始容量，覆盖文件增长后的重新映射
+    for (int i = 0; i < 20000; ++i) {
+      int x = random_int();
+      assert(tree.insert(x) == expect.insert(x).second);
+    }
+    for (int i = 0; i < 10000; ++i) {
+      int x = random_int();
+      assert(tree.remove(x) == (expect.erase(x) == 1));
+    }
+    if (round % 2 == 0) tree.flush();
+    check_equal(tree, expect);
+  }
+  // 删空后重新打开得到空树，之后插入复用空闲槽位
+  {
+    Tree tree(MappedLayout::links<int, OrderStatistic>{path});
+    for (int x : expect) assert(tree.remove(x));
+  }
+  {
+    Tree tree(MappedLayout::links<int, OrderStatistic>{path});
+    assert(tree.begin() == tree.end() && tree.verify());
+    tree.insert(1);
+  }
+  std::remove(path.c_str());
+}
+
+// 与其它树共享布局对象：split 出的树析构时释放节点，恢复的树只保存根
+void share_test() {
+  std::string path = temp_path();
+  std::set<int> expect;
+  {
+    MappedLayout::links<int, OrderStatistic> layout{path};
+    Tree tree(layout);
+    for (int i = 0; i < 1000; ++i) expect.insert(i), tree.insert(i);
+    Tree greater(std::allocator<int>(), layout);
+    tree.split(500, greater);
+    assert(greater.size() == 500);
+    expect.erase(expect.lower_bound(500), expect.end());
+  }
+  {
+    Tree tree(MappedLayout::links<int, OrderStatistic>{path});
+    check_equal(tree, expect);
+  }
+  std::remove(path.c_str());
+}
+
+// 文件头不匹配、重复打开时抛出异常
+void header_test() {
+  std::string path = temp_path();
+  {
+    MappedLayout::links<int, NoAugment> layout{path};
+    bool thrown = false;
+    try {
+      MappedLayout::links<int, NoAugment> again{path};
+    } catch (const std::system_error&) {
+      thrown = true;
+    }
+    assert(thrown);
+  }
+  bool thrown = false;
+  try {
+    MappedLayout::links<float, NoAugment> layout{path};
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  assert(thrown);
+  std::remove(path.c_str());
+}
+
+// 破坏节点数据后 verify() 返回 false，不会访问文件以外的内存
+void corrupt_test() {
+  std::string path = temp_path();
+  using Node = Tree::Node;
+  {
+    Tree tree(MappedLayout::links<int, OrderStatistic>{path});
+    for (int i = 0; i < 1000; ++i) tree.insert(i);
+    tree.flush();
+  }
+  struct Case {
+    size_t offset;
+    uint32_t value;
+  };
+  // 根的后代：下标 2 的父链接指向越界的槽位；下标 3 的右孩子指向自己；值乱序
+  for (Case c : {Case{offsetof(Node, parent_color), 0x7fffffff},
+                 Case{offsetof(Node, rchild), 3},
+                 Case{offsetof(Node, value), 0x7fffffff}}) {
+    std::string copy = temp_path();
+    {
+      std::FILE* in = std::fopen(path.c_str(), "rb");
+      std::FILE* out = std::fopen(copy.c_str(), "wb");
+      char buf[4096];
+      for (size_t n; (n = std::fread(buf, 1, sizeof(buf), in)) > 0;) {
+        std::fwrite(buf, 1, n, out);
+      }
+      std::fclose(in);
+      std::fclose(out);
+    }
+    int fd = open(copy.c_str(), O_RDWR);
+    size_t index = c.offset == offsetof(Node, rchild) ? 3 : 2;
+    off_t pos = MappedArena<Node>::kHeaderBytes + index * sizeof(Node) + c.offset;
+    assert(pwrite(fd, &c.value, sizeof(c.value), pos) == sizeof(c.value));
+    close(fd);
+    {
+      Tree tree(MappedLayout::links<int, OrderStatistic>{copy});
+      assert(!tree.verify());
+    }
+    std::remove(copy.c_str());
+  }
+  std::remove(path.c_str());
+}
+
+int main() {
+  reopen_test();
+  share_test();
+  header_test();
+  corrupt_test();
+  return 0;
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "template/define.h"
+
+/*
+节点布局策略 Layout：决定父子链接和颜色在节点中的存储方式。
+Layout::links<T, Augment> 是树持有的布局对象，提供：
+  node                                   节点类型，对外只暴露 value 和 aug
+  parent/lchild/rchild(const node*)      读取链接，空链接为 nullptr
+  set_parent/set_lchild/set_rchild(node*, node*)
+  color(const node*) / set_color(node*, Color)
+  allocate(alloc) / deallocate(alloc, node*)  节点内存的申请与归还（不负责构造）
+树之间移动节点（join/split/集合运算）时，两棵树的布局对象需要相等。
+
+  PointerLayout  三个指针加独立的颜色字段（默认）
+  PackedLayout   颜色存放在父指针的最低位，省去颜色字段及其对齐填充
+  IndexLayout    节点存放在分块的连续数组中，链接为32位下标，颜色存放在父下标的最低位。
+                 int 节点从32字节降为16字节，但不经过 Allocator，最多容纳 2^31 - 1 个节点
+  MappedLayout   （mapped_layout.h）节点格式同 IndexLayout，保存在 mmap 映射的文件中，
+                 满足 PersistentLinks，进程重启后可以直接打开
+  IntrusiveLayout（intrusive_rbtree.h）节点是值对象自身继承的钩子，满足 IntrusiveLinks，
+                 不提供 allocate/deallocate
+*/
+
+struct NoAugment;
+
+template <class T, class Augment = NoAugment>
+struct RBTreeNode {
+  RBTreeNode* parent = nullptr;
+  RBTreeNode* lchild = nullptr;
+  RBTreeNode* rchild = nullptr;
+  Color color = Color::RED;
+  T value;
+  [[no_unique_address]] typename Augment::data aug;
+
+  template <class... Args>
+  explicit RBTreeNode(Args&&... args) : value(std::forward<Args>(args)...) {}
+};
+
+struct PointerLayout {
+  template <class T, class Augment>
+  struct links {
+    using node = RBTreeNode<T, Augment>;
+
+    static node* parent(const node* n) noexcept { return n->parent; }
+    static node* lchild(const node* n) noexcept { return n->lchild; }
+    static node* rchild(const node* n) noexcept { return n->rchild; }
+    static void set_parent(node* n, node* p) noexcept { n->parent = p; }
+    static void set_lchild(node* n, node* c) noexcept { n->lchild = c; }
+    static void set_rchild(node* n, node* c) noexcept { n->rchild = c; }
+    static Color color(const node* n) noexcept { return n->color; }
+    static void set_color(node* n, Color c) noexcept { n->color = c; }
+
+    template <class Alloc>
+    static node* allocate(Alloc& alloc) {
+      return std::allocator_traits<Alloc>::allocate(alloc, 1);
+    }
+    template <class Alloc>
+    static void deallocate(Alloc& alloc, node* n) noexcept {
+      std::allocator_traits<Alloc>::deallocate(alloc, n, 1);
+    }
+
+    bool operator==(const links&) const = default;
+  };
+};
+
+struct PackedLayout {
+  template <class T, class Augment>
+  struct links {
+    struct node {
+      std::uintptr_t parent_color = 0;  // 节点至少按指针对齐，最低位空闲，1 表示黑色
+      node* lchild = nullptr;
+      node* rchild = nullptr;
+      T value;
+      [[no_unique_address]] typename Augment::data aug;
+
+      template <class... Args>
+      explicit node(Args&&... args) : value(std::forward<Args>(args)...) {}
+    };
+    static_assert(alignof(node) >= 2);
+
+    static node* parent(const node* n) noexcept {
+      return reinterpret_cast<node*>(n->parent_color & ~std::uintptr_t(1));
+    }
+    static node* lchild(const node* n) noexcept { return n->lchild; }
+    static node* rchild(const node* n) noexcept { return n->rchild; }
+    static void set_parent(node* n, node* p) noexcept {
+      n->parent_color =
+          reinterpret_cast<std::uintptr_t>(p) | (n->parent_color & 1);
+    }
+    static void set_lchild(node* n, node* c) noexcept { n->lchild = c; }
+    static void set_rchild(node* n, node* c) noexcept { n->rchild = c; }
+    static Color color(const node* n) noexcept {
+      return n->parent_color & 1 ? Color::BLACK : Color::RED;
+    }
+    static void set_color(node* n, Color c) noexcept {
+      n->parent_color = (n->parent_color & ~std::uintptr_t(1)) |
+                        (c == Color::BLACK ? 1 : 0);
+    }
+
+    template <class Alloc>
+    static node* allocate(Alloc& alloc) {
+      return std::allocator_traits<Alloc>::allocate(alloc, 1);
+    }
+    template <class Alloc>
+    static void deallocate(Alloc& alloc, node* n) noexcept {
+      std::allocator_traits<Alloc>::deallocate(alloc, n, 1);
+    }
+
+    bool operator==(const links&) const = default;
+  };
+};
+
+/*
+IndexLayout 的节点存储：每块 kChunkNodes（2的幂）个槽位，下标 = 块号 * kChunkNodes + 槽位。
+块的首地址按块大小对齐，块内第0个槽位存放块号，因此可以由节点地址反查下标；
+第0块的第0个槽位对应下标0，恰好用来表示空链接。
+已分配的节点地址在释放前保持不变。不是线程安全的。
+*/
+template <class Node>
+class NodeArena {
+ public:
+  static constexpr std::size_t kChunkNodes =
+      std::bit_floor(std::max<std::size_t>(65536 / sizeof(Node), 2));
+  static constexpr std::size_t kChunkBytes =
+      std::bit_ceil(kChunkNodes * sizeof(Node));
+  // 父下标需要留出一位存放颜色
+  static constexpr std::uint32_t kMaxIndex = (std::uint32_t(1) << 31) - 1;
+
+  NodeArena() = default;
+  NodeArena(const NodeArena&) = delete;
+  NodeArena& operator=(const NodeArena&) = delete;
+  ~NodeArena() { release(); }
+
+  Node* at(std::uint32_t index) const noexcept {
+    if (index == 0) return nullptr;
+    return chunks_[index / kChunkNodes] + index % kChunkNodes;
+  }
+
+  std::uint32_t index_of(const Node* node) const noexcept {
+    if (node == nullptr) return 0;
+    auto chunk = reinterpret_cast<const Node*>(
+        reinterpret_cast<std::uintptr_t>(node) & ~(kChunkBytes - 1));
+    return *reinterpret_cast<const std::uint32_t*>(chunk) * kChunkNodes +
+           static_cast<std::uint32_t>(node - chunk);
+  }
+
+  Node* allocate() {
+    if (free_ != 0) {
+      Node* node = at(free_);
+      std::memcpy(&free_, node, sizeof(free_));
+      return node;
+    }
+    if (next_ % kChunkNodes == 0) {
+      if ((chunks_.size() + 1) * kChunkNodes - 1 > kMaxIndex) {
+        throw std::length_error("NodeArena: too many nodes");
+      }
+      auto chunk = static_cast<Node*>(
+          ::operator new(kChunkBytes, std::align_val_t(kChunkBytes)));
+      auto id = static_cast<std::uint32_t>(chunks_.size());
+      std::memcpy(static_cast<void*>(chunk), &id, sizeof(id));
+      chunks_.push_back(chunk);
+      next_ = id * kChunkNodes + 1;
+    }
+    return at(next_++);
+  }
+
+  // 空闲槽位的前4个字节存放下一个空闲下标
+  void deallocate(Node* node) noexcept {
+    std::memcpy(static_cast<void*>(node), &free_, sizeof(free_));
+    free_ = index_of(node);
+  }
+
+  void release() noexcept {
+    for (Node* chunk : chunks_) {
+      ::operator delete(static_cast<void*>(chunk),
+                        std::align_val_t(kChunkBytes));
+    }
+    chunks_.clear();
+    free_ = next_ = 0;
+  }
+
+ private:
+  std::vector<Node*> chunks_;
+  std::uint32_t free_ = 0;
+  std::uint64_t next_ = 0;
+};
+
+struct IndexLayout {
+  template <class T, class Augment>
+  class links {
+   public:
+    struct node {
+      std::uint32_t parent_color = 0;  // 父下标 << 1 | 颜色，1 表示黑色
+      std::uint32_t lchild = 0;
+      std::uint32_t rchild = 0;
+      T value;
+      [[no_unique_address]] typename Augment::data aug;
+
+      template <class... Args>
+      explicit node(Args&&... args) : value(std::forward<Args>(args)...) {}
+    };
+    static_assert(sizeof(node) >= sizeof(std::uint32_t));
+
+    // 默认构造使用新的节点数组；拷贝后共享同一个节点数组，可以互相交换节点
+    links() : arena_(std::make_shared<NodeArena<node>>()) {}
+
+    node* parent(const node* n) const noexcept {
+      return arena_->at(n->parent_color >> 1);
+    }
+    node* lchild(const node* n) const noexcept { return arena_->at(n->lchild); }
+    node* rchild(const node* n) const noexcept { return arena_->at(n->rchild); }
+    void set_parent(node* n, node* p) const noexcept {
+      n->parent_color = arena_->index_of(p) << 1 | (n->parent_color & 1);
+    }
+    void set_lchild(node* n, node* c) const noexcept {
+      n->lchild = arena_->index_of(c);
+    }
+    void set_rchild(node* n, node* c) const noexcept {
+      n->rchild = arena_->index_of(c);
+    }
+    static Color color(const node* n) noexcept {
+      return n->parent_color & 1 ? Color::BLACK : Color::RED;
+    }
+    static void set_color(node* n, Color c) noexcept {
+      n->parent_color = (n->parent_color & ~std::uint32_t(1)) |
+                        (c == Color::BLACK ? 1 : 0);
+    }
+
+    template <class Alloc>
+    node* allocate(Alloc&) {
+      return arena_->allocate();
+    }
+    template <class Alloc>
+    void deallocate(Alloc&, node* n) noexcept {
+      arena_->deallocate(n);
+    }
+
+    // 当前对象是节点数组唯一的持有者时，整体归还所有块并返回true
+    bool release() noexcept {
+      if (arena_.use_count() != 1) return false;
+      arena_->release();
+      return true;
+    }
+
+    bool operator==(const links&) const = default;
+
+   private:
+    std::shared_ptr<NodeArena<node>> arena_;
+  };
+};
+
+// 节点保存在外部存储中、重启后可以恢复的布局（如 MappedLayout）额外提供：
+//   root() / set_root(node*)  读写存储中记录的根
+//   flush()                   把节点和根写回存储
+//   owns(const node*)         是否指向存储中已分配的节点，用于校验读出的链接
+template <class Links, class Node>
+concept PersistentLinks = requires(const Links& links, Node* node) {
+  { links.root() } -> std::same_as<Node*>;
+  links.set_root(node);
+  links.flush();
+  { links.owns(node) } -> std::same_as<bool>;
+};
+
+// 侵入式布局（如 IntrusiveLayout）：节点是调用者对象中的钩子，树不申请也不释放节点，额外提供
+//   value(const node*)  钩子所在的对象，代替 node->value
+//   unlink(node*)       节点离开树（erase、clear）时调用，恢复为未链接状态
+template <class Links, class Node>
+concept IntrusiveLinks = requires(Links& links, const Node* cnode, Node* node) {
+  Links::value(cnode);
+  links.unlink(node);
+};
@@ -0,0 +1,480 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "template/define.h"
+
+/*
+持久化（路径复制）红黑树：snapshot() 以 O(1) 得到当前版本的只读句柄，之后的修改不影响它。
+
+  节点没有父指针，带引用计数，多个版本共享未修改的子树。
+  insert / remove 自根向下定位时，把路径上被其它版本共享（引用计数大于1）的节点复制一份，
+  复制品引用原节点的孩子；再以记录下来的路径代替父指针做 insert_fix / remove_fix，
+  修复时会改动的叔叔、兄弟、侄子节点同样先复制。每次修改复制 O(log n) 个节点。
+  节点只被当前版本引用时直接原地修改，没有快照时与普通红黑树一样不申请额外节点。
+
+  快照可以交给其它线程读取和释放，引用计数为原子变量；同一个树对象的修改需要串行。
+*/
+template <class T, class Comparator = std::less<T>>
+  requires KeyComparator<Comparator, T>
+class PersistentRBTree {
+  struct Node {
+    T value;
+    Node* lchild = nullptr;
+    Node* rchild = nullptr;
+    Color color = Color::RED;
+    std::atomic<uint32_t> refs{1};  // 引用该节点的父节点和版本个数
+
+    template <class... Args>
+    explicit Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+  };
+
+  static void retain(Node* node) noexcept {
+    if (node != nullptr) node->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  // 引用计数归零时释放节点，并递归释放它对孩子的引用
+  static void release(Node* node) noexcept {
+    while (node != nullptr &&
+           node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      release(node->lchild);
+      Node* rchild = node->rchild;
+      delete node;
+      node = rchild;
+    }
+  }
+
+ public:
+  using value_type = T;
+  using size_type = size_t;
+
+  // 前向迭代器，以栈保存尚未访问的祖先，值不可修改
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return stack_.back()->value; }
+    pointer operator->() const { return &stack_.back()->value; }
+    const_iterator& operator++() {
+      const Node* node = stack_.back();
+      stack_.pop_back();
+      push_left(node->rchild);
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+    bool operator==(const const_iterator& other) const {
+      return stack_.empty() ? other.stack_.empty()
+                            : !other.stack_.empty() &&
+                                  stack_.back() == other.stack_.back();
+    }
+
+   private:
+    friend class PersistentRBTree;
+    void push_left(const Node* node) {
+      for (; node != nullptr; node = node->lchild) stack_.push_back(node);
+    }
+
+    std::vector<const Node*> stack_;
+  };
+  using iterator = const_iterator;
+
+  // 某个版本的只读句柄，持有根节点的一个引用。拷贝为 O(1)
+  class Snapshot {
+   public:
+    Snapshot() = default;
+    Snapshot(const Snapshot& other)
+        : root_(other.root_), size_(other.size_), comp_(other.comp_) {
+      retain(root_);
+    }
+    Snapshot(Snapshot&& other) noexcept
+        : root_(std::exchange(other.root_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          comp_(other.comp_) {}
+    Snapshot& operator=(Snapshot other) noexcept {
+      std::swap(root_, other.root_);
+      std::swap(size_, other.size_);
+      std::swap(comp_, other.comp_);
+      return *this;
+    }
+    ~Snapshot() { release(root_); }
+
+    // 不存在时返回空
+    auto find(const T& key) const -> const T* { return find<T>(key); }
+    template <class K>
+      requires LookupKey<Comparator, K, T>
+    auto find(const K& key) const -> const T*;
+    bool contains(const T& key) const { return find(key) != nullptr; }
+    template <class K>
+      requires LookupKey<Comparator, K, T>
+    bool contains(const K& key) const {
+      return find(key) != nullptr;
+    }
+    // 第一个 >= key 的位置
+    auto lower_bound(const T& key) const -> const_iterator {
+      return lower_bound<T>(key);
+    }
+    template <class K>
+      requires LookupKey<Comparator, K, T>
+    auto lower_bound(const K& key) const -> const_iterator;
+
+    auto begin() const -> const_iterator {
+      const_iterator it;
+      it.push_left(root_);
+      return it;
+    }
+    auto end() const -> const_iterator { return {}; }
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+   private:
+    friend class PersistentRBTree;
+    explicit Snapshot(const Comparator& comp) : comp_(comp) {}
+
+    Node* root_ = nullptr;
+    size_t size_ = 0;
+    [[no_unique_address]] Comparator comp_;
+  };
+
+  PersistentRBTree() = default;
+  explicit PersistentRBTree(const Comparator& comp) : head_(comp) {}
+  // 以某个快照为当前版本继续修改，O(1)
+  explicit PersistentRBTree(const Snapshot& snapshot) : head_(snapshot) {}
+  PersistentRBTree(const PersistentRBTree& other) : head_(other.head_) {}
+  PersistentRBTree& operator=(const PersistentRBTree& other) {
+    head_ = other.head_;
+    return *this;
+  }
+
+  // 当前版本的只读句柄，O(1)
+  auto snapshot() const -> Snapshot { return head_; }
+
+  bool insert(const T& val);
+  bool remove(const T& key);
+
+  auto find(const T& key) const -> const T* { return head_.find(key); }
+  bool contains(const T& key) const { return head_.contains(key); }
+  auto lower_bound(const T& key) const -> const_iterator {
+    return head_.lower_bound(key);
+  }
+  auto begin() const -> const_iterator { return head_.begin(); }
+  auto end() const -> const_iterator { return head_.end(); }
+  size_t size() const noexcept { return head_.size(); }
+  bool empty() const noexcept { return head_.empty(); }
+
+  // for debug
+  void check() const;
+
+ private:
+  static bool is_black(const Node* node) noexcept {
+    return node == nullptr || node->color == Color::BLACK;
+  }
+  // 保证 *link 只被当前版本引用，必要时复制后替换，返回可以修改的节点
+  static auto mutate(Node** link) -> Node*;
+  static void left_rotate(Node** link) noexcept;
+  static void right_rotate(Node** link) noexcept;
+  // 指向 path_[i] 的链接：path_[i - 1] 的孩子或根
+  auto link_of(size_t i) noexcept -> Node**;
+  void insert_fix() noexcept;
+  // x 为替换被删除节点的子树（可能为空），path_ 为它的祖先
+  void remove_fix(Node* x);
+  int post_travel(const Node* node) const;
+
+  Snapshot head_;
+  // 修改时自根向下的路径，path_[i + 1] 是 path_[i] 的孩子，都只被当前版本引用
+  std::vector<Node*> path_;
+};
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+auto PersistentRBTree<T, U>::Snapshot::find(const K& key) const -> const T* {
+  const Node* cur = root_;
+  while (cur != nullptr) {
+    if (comp_(key, cur->value)) {
+      cur = cur->lchild;
+    } else if (comp_(cur->value, key)) {
+      cur = cur->rchild;
+    } else {
+      return &cur->value;
+    }
+  }
+  return nullptr;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+auto PersistentRBTree<T, U>::Snapshot::lower_bound(const K& key) const
+    -> const_iterator {
+  // 栈中保留向左转的节点，即 key 之后的中序序列
+  const_iterator it;
+  for (const Node* cur = root_; cur != nullptr;) {
+    if (comp_(cur->value, key)) {
+      cur = cur->rchild;
+    } else {
+      it.stack_.push_back(cur);
+      cur = cur->lchild;
+    }
+  }
+  return it;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+auto PersistentRBTree<T, U>::mutate(Node** link) -> Node* {
+  Node* node = *link;
+  if (node->refs.load(std::memory_order_acquire) == 1) return node;
+  Node* copy = new Node(node->value);
+  copy->lchild = node->lchild;
+  copy->rchild = node->rchild;
+  copy->color = node->color;
+  retain(copy->lchild);
+  retain(copy->rchild);
+  release(node);
+  *link = copy;
+  return copy;
+}
+
+// 旋转上来的孩子需要已经只被当前版本引用，被移动的内侧子树只换了父节点，引用数不变
+template <class T, class U>
+  requires KeyComparator<U, T>
+void PersistentRBTree<T, U>::left_rotate(Node** link) noexcept {
+  Node* node = *link;
+  Node* rchild = node->rchild;
+  node->rchild = rchild->lchild;
+  rchild->lchild = node;
+  *link = rchild;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void PersistentRBTree<T, U>::right_rotate(Node** link) noexcept {
+  Node* node = *link;
+  Node* lchild = node->lchild;
+  node->lchild = lchild->rchild;
+  lchild->rchild = node;
+  *link = lchild;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+auto PersistentRBTree<T, U>::link_of(size_t i) noexcept -> Node** {
+  if (i == 0) return &head_.root_;
+  Node* parent = path_[i - 1];
+  return parent->lchild == path_[i] ? &parent->lchild : &parent->rchild;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool PersistentRBTree<T, U>::insert(const T& val) {
+  // 先确认不存在，避免无谓的复制
+  if (head_.find(val) != nullptr) return false;
+  path_.clear();
+  Node** link = &head_.root_;
+  while (*link != nullptr) {
+    Node* node = mutate(link);
+    path_.push_back(node);
+    link = head_.comp_(val, node->value) ? &node->lchild : &node->rchild;
+  }
+  *link = new Node(val);
+  path_.push_back(*link);
+  insert_fix();
+  ++head_.size_;
+  return true;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void PersistentRBTree<T, U>::insert_fix() noexcept {
+  size_t i = path_.size() - 1;
+  // 父节点为红色时一定不是根，祖父存在
+  while (i >= 2 && path_[i - 1]->color == Color::RED) {
+    Node *node = path_[i], *parent = path_[i - 1], *grandpa = path_[i - 2];
+    bool is_parent_left = grandpa->lchild == parent;
+    Node** uncle = is_parent_left ? &grandpa->rchild : &grandpa->lchild;
+    if (!is_black(*uncle)) {
+      mutate(uncle)->color = Color::BLACK;
+      parent->color = Color::BLACK;
+      grandpa->color = Color::RED;
+      i -= 2;
+      continue;
+    }
+    // 内侧孩子先转到外侧
+    if ((parent->lchild == node) != is_parent_left) {
+      is_parent_left ? left_rotate(&grandpa->lchild)
+                     : right_rotate(&grandpa->rchild);
+      parent = node;
+    }
+    is_parent_left ? right_rotate(link_of(i - 2)) : left_rotate(link_of(i - 2));
+    parent->color = Color::BLACK;
+    grandpa->color = Color::RED;
+    break;
+  }
+  head_.root_->color = Color::BLACK;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool PersistentRBTree<T, U>::remove(const T& key) {
+  if (head_.find(key) == nullptr) return false;
+  path_.clear();
+  Node** link = &head_.root_;
+  while (true) {
+    Node* node = mutate(link);
+    path_.push_back(node);
+    if (head_.comp_(key, node->value)) {
+      link = &node->lchild;
+    } else if (head_.comp_(node->value, key)) {
+      link = &node->rchild;
+    } else {
+      break;
+    }
+  }
+  // 有两个孩子时把后继的值移过来，改为删除后继
+  Node* target = path_.back();
+  if (target->lchild != nullptr && target->rchild != nullptr) {
+    link = &target->rchild;
+    while (true) {
+      Node* node = mutate(link);
+      path_.push_back(node);
+      if (node->lchild == nullptr) break;
+      link = &node->lchild;
+    }
+    target->value = std::move(path_.back()->value);
+    target = path_.back();
+  }
+  Node* child = target->lchild != nullptr ? target->lchild : target->rchild;
+  *link_of(path_.size() - 1) = child;
+  path_.pop_back();
+  Color color = target->color;
+  target->lchild = target->rchild = nullptr;
+  delete target;
+  --head_.size_;
+  if (color == Color::BLACK) remove_fix(child);
+  return true;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void PersistentRBTree<T, U>::remove_fix(Node* x) {
+  while (!path_.empty() && is_black(x)) {
+    size_t j = path_.size() - 1;
+    Node* parent = path_[j];
+    // x 为空时兄弟一定不为空，不会与兄弟混淆
+    if (parent->lchild == x) {
+      Node* sibling = mutate(&parent->rchild);
+      if (sibling->color == Color::RED) {
+        sibling->color = Color::BLACK;
+        parent->color = Color::RED;
+        left_rotate(link_of(j));
+        path_[j] = sibling;
+        path_.push_back(parent);
+        ++j;
+        sibling = mutate(&parent->rchild);
+      }
+      if (is_black(sibling->lchild) && is_black(sibling->rchild)) {
+        sibling->color = Color::RED;
+        x = parent;
+        path_.pop_back();
+        continue;
+      }
+      if (is_black(sibling->rchild)) {
+        mutate(&sibling->lchild)->color = Color::BLACK;
+        sibling->color = Color::RED;
+        right_rotate(&parent->rchild);
+        sibling = parent->rchild;
+      }
+      sibling->color = parent->color;
+      parent->color = Color::BLACK;
+      mutate(&sibling->rchild)->color = Color::BLACK;
+      left_rotate(link_of(j));
+    } else {
+      Node* sibling = mutate(&parent->lchild);
+      if (sibling->color == Color::RED) {
+        sibling->color = Color::BLACK;
+        parent->color = Color::RED;
+        right_rotate(link_of(j));
+        path_[j] = sibling;
+        path_.push_back(parent);
+        ++j;
+        sibling = mutate(&parent->lchild);
+      }
+      if (is_black(sibling->lchild) && is_black(sibling->rchild)) {
+        sibling->color = Color::RED;
+        x = parent;
+        path_.pop_back();
+        continue;
+      }
+      if (is_black(sibling->lchild)) {
+        mutate(&sibling->rchild)->color = Color::BLACK;
+        sibling->color = Color::RED;
+        left_rotate(&parent->lchild);
+        sibling = parent->lchild;
+      }
+      sibling->color = parent->color;
+      parent->color = Color::BLACK;
+      mutate(&sibling->lchild)->color = Color::BLACK;
+      right_rotate(link_of(j));
+    }
+    path_.clear();
+    x = head_.root_;
+  }
+  // 红色的 x 可能被其它版本共享，染黑前先复制
+  if (!is_black(x)) {
+    Node** link = &head_.root_;
+    if (!path_.empty()) {
+      Node* parent = path_.back();
+      link = parent->lchild == x ? &parent->lchild : &parent->rchild;
+    }
+    mutate(link)->color = Color::BLACK;
+  }
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void PersistentRBTree<T, U>::check() const {
+  const Node* root = head_.root_;
+  if (root == nullptr) {
+    assert(head_.size_ == 0);
+    return;
+  }
+  assert(root->color == Color::BLACK);
+  post_travel(root);
+  assert(static_cast<size_t>(std::distance(begin(), end())) == head_.size_);
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+int PersistentRBTree<T, U>::post_travel(const Node* node) const {
+  if (node == nullptr) return 1;
+  assert(node->refs.load() >= 1);
+  if (node->lchild != nullptr) {
+    assert(head_.comp_(node->lchild->value, node->value));
+    assert(node->color == Color::BLACK || is_black(node->lchild));
+  }
+  if (node->rchild != nullptr) {
+    assert(head_.comp_(node->value, node->rchild->value));
+    assert(node->color == Color::BLACK || is_black(node->rchild));
+  }
+  auto lcnt = post_travel(node->lchild);
+  auto rcnt = post_travel(node->rchild);
+  assert(lcnt == rcnt);
+  return node->color == Color::BLACK ? lcnt + 1 : lcnt;
+}
@@ -0,0 +1,137 @@
+#include "template/rbtree/persistent_rbtree.h"
+
+#include <cassert>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+std::random_device rd;
+std::mt19937 gen(rd());
+std::uniform_int_distribution<> dis(1, 1000000);
+int random_int() { return dis(gen); }
+
+// 统计存活对象个数，检查版本释放后节点全部回收
+struct Counted {
+  static inline int alive = 0;
+  int key;
+
+  Counted(int k) : key(k) { ++alive; }
+  Counted(const Counted& other) : key(other.key) { ++alive; }
+  Counted& operator=(const Counted&) = default;
+  ~Counted() { --alive; }
+  bool operator<(const Counted& other) const { return key < other.key; }
+};
+
+void basic_test() {
+  PersistentRBTree<int> tree;
+  std::set<int> expect;
+  for (int i = 0; i < 50000; ++i) {
+    int temp = random_int() % 10000;
+    if (i % 3 == 0) {
+      assert(tree.remove(temp) == (expect.erase(temp) == 1));
+    } else {
+      assert(tree.insert(temp) == expect.insert(temp).second);
+    }
+  }
+  tree.check();
+  assert(tree.size() == expect.size());
+  assert(std::equal(tree.begin(), tree.end(), expect.begin(), expect.end()));
+  for (int i = 0; i < 1000; ++i) {
+    int temp = random_int() % 10002 - 1;
+    assert(tree.contains(temp) == expect.count(temp));
+    auto lower = tree.lower_bound(temp);
+    auto expect_lower = expect.lower_bound(temp);
+    assert(std::equal(lower, tree.end(), expect_lower, expect.end()));
+  }
+}
+
+void snapshot_test() {
+  // 每隔一段修改保存一个快照，之后的修改不影响已有快照
+  PersistentRBTree<int> tree;
+  std::set<int> expect;
+  std::vector<PersistentRBTree<int>::Snapshot> snapshots;
+  std::vector<std::set<int>> expects;
+  for (int i = 0; i < 30000; ++i) {
+    int temp = random_int() % 5000;
+    if (i % 2 == 0) {
+      tree.remove(temp);
+      expect.erase(temp);
+    } else {
+      tree.insert(temp);
+      expect.insert(temp);
+    }
+    if (i % 1000 == 0) {
+      snapshots.push_back(tree.snapshot());
+      expects.push_back(expect);
+    }
+  }
+  tree.check();
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    assert(snapshots[i].size() == expects[i].size());
+    assert(std::equal(snapshots[i].begin(), snapshots[i].end(),
+                      expects[i].begin(), expects[i].end()));
+  }
+
+  // 从旧快照分出新的可修改版本
+  PersistentRBTree<int> fork(snapshots[3]);
+  for (int i = 1; i <= 5000; ++i) fork.insert(-i);
+  fork.check();
+  assert(fork.size() == expects[3].size() + 5000);
+  assert(std::equal(snapshots[3].begin(), snapshots[3].end(),
+                    expects[3].begin(), expects[3].end()));
+  assert(!tree.contains(-1) && fork.contains(-1));
+}
+
+void release_test() {
+  {
+    PersistentRBTree<Counted> tree;
+    for (int i = 0; i < 2000; ++i) tree.insert(i);
+    // 没有快照时原地修改，不复制节点
+    assert(Counted::alive == 2000);
+    auto snapshot = tree.snapshot();
+    for (int i = 0; i < 2000; i += 2) tree.remove(i);
+    tree.check();
+    assert(Counted::alive > 2000);
+    snapshot = tree.snapshot();
+    // 旧版本独有的节点随旧快照一起释放
+    assert(Counted::alive == 1000);
+    PersistentRBTree<Counted> copy = tree;
+    copy.insert(-1);
+    assert(!tree.contains(-1) && snapshot.size() == 1000);
+  }
+  assert(Counted::alive == 0);
+}
+
+// 读者线程遍历并释放快照，写者同时继续修改
+void thread_test() {
+  PersistentRBTree<int> tree;
+  for (int i = 0; i < 10000; ++i) tree.insert(i * 2);
+  std::vector<std::thread> readers;
+  for (int round = 0; round < 8; ++round) {
+    readers.emplace_back([snapshot = tree.snapshot()] {
+      int prev = -1;
+      size_t count = 0;
+      for (int v : snapshot) {
+        assert(v > prev);
+        prev = v;
+        ++count;
+      }
+      assert(count == snapshot.size());
+    });
+    for (int i = 0; i < 2000; ++i) {
+      int temp = random_int() % 20000;
+      temp % 2 == 0 ? tree.remove(temp) : tree.insert(temp);
+    }
+  }
+  for (auto& reader : readers) reader.join();
+  tree.check();
+}
+
+int main() {
+  basic_test();
+  snapshot_test();
+  release_test();
+  thread_test();
+  return 0;
+}
@@ -1,226 +1,1704 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cassert>
+#include <exception>
 #include <functional>
-#include <queue>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
 
 #include "template/define.h"
+#include "template/rbtree/frozen_set.h"
+#include "template/rbtree/node_layout.h"
+#include "template/rbtree/tree_stats.h"
+#include "template/thread_pool.h"
+
+/*
+子树增强策略 Augment：
+  data                          每个节点额外保存的数据，空类型不占节点空间
+  static data compute(const T& value, const Node* lchild, const Node* rchild)
+                                由节点的值和孩子（可能为空）的 data 计算节点的 data，
+                                不修改任何节点
+树在结构变化（旋转、插入、删除、连接）时只沿受影响的路径重新计算并写回，
+verify() 只比较计算结果与保存的 data，不写节点。
+*/
+struct NoAugment {
+  struct data {};
+  template <class T, class Node>
+  static data compute(const T&, const Node*, const Node*) noexcept {
+    return {};
+  }
+};
+
+// 顺序统计：每个节点保存子树大小，支持 rank/select
+struct OrderStatistic {
+  struct data {
+    size_t size = 1;
+    bool operator==(const data&) const = default;
+  };
+  template <class Node>
+  static size_t size(const Node* node) noexcept {
+    return node == nullptr ? 0 : node->aug.size;
+  }
+  template <class T, class Node>
+  static data compute(const T&, const Node* lchild,
+                      const Node* rchild) noexcept {
+    return {1 + size(lchild) + size(rchild)};
+  }
+};
+
+template <class Augment, class Node>
+concept SizeAugment = requires(const Node* node) {
+  { Augment::size(node) } -> std::convertible_to<size_t>;
+};
 
-template <Comparable T>
-struct RBTreeNode {
-  RBTreeNode* parent = nullptr;
-  RBTreeNode* lchild = nullptr;
-  RBTreeNode* rchild = nullptr;
-  Color color = Color::RED;
-  T value;
+// 半开区间 [start, end)，按 (start, end) 的字典序比较
+template <class K>
+struct Interval {
+  K start;
+  K end;
+  auto operator<=>(const Interval&) const = default;
+};
+
+// 区间树：值带有 start、end 成员（如 Interval<K>），每个节点保存子树中最大的 end，
+// 支持 overlaps/stab。比较器需要先按 start 排序，K 之间用 < 比较
+template <class K>
+struct MaxEnd {
+  struct data {
+    K max_end{};
+    bool operator==(const data&) const = default;
+  };
+  template <class Node>
+  static const K& max_end(const Node* node) noexcept {
+    return node->aug.max_end;
+  }
+  template <class T, class Node>
+  static data compute(const T& value, const Node* lchild,
+                      const Node* rchild) noexcept {
+    const K* max = &value.end;
+    if (lchild != nullptr && *max < lchild->aug.max_end) {
+      max = &lchild->aug.max_end;
+    }
+    if (rchild != nullptr && *max < rchild->aug.max_end) {
+      max = &rchild->aug.max_end;
+    }
+    return {*max};
+  }
+};
+
+template <class Augment, class Node>
+concept MaxEndAugment = requires(const Node* node) { Augment::max_end(node); };
+
+/*
+幺半群聚合：每个节点保存子树中全部值按中序经 Monoid 合并的结果，支持 reduce。Monoid 提供：
+  value_type                                 聚合值类型
+  static value_type identity()               单位元
+  static value_type lift(const T& val)       单个值的聚合值
+  static value_type combine(const value_type& a, const value_type& b)
+                                             满足结合律（不要求交换律），不能抛出异常
+*/
+template <class Monoid>
+struct Aggregate {
+  using monoid = Monoid;
+  using value_type = typename Monoid::value_type;
+  struct data {
+    value_type agg = Monoid::identity();
+    bool operator==(const data&) const = default;
+  };
+  template <class Node>
+  static value_type aggregate(const Node* node) noexcept {
+    return node == nullptr ? Monoid::identity() : node->aug.agg;
+  }
+  template <class T, class Node>
+  static data compute(const T& value, const Node* lchild,
+                      const Node* rchild) noexcept {
+    return {Monoid::combine(
+        Monoid::combine(aggregate(lchild), Monoid::lift(value)),
+        aggregate(rchild))};
+  }
+};
 
-  template <class Args>
-  RBTreeNode(Args&& args) : value(std::forward<Args>(args)) {}
+template <class Augment, class Node>
+concept AggregateAugment = requires(const Node* node) {
+  Augment::aggregate(node);
 };
 
-template <Comparable T, class Comparator = std::less<T>>
+template <class T, class Comparator = std::less<T>,
+          class Allocator = std::allocator<T>, class Augment = NoAugment,
+          class Layout = PointerLayout, class Stats = NoStats>
+  requires KeyComparator<Comparator, T>
 class RBTree {
+  using Links = typename Layout::template links<T, Augment>;
+
  public:
-  using Node = RBTreeNode<T>;
+  using Node = typename Links::node;
+  using allocator_type = Allocator;
+  using layout_type = Links;
+  using value_type = T;
+  using size_type = size_t;
+
+  // 双向迭代器，end() 对应空节点，--end() 得到最大值。值不可修改。
+  class const_iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return value_of(node_); }
+    pointer operator->() const { return &value_of(node_); }
+    const_iterator& operator++() {
+      node_ = tree_->successor(node_);
+      return *this;
+    }
+    const_iterator& operator--() {
+      node_ = node_ == nullptr ? tree_->rightmost_ : tree_->predecessor(node_);
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+    const_iterator operator--(int) {
+      const_iterator old = *this;
+      --*this;
+      return old;
+    }
+    bool operator==(const const_iterator& other) const {
+      return node_ == other.node_;
+    }
+    auto node() const -> Node* { return node_; }
+
+   private:
+    friend class RBTree;
+    const_iterator(const RBTree* tree, Node* node) : tree_(tree), node_(node) {}
+
+    const RBTree* tree_ = nullptr;
+    Node* node_ = nullptr;
+  };
+  using iterator = const_iterator;
+
+  RBTree() = default;
+  explicit RBTree(const Allocator& alloc) : alloc_(alloc) {}
+  explicit RBTree(const Comparator& comp, const Allocator& alloc = Allocator())
+      : comp_(comp), alloc_(alloc) {}
+  // 与另一棵树共享分配器和布局对象，之后两棵树之间可以 join 或做集合运算
+  RBTree(const Allocator& alloc, const layout_type& layout)
+      : links_(layout), alloc_(alloc) {}
+  // 恢复布局对象保存的树（如 MappedLayout 打开的文件），只访问两侧边界上的节点。
+  // 析构时不释放节点，只把根写回布局对象
+  explicit RBTree(const layout_type& layout)
+    requires PersistentLinks<Links, Node>
+      : root(layout.root()), links_(layout), opened_(true) {
+    reset_bounds();
+  }
+  // [first, last) 需按比较器严格升序，O(n) 构建
+  template <std::forward_iterator It>
+  RBTree(sorted_unique_t, It first, It last,
+         const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    assign(sorted_unique, first, last);
+  }
+  // 按原样复制形状和颜色，不做查找和修复，O(n)。与 other 共享分配器和布局对象。
+  // 节点按先序申请，PoolAllocator 先预留整棵树的节点，IndexLayout 顺序分配，
+  // 副本都按先序连续存放。
+  // 分配器和布局对象无状态（如 std::allocator 与 PointerLayout）时节点可以在多个线程中
+  // 申请，黑高不低于 kParallelBlackHeight 的子树交给线程池并行复制
+  RBTree(const RBTree& other, ThreadPool& pool);
+  RBTree(const RBTree& other) : RBTree(other, ThreadPool::shared()) {}
+  RBTree& operator=(const RBTree& other) {
+    if (this != &other) *this = RBTree(other);
+    return *this;
+  }
+  auto clone(ThreadPool& pool = ThreadPool::shared()) const -> RBTree {
+    return RBTree(*this, pool);
+  }
+  // 移动只转移根和两侧边界，O(1)。other 变为空树，仍与 *this 共享分配器和布局对象。
+  // 节点指针保持有效，迭代器需要从新的树重新获取
+  RBTree(RBTree&& other) noexcept
+      : root(std::exchange(other.root, nullptr)),
+        leftmost_(std::exchange(other.leftmost_, nullptr)),
+        rightmost_(std::exchange(other.rightmost_, nullptr)),
+        links_(other.links_),
+        comp_(other.comp_),
+        alloc_(other.alloc_),
+        stats_(other.stats_),
+        opened_(std::exchange(other.opened_, {})) {}
+  // 先按析构的方式处理 *this 原有的节点
+  RBTree& operator=(RBTree&& other) noexcept {
+    if (this != &other) {
+      dispose();
+      RBTree(std::move(other)).swap(*this);
+    }
+    return *this;
+  }
+  void swap(RBTree& other) noexcept {
+    using std::swap;
+    swap(root, other.root);
+    swap(leftmost_, other.leftmost_);
+    swap(rightmost_, other.rightmost_);
+    swap(links_, other.links_);
+    swap(comp_, other.comp_);
+    swap(alloc_, other.alloc_);
+    swap(stats_, other.stats_);
+    swap(opened_, other.opened_);
+  }
+  friend void swap(RBTree& a, RBTree& b) noexcept { a.swap(b); }
+
+  auto find(const T& key) const -> Node* { return find<T>(key); }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  auto find(const K& key) const -> Node*;
+  bool contains(const T& key) const { return find(key) != nullptr; }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  bool contains(const K& key) const {
+    return find(key) != nullptr;
+  }
+  // 批量查找，out[i] 为 keys[i] 对应的节点或空，要求 out.size() >= keys.size()。
+  // 同时推进 kBatchInflight 个查找，每走一步就预取下一个节点，轮到它时节点已经
+  // 在缓存中：访存延迟相互重叠，树远大于缓存时吞吐量成倍提高
+  void find_batch(std::span<const T> keys, std::span<Node*> out) const;
+  void contains_batch(std::span<const T> keys, std::span<bool> out) const;
+  static constexpr size_t kBatchInflight = 16;
+  // 已存在相等的值时不插入，返回false；只有插入时才拷贝（移动）val
+  bool insert(const T& val) { return try_emplace(val, val).second; }
+  bool insert(T&& val) { return try_emplace(val, std::move(val)).second; }
+  // 先用 args 原地构造节点再查找位置，已存在相等的值时销毁该节点并返回false
+  template <class... Args>
+  bool emplace(Args&&... args);
+  // 只查找一次：不存在与 key 相等的值时，用 args 构造节点插入。
+  // 返回与 key 相等的节点以及是否发生了插入；未插入时 args 不会被使用
+  template <class K, class... Args>
+    requires LookupKey<Comparator, K, T>
+  auto try_emplace(const K& key, Args&&... args) -> std::pair<Node*, bool>;
 
-  auto find(T val) const -> Node*;
-  bool insert(T val);
-  bool remove(T val);
+  // 带提示的插入：值紧邻 hint 之前（hint 为 end() 时即大于最大值）时，
+  // 跳过从根开始的查找，只做 insert_fix，有序追加均摊 O(1)（有增强数据时需要
+  // O(log n) 更新路径）。不紧邻时退化为普通插入。返回新插入或已存在的相等元素
+  auto insert(const_iterator hint, const T& val) -> const_iterator {
+    return try_emplace_hint(hint, val, val);
+  }
+  auto insert(const_iterator hint, T&& val) -> const_iterator {
+    return try_emplace_hint(hint, val, std::move(val));
+  }
+  template <class... Args>
+  auto emplace_hint(const_iterator hint, Args&&... args) -> const_iterator;
+  bool remove(const T& key) { return remove<T>(key); }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  bool remove(const K& key);
+  // 通过重新链接节点完成删除，不拷贝或移动任何值，其它节点的指针保持有效
   void erase(Node* node);
+  // 同上，返回被删除值的下一个位置，pos 为 end() 时不做任何事
+  auto erase(const_iterator pos) -> const_iterator {
+    if (pos == end()) return end();
+    const_iterator next = std::next(pos);
+    erase(pos.node());
+    return next;
+  }
+  // 侵入式布局：把调用者提供的未链接节点插入树中，不申请内存。
+  // 已存在相等的值时不插入，返回相等的节点和 false
+  auto link_node(Node* node) -> std::pair<Node*, bool>
+    requires IntrusiveLinks<Links, Node>;
+
+  // 清空后由有序无重复区间重新构建，O(n)
+  template <std::forward_iterator It>
+  void assign(sorted_unique_t, It first, It last);
+
+  // 中序遍历每一步均摊 O(1)，完整遍历 O(n) 且不申请额外内存
+  auto begin() const -> const_iterator { return {this, leftmost_}; }
+  auto end() const -> const_iterator { return {this, nullptr}; }
+  // node 必须属于这棵树
+  auto iterator_to(Node* node) const -> const_iterator { return {this, node}; }
+  // 第一个 >= key 的位置
+  auto lower_bound(const T& key) const -> const_iterator {
+    return lower_bound<T>(key);
+  }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  auto lower_bound(const K& key) const -> const_iterator;
+  // 第一个 > key 的位置
+  auto upper_bound(const T& key) const -> const_iterator {
+    return upper_bound<T>(key);
+  }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  auto upper_bound(const K& key) const -> const_iterator;
+  auto equal_range(const T& key) const
+      -> std::pair<const_iterator, const_iterator> {
+    return equal_range<T>(key);
+  }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  auto equal_range(const K& key) const
+      -> std::pair<const_iterator, const_iterator>;
+  bool empty() const noexcept { return root == nullptr; }
+  // 释放全部节点，不申请额外内存
+  void clear() noexcept;
+
+  // 复制为只读的 FrozenSet，查找不再追指针，O(n)
+  auto freeze() const -> FrozenSet<T, Comparator> {
+    return {sorted_unique, begin(), end(), comp_};
+  }
+
+  // 要求 *this 的值都小于 pivot、right 的值都大于 pivot，O(log n)。
+  // right 的节点直接移入 *this，right 变为空树，两棵树的分配器和布局对象需要相等。
+  void join(const T& pivot, RBTree& right);
+  // 同上，不带中间值，right 的最小节点充当 pivot
+  void join(RBTree& right);
+  // *this 保留 < key 的部分，>= key 的节点移入 greater（原有内容被清空），O(log n)
+  void split(const T& key, RBTree& greater);
+
+  // 集合运算，结果保存在 *this 中。other 的节点直接并入或被释放，运算后 other 为空树，
+  // 两棵树的分配器和布局对象需要相等。基于 split/join 分治：以 other 的根切分 *this，
+  // 左右两个互不相交的子问题交给线程池并行，黑高低于 kParallelBlackHeight
+  // 的子问题顺序执行。总工作量 O(m log(n/m + 1))，m <= n 为两棵树的规模。
+  void union_with(RBTree&& other, ThreadPool& pool = ThreadPool::shared());
+  void intersect_with(RBTree&& other, ThreadPool& pool = ThreadPool::shared());
+  void difference_with(RBTree&& other,
+                       ThreadPool& pool = ThreadPool::shared());
+
+  // 黑高为 h 的子树至少有 2^h - 1 个节点
+  static constexpr int kParallelBlackHeight = 12;
+
+  // 以下接口需要 Augment 维护子树大小（如 OrderStatistic），均为 O(log n)
+  // 节点个数
+  size_t size() const noexcept
+    requires SizeAugment<Augment, Node>;
+  // 小于 key 的节点个数
+  size_t rank(const T& key) const
+    requires SizeAugment<Augment, Node>;
+  // 第 k 小（从0开始）的节点，k >= size() 时返回 nullptr
+  auto select(size_t k) const -> Node*
+    requires SizeAugment<Augment, Node>;
+  // 落在 [lo, hi) 内的节点个数
+  size_t count_range(const T& lo, const T& hi) const
+    requires SizeAugment<Augment, Node>;
+
+  // 以下接口需要 Augment 维护子树的幺半群聚合（如 Aggregate），
+  // 全部值按升序合并的结果，O(1)
+  auto reduce() const
+    requires AggregateAugment<Augment, Node>
+  {
+    return Augment::aggregate(root);
+  }
+  // 落在 [lo, hi) 内的值按升序合并的结果，lo >= hi 时为单位元，O(log n)
+  auto reduce(const T& lo, const T& hi) const
+    requires AggregateAugment<Augment, Node>
+  {
+    return reduce<T>(lo, hi);
+  }
+  template <class K>
+    requires LookupKey<Comparator, K, T>
+  auto reduce(const K& lo, const K& hi) const
+    requires AggregateAugment<Augment, Node>;
+
+  // 以下接口需要 Augment 维护子树中最大的区间终点（如 MaxEnd），按 start 升序对每个
+  // 符合的值调用 f(const T&)，期间不能修改树。O(log n + k log(n/k))，k 为结果个数
+  // 与 [lo, hi) 相交的区间：start < hi 且 lo < end，lo >= hi 时没有结果
+  template <class K, class F>
+  void overlaps(const K& lo, const K& hi, F&& f) const
+    requires MaxEndAugment<Augment, Node>;
+  // 包含 p 的区间：start <= p < end
+  template <class K, class F>
+  void stab(const K& p, F&& f) const
+    requires MaxEndAugment<Augment, Node>;
+
+  // 把根和节点写回存储，只能由恢复得到的树调用
+  void flush()
+    requires PersistentLinks<Links, Node>
+  {
+    assert(opened_);
+    links_.set_root(root);
+    links_.flush();
+  }
+
+  // for debug
+  void check() const;
+  // 检查与 check() 相同的性质，但不断言而是返回 false，也检查链接是否越界、
+  // 是否成环以及完整的有序性，用于校验从外部存储恢复的树
+  bool verify() const;
+
+  // 统计数据，见 tree_stats.h
+  auto stats() const -> const Stats& { return stats_; }
+  void reset_stats() { stats_ = Stats(); }
+
+  Allocator get_allocator() const { return Allocator(alloc_); }
+  auto get_layout() const -> const layout_type& { return links_; }
 
   ~RBTree();
 
  private:
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using NodeAllocTraits = std::allocator_traits<NodeAllocator>;
+
+  template <class... Args>
+  auto create_node(Args&&... args) -> Node*;
+  // 查找 key 的插入位置：存在相等的值时返回该节点，否则返回空并给出父节点和方向。
+  // 先与缓存的最小、最大节点比较，在两端插入时不需要从根下降
+  template <class K>
+  auto find_position(const K& key, Node*& parent, bool& is_left) const
+      -> Node*;
+  // 同上，先检查 key 是否紧邻 hint 之前
+  template <class K>
+  auto find_position(const_iterator hint, const K& key, Node*& parent,
+                     bool& is_left) const -> Node*;
+  template <class K, class... Args>
+  auto try_emplace_hint(const_iterator hint, const K& key, Args&&... args)
+      -> const_iterator;
+  // find_batch 的实现，找到（或确定不存在）keys[i] 时调用 emit(i, node)，
+  // 调用顺序与 keys 的顺序无关（AMAC：完成的查找立即由下一个 key 接替）
+  template <class Emit>
+  void lookup_batch(std::span<const T> keys, Emit&& emit) const;
+  // 把 node 挂到 parent 下并修复，parent 为空时作为根
+  void link(Node* node, Node* parent, bool is_left) noexcept;
+  // 整体修改 root 之后重新计算缓存的最小、最大节点
+  void reset_bounds() noexcept {
+    leftmost_ = root == nullptr ? nullptr : leftmost(root);
+    rightmost_ = root == nullptr ? nullptr : rightmost(root);
+  }
+  void destroy_node(Node* node) noexcept;
+
   inline bool compare(Node* a, Node* b) const noexcept {
-    return comp_(a->value, b->value);
+    return comp_(value_of(a), value_of(b));
+  }
+  // 查找路径上的比较，计入统计
+  template <class A, class B>
+  bool key_less(const A& a, const B& b) const {
+    if constexpr (kStats) stats_.compare();
+    return comp_(a, b);
+  }
+  // 统计钩子都包在 if constexpr 中，NoStats 时不实例化，不影响生成的代码
+  static constexpr bool kStats = Stats::kEnabled;
+
+  // 节点中的值，侵入式布局中为钩子所在的对象
+  static auto value_of(const Node* node) noexcept -> const T& {
+    if constexpr (IntrusiveLinks<Links, Node>) {
+      return Links::value(node);
+    } else {
+      return node->value;
+    }
+  }
+  // 节点的链接和颜色统一经由布局对象读写
+  auto parent_of(const Node* node) const noexcept -> Node* {
+    return links_.parent(node);
+  }
+  auto lchild_of(const Node* node) const noexcept -> Node* {
+    return links_.lchild(node);
+  }
+  auto rchild_of(const Node* node) const noexcept -> Node* {
+    return links_.rchild(node);
+  }
+  auto color_of(const Node* node) const noexcept -> Color {
+    return links_.color(node);
+  }
+  void set_parent(Node* node, Node* parent) const noexcept {
+    links_.set_parent(node, parent);
+  }
+  void set_lchild(Node* node, Node* child) const noexcept {
+    links_.set_lchild(node, child);
+  }
+  void set_rchild(Node* node, Node* child) const noexcept {
+    links_.set_rchild(node, child);
+  }
+  void set_color(Node* node, Color color) const noexcept {
+    links_.set_color(node, color);
   }
 
-  inline bool is_black(Node* node) {
-    return node == nullptr || node->color == Color::BLACK;
+  inline bool is_black(Node* node) const noexcept {
+    return node == nullptr || color_of(node) == Color::BLACK;
+  }
+
+  static constexpr bool kAugmented = !std::is_same_v<Augment, NoAugment>;
+  // 由 node 的值和孩子计算出的增强数据，不修改节点
+  auto expected_aug(const Node* node) const noexcept ->
+      typename Augment::data {
+    return Augment::compute(value_of(node), lchild_of(node), rchild_of(node));
+  }
+  void update(Node* node) const noexcept {
+    if constexpr (kAugmented) node->aug = expected_aug(node);
   }
+  // 从 node 开始向上，重新计算到根为止每个节点的增强数据
+  void update_path(Node* node) const noexcept;
+  // 中序访问子树中 lo < end 且 before(start) 的值：max_end <= lo 的子树整个跳过，
+  // 遇到 start 不满足 before 的节点后不再进入它和右子树
+  template <class K, class Before, class F>
+  void visit_overlaps(Node* node, const K& lo, const Before& before,
+                      F& f) const;
 
   void left_rotate(Node* node) noexcept;
   void right_rotate(Node* node) noexcept;
   void transplant(Node* node, Node* replace) noexcept;
-  auto successor(Node* node) noexcept -> Node*;
+  // 交换 node 与其后继 s 在树中的位置（链接、颜色和增强数据），值保持不动
+  void swap_with_successor(Node* node, Node* s) noexcept;
+  auto successor(Node* node) const noexcept -> Node*;
+  auto predecessor(Node* node) const noexcept -> Node*;
+  auto leftmost(Node* node) const noexcept -> Node*;
+  auto rightmost(Node* node) const noexcept -> Node*;
 
-  void insert_fix(Node* node) noexcept;
+  // 返回true表示修复过程把红色的根染黑，即整棵树的黑高加一
+  bool insert_fix(Node* node) noexcept;
   void remove_fix(Node* node) noexcept;
+  // 把node从树中摘下但不释放，返回node
+  auto unlink(Node* node) noexcept -> Node*;
+
+  // split/join 的中间结果：一棵独立子树（根为黑色）和它的黑高（不计空节点）
+  struct Subtree {
+    Node* root;
+    int bh;
+  };
+
+  int black_height(Node* node) const noexcept;
+  auto detach(Node* child, int bh) const noexcept -> Subtree;
+  /*
+  把 l、k、r 连接成一棵树，要求 l < k < r，以 root 作为工作区。
+  不妨设 l 更高：沿 l 的右脊下降，找到黑高等于 r 的黑色节点 c，
+  用红色的 k 替换 c，并令 k->lchild = c、k->rchild = r，
+  此时只可能出现 k 与其父亲双红，交给 insert_fix 处理。耗时 O(|l.bh - r.bh| + 1)。
+  */
+  auto join_subtree(Subtree l, Node* k, Subtree r) noexcept -> Subtree;
+  // 无 pivot 的连接，取 r 的最小节点充当 pivot
+  auto join2(Subtree l, Subtree r) noexcept -> Subtree;
+  // 自顶向下拆开 t，左右两侧的碎片分别自底向上 join，总耗时 O(log n)。
+  // found 不为空时，等于 key 的节点不进入 r，而是摘下后通过 found 返回
+  void split_subtree(Subtree t, const T& key, Subtree& l, Subtree& r,
+                     Node** found = nullptr) noexcept;
+
+  enum class SetOp { UNION, INTERSECTION, DIFFERENCE };
+  // 集合运算中被丢弃的子树，通过 parent 指针串成链表，由调用线程统一释放
+  struct Garbage {
+    const Links& links;
+    Node* head = nullptr;
+    Node* tail = nullptr;
+
+    void push(Node* subtree) noexcept {
+      if (subtree == nullptr) return;
+      links.set_parent(subtree, nullptr);
+      if (tail == nullptr) {
+        head = subtree;
+      } else {
+        links.set_parent(tail, subtree);
+      }
+      tail = subtree;
+    }
+    // 单个节点的孩子已经移交给别处，需要先断开
+    void drop(Node* node) noexcept {
+      if (node == nullptr) return;
+      links.set_lchild(node, nullptr);
+      links.set_rchild(node, nullptr);
+      push(node);
+    }
+    void append(Garbage& other) noexcept {
+      if (other.head == nullptr) return;
+      if (tail == nullptr) {
+        head = other.head;
+      } else {
+        links.set_parent(tail, other.head);
+      }
+      tail = other.tail;
+    }
+  };
+  // 并行任务各自使用一棵临时树作为旋转的工作区
+  struct ScratchTag {};
+  RBTree(ScratchTag, const RBTree& owner)
+      : links_(owner.links_), comp_(owner.comp_), alloc_(owner.alloc_) {}
+  void set_operation(SetOp op, RBTree&& other, ThreadPool& pool);
+  auto set_operation(SetOp op, Subtree a, Subtree b, int depth, int max_depth,
+                     ThreadPool& pool, Garbage& garbage) -> Subtree;
+
+  /*
+  按中点递归切分，左右子树大小至多差1，所以所有空链接的深度只可能是
+  floor(log2(n)) 或 floor(log2(n)) + 1。把最深一层 (深度为 floor(log2(n))) 的节点
+  染红、其余染黑，即满足黑路同性质，且红节点都是叶子、父亲都是黑色。
+  */
+  template <class It>
+  auto build_sorted(It& it, size_t n, int depth, int red_depth) -> Node*;
+
+  // 返回子树的黑高，违反性质时返回 -1。值须落在 (lo, hi) 内，空指针表示无界
+  int verify_subtree(Node* node, const T* lo, const T* hi, int depth) const;
+  // 链接是否指向布局对象中已分配的节点
+  bool owns(const Node* node) const noexcept {
+    if constexpr (PersistentLinks<Links, Node>) {
+      return links_.owns(node);
+    } else {
+      return true;
+    }
+  }
+  // 复制 src 的子树挂到它的副本 dst 下，bh 为 src 的黑高
+  void copy_children(const Node* src, Node* dst, int bh, int depth,
+                     int max_depth, ThreadPool& pool);
+  auto copy_node(const Node* src) -> Node*;
+  // 统计不是线程安全的
+  static constexpr bool kParallelCopy =
+      std::is_empty_v<NodeAllocator> && std::is_empty_v<Links> && !kStats;
+  // 析构时的处理：恢复得到的树把根写回布局对象，否则释放全部节点
+  void dispose() noexcept;
+  // 逐个释放子树的节点，O(1) 额外空间
+  void destroy_subtree(Node* node) noexcept;
 
   Node* root = nullptr;
+  Node* leftmost_ = nullptr;
+  Node* rightmost_ = nullptr;
+  [[no_unique_address]] Links links_;
   Comparator comp_;
+  [[no_unique_address]] NodeAllocator alloc_;
+  [[no_unique_address]] mutable Stats stats_;
+  // 是否由布局对象恢复
+  struct NotPersistent {};
+  [[no_unique_address]] std::conditional_t<PersistentLinks<Links, Node>, bool,
+                                           NotPersistent> opened_{};
 };
 
-template <Comparable T, class U>
-auto RBTree<T, U>::find(T val) const -> Node* {
+// [start, end) 区间的集合，按 (start, end) 排序，相同的区间只保存一个
+template <class K, class Allocator = std::allocator<Interval<K>>,
+          class Layout = PointerLayout>
+using IntervalTree = RBTree<Interval<K>, std::less<Interval<K>>, Allocator,
+                            MaxEnd<K>, Layout>;
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+auto RBTree<T, U, A, Aug, L, S>::find(const K& key) const -> Node* {
   Node* cur = root;
+  [[maybe_unused]] int depth = 0;
   while (cur != nullptr) {
-    if (comp_(val, cur->value)) {
-      cur = cur->lchild;
-    } else if (comp_(cur->value, val)) {
-      cur = cur->rchild;
+    if constexpr (kStats) ++depth;
+    if (key_less(key, value_of(cur))) {
+      cur = lchild_of(cur);
+    } else if (key_less(value_of(cur), key)) {
+      cur = rchild_of(cur);
     } else {
+      if constexpr (kStats) stats_.find(depth);
       return cur;
     }
   }
+  if constexpr (kStats) stats_.find(depth);
   return nullptr;
 }
 
-template <Comparable T, class U>
-bool RBTree<T, U>::insert(T val) {
-  Node** pparent = &root;
-  Node* parent = nullptr;
-  while (*pparent != nullptr) {
-    parent = *pparent;
-    if (comp_(val, parent->value)) {
-      pparent = &parent->lchild;
-    } else if (comp_(parent->value, val)) {
-      pparent = &parent->rchild;
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::find_batch(std::span<const T> keys,
+                                            std::span<Node*> out) const {
+  assert(out.size() >= keys.size());
+  lookup_batch(keys, [&](size_t i, Node* node) { out[i] = node; });
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::contains_batch(std::span<const T> keys,
+                                                std::span<bool> out) const {
+  assert(out.size() >= keys.size());
+  lookup_batch(keys, [&](size_t i, Node* node) { out[i] = node != nullptr; });
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class Emit>
+void RBTree<T, U, A, Aug, L, S>::lookup_batch(std::span<const T> keys,
+                                              Emit&& emit) const {
+  if (root == nullptr) {
+    for (size_t i = 0; i < keys.size(); ++i) emit(i, nullptr);
+    return;
+  }
+  // [0, active) 为进行中的查找，cur 为下一步要比较的节点（已预取）
+  struct Probe {
+    Node* cur;
+    size_t index;
+  };
+  Probe probes[kBatchInflight];
+  // 每个查找经过的节点数，只在统计时记录
+  struct NoDepth {};
+  [[maybe_unused]] std::conditional_t<kStats, int[kBatchInflight], NoDepth>
+      depth{};
+  size_t next = 0, active = 0;
+  for (; active < kBatchInflight && next < keys.size(); ++active, ++next) {
+    probes[active] = {root, next};
+  }
+  while (active > 0) {
+    for (size_t s = 0; s < active;) {
+      Probe& p = probes[s];
+      const T& key = keys[p.index];
+      Node* child;
+      if constexpr (kStats) ++depth[s];
+      if (key_less(key, value_of(p.cur))) {
+        child = lchild_of(p.cur);
+      } else if (key_less(value_of(p.cur), key)) {
+        child = rchild_of(p.cur);
+      } else {
+        child = p.cur;
+      }
+      if (child == p.cur || child == nullptr) {
+        if constexpr (kStats) stats_.find(std::exchange(depth[s], 0));
+        emit(p.index, child);
+        // 由下一个 key 接替这个位置，没有剩余的 key 时用最后一个查找填补
+        if (next < keys.size()) {
+          p = {root, next++};
+        } else {
+          p = probes[--active];
+          if constexpr (kStats) depth[s] = depth[active];
+          continue;
+        }
+      } else {
+        __builtin_prefetch(child);
+        p.cur = child;
+      }
+      ++s;
+    }
+  }
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K, class... Args>
+  requires LookupKey<U, K, T>
+auto RBTree<T, U, A, Aug, L, S>::try_emplace(const K& key, Args&&... args)
+    -> std::pair<Node*, bool> {
+  Node* parent;
+  bool is_left;
+  if (Node* found = find_position(key, parent, is_left)) return {found, false};
+  Node* node = create_node(std::forward<Args>(args)...);
+  link(node, parent, is_left);
+  return {node, true};
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K, class... Args>
+auto RBTree<T, U, A, Aug, L, S>::try_emplace_hint(const_iterator hint,
+                                                  const K& key, Args&&... args)
+    -> const_iterator {
+  Node* parent;
+  bool is_left;
+  if (Node* found = find_position(hint, key, parent, is_left)) {
+    return {this, found};
+  }
+  Node* node = create_node(std::forward<Args>(args)...);
+  link(node, parent, is_left);
+  return {this, node};
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class... Args>
+auto RBTree<T, U, A, Aug, L, S>::emplace_hint(const_iterator hint, Args&&... args)
+    -> const_iterator {
+  Node* node = create_node(std::forward<Args>(args)...);
+  Node* parent;
+  bool is_left;
+  if (Node* found = find_position(hint, value_of(node), parent, is_left)) {
+    destroy_node(node);
+    return {this, found};
+  }
+  link(node, parent, is_left);
+  return {this, node};
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::link_node(Node* node) -> std::pair<Node*, bool>
+  requires IntrusiveLinks<Links, Node>
+{
+  Node* parent;
+  bool is_left;
+  if (Node* found = find_position(value_of(node), parent, is_left)) {
+    return {found, false};
+  }
+  link(node, parent, is_left);
+  return {node, true};
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K>
+auto RBTree<T, U, A, Aug, L, S>::find_position(const K& key, Node*& parent,
+                                               bool& is_left) const -> Node* {
+  parent = nullptr;
+  is_left = false;
+  if (root == nullptr) return nullptr;
+  if (key_less(value_of(rightmost_), key)) {
+    parent = rightmost_;
+    return nullptr;
+  }
+  if (key_less(key, value_of(leftmost_))) {
+    parent = leftmost_;
+    is_left = true;
+    return nullptr;
+  }
+  for (Node* cur = root; cur != nullptr;) {
+    parent = cur;
+    if (key_less(key, value_of(cur))) {
+      cur = lchild_of(cur);
+      is_left = true;
+    } else if (key_less(value_of(cur), key)) {
+      cur = rchild_of(cur);
+      is_left = false;
     } else {
-      return false;
+      return cur;
     }
   }
-  Node* node = new Node(val);
-  *pparent = node;
-  node->parent = parent;
-  insert_fix(node);
+  return nullptr;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K>
+auto RBTree<T, U, A, Aug, L, S>::find_position(const_iterator hint, const K& key,
+                                               Node*& parent, bool& is_left) const
+    -> Node* {
+  Node* next = hint.node_;
+  Node* prev = next == nullptr    ? rightmost_
+               : next == leftmost_ ? nullptr
+                                   : predecessor(next);
+  if ((next == nullptr || key_less(key, value_of(next))) &&
+      (prev == nullptr || key_less(value_of(prev), key))) {
+    // key 位于 prev 和 next 之间：next 没有左孩子时挂在 next 左侧，
+    // 否则 prev 是 next 左子树的最大值，一定没有右孩子
+    if (next != nullptr && lchild_of(next) == nullptr) {
+      parent = next;
+      is_left = true;
+    } else {
+      parent = prev;
+      is_left = false;
+    }
+    return nullptr;
+  }
+  return find_position(key, parent, is_left);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class... Args>
+bool RBTree<T, U, A, Aug, L, S>::emplace(Args&&... args) {
+  Node* node = create_node(std::forward<Args>(args)...);
+  Node* parent;
+  bool is_left;
+  if (find_position(value_of(node), parent, is_left) != nullptr) {
+    destroy_node(node);
+    return false;
+  }
+  link(node, parent, is_left);
   return true;
 }
 
-template <Comparable T, class U>
-bool RBTree<T, U>::remove(T val) {
-  Node* node = find(val);
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::link(Node* node, Node* parent,
+                                      bool is_left) noexcept {
+  if (parent == nullptr) {
+    root = leftmost_ = rightmost_ = node;
+  } else if (is_left) {
+    set_lchild(parent, node);
+    if (parent == leftmost_) leftmost_ = node;
+  } else {
+    set_rchild(parent, node);
+    if (parent == rightmost_) rightmost_ = node;
+  }
+  set_parent(node, parent);
+  update_path(node);
+  if constexpr (kStats) stats_.insert();
+  insert_fix(node);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <std::forward_iterator It>
+void RBTree<T, U, A, Aug, L, S>::assign(sorted_unique_t, It first, It last) {
+  assert(std::adjacent_find(first, last, [this](const T& a, const T& b) {
+           return !comp_(a, b);
+         }) == last);
+  clear();
+  size_t n = std::distance(first, last);
+  if (n == 0) return;
+  // 分配器支持预留时（如PoolAllocator），所有节点来自同一次内存申请
+  if constexpr (requires(NodeAllocator& alloc) { alloc.reserve(n); }) {
+    alloc_.reserve(n);
+  }
+  root = build_sorted(first, n, 0, std::bit_width(n) - 1);
+  reset_bounds();
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class It>
+auto RBTree<T, U, A, Aug, L, S>::build_sorted(It& it, size_t n, int depth, int red_depth)
+    -> Node* {
+  if (n == 0) return nullptr;
+  size_t lsize = (n - 1) / 2;
+  Node* lchild = build_sorted(it, lsize, depth + 1, red_depth);
+  Node* node = create_node(*it);
+  ++it;
+  set_color(node,
+            depth == red_depth && depth > 0 ? Color::RED : Color::BLACK);
+  set_lchild(node, lchild);
+  if (lchild != nullptr) set_parent(lchild, node);
+  set_rchild(node, build_sorted(it, n - 1 - lsize, depth + 1, red_depth));
+  if (rchild_of(node) != nullptr) set_parent(rchild_of(node), node);
+  update(node);
+  return node;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::check() const {
+  assert(verify());
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+bool RBTree<T, U, A, Aug, L, S>::verify() const {
+  if (root == nullptr) return leftmost_ == nullptr && rightmost_ == nullptr;
+  if (!owns(root) || color_of(root) != Color::BLACK ||
+      parent_of(root) != nullptr) {
+    return false;
+  }
+  return verify_subtree(root, nullptr, nullptr, 0) >= 0 &&
+         leftmost_ == leftmost(root) && rightmost_ == rightmost(root);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+int RBTree<T, U, A, Aug, L, S>::verify_subtree(Node* node, const T* lo,
+                                               const T* hi, int depth) const {
+  if (node == nullptr) return 1;
+  // 2^31 个节点的红黑树高度不超过 64，更深说明链接成环
+  if (depth > 128) return -1;
+  if ((lo != nullptr && !comp_(*lo, value_of(node))) ||
+      (hi != nullptr && !comp_(value_of(node), *hi))) {
+    return -1;
+  }
+  for (Node* child : {lchild_of(node), rchild_of(node)}) {
+    if (child == nullptr) continue;
+    if (!owns(child) || parent_of(child) != node) return -1;
+    if (color_of(node) == Color::RED && color_of(child) == Color::RED) {
+      return -1;
+    }
+  }
+  int lcnt = verify_subtree(lchild_of(node), lo, &value_of(node), depth + 1);
+  if (lcnt < 0) return -1;
+  int rcnt = verify_subtree(rchild_of(node), &value_of(node), hi, depth + 1);
+  if (rcnt != lcnt) return -1;
+  // 孩子已经校验过，重新计算一遍增强数据应当与保存的一致
+  if constexpr (std::equality_comparable<typename Aug::data>) {
+    if (!(node->aug == expected_aug(node))) return -1;
+  }
+  return color_of(node) == Color::BLACK ? lcnt + 1 : lcnt;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::update_path(Node* node) const noexcept {
+  if constexpr (kAugmented) {
+    for (; node != nullptr; node = parent_of(node)) update(node);
+  }
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+size_t RBTree<T, U, A, Aug, L, S>::size() const noexcept
+  requires SizeAugment<Aug, Node>
+{
+  return Aug::size(root);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+size_t RBTree<T, U, A, Aug, L, S>::rank(const T& key) const
+  requires SizeAugment<Aug, Node>
+{
+  size_t rank = 0;
+  for (Node* cur = root; cur != nullptr;) {
+    if (comp_(value_of(cur), key)) {
+      rank += Aug::size(lchild_of(cur)) + 1;
+      cur = rchild_of(cur);
+    } else {
+      cur = lchild_of(cur);
+    }
+  }
+  return rank;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::select(size_t k) const -> Node*
+  requires SizeAugment<Aug, Node>
+{
+  for (Node* cur = root; cur != nullptr;) {
+    size_t lsize = Aug::size(lchild_of(cur));
+    if (k < lsize) {
+      cur = lchild_of(cur);
+    } else if (k == lsize) {
+      return cur;
+    } else {
+      k -= lsize + 1;
+      cur = rchild_of(cur);
+    }
+  }
+  return nullptr;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+size_t RBTree<T, U, A, Aug, L, S>::count_range(const T& lo, const T& hi) const
+  requires SizeAugment<Aug, Node>
+{
+  return comp_(lo, hi) ? rank(hi) - rank(lo) : 0;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+auto RBTree<T, U, A, Aug, L, S>::reduce(const K& lo, const K& hi) const
+  requires AggregateAugment<Aug, Node>
+{
+  using Monoid = typename Aug::monoid;
+  typename Aug::value_type left = Monoid::identity();
+  // 从根向下找到第一个落在 [lo, hi) 内的节点，两侧边界的路径从这里分开。
+  // lo >= hi 时找不到
+  Node* split = root;
+  while (split != nullptr) {
+    if (comp_(value_of(split), lo)) {
+      split = rchild_of(split);
+    } else if (!comp_(value_of(split), hi)) {
+      split = lchild_of(split);
+    } else {
+      break;
+    }
+  }
+  if (split == nullptr) return left;
+  // 左侧路径上 >= lo 的节点连同右子树都在范围内，从右向左合并
+  for (Node* cur = lchild_of(split); cur != nullptr;) {
+    if (comp_(value_of(cur), lo)) {
+      cur = rchild_of(cur);
+    } else {
+      left = Monoid::combine(Monoid::combine(Monoid::lift(value_of(cur)),
+                                             Aug::aggregate(rchild_of(cur))),
+                             left);
+      cur = lchild_of(cur);
+    }
+  }
+  // 右侧路径上 < hi 的节点连同左子树都在范围内，从左向右合并
+  typename Aug::value_type right = Monoid::identity();
+  for (Node* cur = rchild_of(split); cur != nullptr;) {
+    if (!comp_(value_of(cur), hi)) {
+      cur = lchild_of(cur);
+    } else {
+      right = Monoid::combine(right,
+                              Monoid::combine(Aug::aggregate(lchild_of(cur)),
+                                              Monoid::lift(value_of(cur))));
+      cur = rchild_of(cur);
+    }
+  }
+  return Monoid::combine(Monoid::combine(left, Monoid::lift(value_of(split))),
+                         right);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K, class F>
+void RBTree<T, U, A, Aug, L, S>::overlaps(const K& lo, const K& hi,
+                                          F&& f) const
+  requires MaxEndAugment<Aug, Node>
+{
+  if (!(lo < hi)) return;
+  visit_overlaps(root, lo, [&](const auto& start) { return start < hi; }, f);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K, class F>
+void RBTree<T, U, A, Aug, L, S>::stab(const K& p, F&& f) const
+  requires MaxEndAugment<Aug, Node>
+{
+  visit_overlaps(root, p, [&](const auto& start) { return !(p < start); }, f);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K, class Before, class F>
+void RBTree<T, U, A, Aug, L, S>::visit_overlaps(Node* node, const K& lo,
+                                                const Before& before,
+                                                F& f) const {
+  // 右子树用循环代替递归
+  while (node != nullptr && lo < Aug::max_end(node)) {
+    visit_overlaps(lchild_of(node), lo, before, f);
+    const T& val = value_of(node);
+    if (!before(val.start)) return;
+    if (lo < val.end) f(val);
+    node = rchild_of(node);
+  }
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class... Args>
+auto RBTree<T, U, A, Aug, L, S>::create_node(Args&&... args) -> Node* {
+  Node* node = links_.allocate(alloc_);
+  if constexpr (kStats) stats_.allocate(sizeof(Node));
+  try {
+    NodeAllocTraits::construct(alloc_, node, std::forward<Args>(args)...);
+  } catch (...) {
+    links_.deallocate(alloc_, node);
+    throw;
+  }
+  return node;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::destroy_node(Node* node) noexcept {
+  // 侵入式布局的节点属于调用者，只恢复为未链接状态
+  if constexpr (IntrusiveLinks<Links, Node>) {
+    links_.unlink(node);
+  } else {
+    NodeAllocTraits::destroy(alloc_, node);
+    links_.deallocate(alloc_, node);
+    if constexpr (kStats) stats_.deallocate(sizeof(Node));
+  }
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+bool RBTree<T, U, A, Aug, L, S>::remove(const K& key) {
+  Node* node = find(key);
   if (node == nullptr) return false;
   erase(node);
   return true;
 }
 
-template <Comparable T, class U>
-void RBTree<T, U>::erase(Node* node) {
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::erase(Node* node) {
   if (node == nullptr) return;
-  if (node->lchild != nullptr && node->rchild != nullptr) {
-    Node* s = successor(node);
-    node->value = s->value;
-    node = s;
+  if (node == leftmost_) leftmost_ = successor(node);
+  if (node == rightmost_) rightmost_ = predecessor(node);
+  if constexpr (kStats) stats_.remove();
+  destroy_node(unlink(node));
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::unlink(Node* node) noexcept -> Node* {
+  if (lchild_of(node) != nullptr && rchild_of(node) != nullptr) {
+    swap_with_successor(node, successor(node));
   }
-  Node* replace = node->lchild != nullptr ? node->lchild : node->rchild;
+  Node* replace = lchild_of(node) != nullptr ? lchild_of(node) : rchild_of(node);
+  // 增强数据需要在 remove_fix 旋转之前就反映删除后的结构：
+  // 有孩子时先摘下再更新路径；叶子节点在修复期间仍挂在树上，摘下后再更新路径
   if (replace != nullptr) {
     transplant(node, replace);
-    if (node->color == Color::BLACK) {
+    update_path(parent_of(replace));
+    if (color_of(node) == Color::BLACK) {
       remove_fix(replace);
     }
-  } else if (node->parent == nullptr) {
+  } else if (parent_of(node) == nullptr) {
     root = nullptr;
   } else {
-    if (node->color == Color::BLACK) {
+    if (color_of(node) == Color::BLACK) {
       remove_fix(node);
     }
-    if (node->parent != nullptr) {
-      if (node == node->parent->lchild) {
-        node->parent->lchild = nullptr;
+    if (parent_of(node) != nullptr) {
+      if (node == lchild_of(parent_of(node))) {
+        set_lchild(parent_of(node), nullptr);
       } else {
-        node->parent->rchild = nullptr;
+        set_rchild(parent_of(node), nullptr);
       }
+      update_path(parent_of(node));
+    }
+  }
+  return node;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::join(const T& pivot, RBTree& right) {
+  assert(alloc_ == right.alloc_ && links_ == right.links_);
+  // 先创建 pivot 节点，复制或申请失败时两棵树都不变
+  Node* k = create_node(pivot);
+  Subtree l{root, black_height(root)}, r{right.root, black_height(right.root)};
+  root = right.root = nullptr;
+  root = join_subtree(l, k, r).root;
+  reset_bounds();
+  right.reset_bounds();
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::join(RBTree& right) {
+  assert(alloc_ == right.alloc_ && links_ == right.links_);
+  if (right.root == nullptr) return;
+  Node* k = leftmost(right.root);
+  right.unlink(k);
+  Subtree l{root, black_height(root)}, r{right.root, black_height(right.root)};
+  root = right.root = nullptr;
+  root = join_subtree(l, k, r).root;
+  reset_bounds();
+  right.reset_bounds();
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::split(const T& key, RBTree& greater) {
+  greater.clear();
+  greater.alloc_ = alloc_;
+  greater.links_ = links_;
+  Subtree t{root, black_height(root)}, l, r;
+  root = nullptr;
+  split_subtree(t, key, l, r);
+  root = l.root;
+  greater.root = r.root;
+  reset_bounds();
+  greater.reset_bounds();
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+int RBTree<T, U, A, Aug, L, S>::black_height(Node* node) const noexcept {
+  int bh = 0;
+  for (; node != nullptr; node = lchild_of(node)) {
+    if (color_of(node) == Color::BLACK) ++bh;
+  }
+  return bh;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::detach(Node* child, int bh) const noexcept
+    -> Subtree {
+  if (child == nullptr) return {nullptr, 0};
+  set_parent(child, nullptr);
+  if (color_of(child) == Color::RED) {
+    set_color(child, Color::BLACK);
+    ++bh;
+  }
+  return {child, bh};
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::join_subtree(Subtree l, Node* k, Subtree r) noexcept
+    -> Subtree {
+  Node* parent = nullptr;
+  set_color(k, Color::RED);
+  if (l.bh >= r.bh) {
+    root = l.root;
+    Node* cur = l.root;
+    for (int h = l.bh; cur != nullptr && (h > r.bh || color_of(cur) == Color::RED);
+         cur = rchild_of(cur)) {
+      if (color_of(cur) == Color::BLACK) --h;
+      parent = cur;
+    }
+    set_lchild(k, cur);
+    set_rchild(k, r.root);
+    if (parent == nullptr) {
+      root = k;
+    } else {
+      set_rchild(parent, k);
+    }
+  } else {
+    root = r.root;
+    Node* cur = r.root;
+    for (int h = r.bh; cur != nullptr && (h > l.bh || color_of(cur) == Color::RED);
+         cur = lchild_of(cur)) {
+      if (color_of(cur) == Color::BLACK) --h;
+      parent = cur;
     }
+    set_lchild(k, l.root);
+    set_rchild(k, cur);
+    set_lchild(parent, k);
   }
-  delete node;
+  set_parent(k, parent);
+  if (lchild_of(k) != nullptr) set_parent(lchild_of(k), k);
+  if (rchild_of(k) != nullptr) set_parent(rchild_of(k), k);
+  // k 的祖先恰好是下降经过的右脊（左脊），长度为 O(|l.bh - r.bh| + 1)
+  update_path(k);
+  int bh = std::max(l.bh, r.bh);
+  if (insert_fix(k)) ++bh;
+  Subtree joined{root, bh};
+  root = nullptr;
+  return joined;
 }
 
-template <Comparable T, class U>
-void RBTree<T, U>::left_rotate(Node* node) noexcept {
-  Node* rchild = node->rchild;
-  node->rchild = rchild->lchild;
-  if (rchild->lchild != nullptr) {
-    rchild->lchild->parent = node;
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::split_subtree(Subtree t, const T& key, Subtree& l,
+                                    Subtree& r, Node** found) noexcept {
+  Node* node = t.root;
+  if (node == nullptr) {
+    l = r = {nullptr, 0};
+    return;
+  }
+  Subtree lchild = detach(lchild_of(node), t.bh - 1);
+  Subtree rchild = detach(rchild_of(node), t.bh - 1);
+  if (comp_(value_of(node), key)) {
+    Subtree rl;
+    split_subtree(rchild, key, rl, r, found);
+    l = join_subtree(lchild, node, rl);
+  } else if (found != nullptr && !comp_(key, value_of(node))) {
+    *found = node;
+    l = lchild;
+    r = rchild;
+  } else {
+    Subtree lr;
+    split_subtree(lchild, key, l, lr, found);
+    r = join_subtree(lr, node, rchild);
   }
-  Node* parent = node->parent;
-  rchild->parent = parent;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::join2(Subtree l, Subtree r) noexcept -> Subtree {
+  if (l.root == nullptr) return r;
+  if (r.root == nullptr) return l;
+  root = r.root;
+  Node* k = leftmost(r.root);
+  unlink(k);
+  r = {root, black_height(root)};
+  root = nullptr;
+  return join_subtree(l, k, r);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::union_with(RBTree&& other, ThreadPool& pool) {
+  set_operation(SetOp::UNION, std::move(other), pool);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::intersect_with(RBTree&& other, ThreadPool& pool) {
+  set_operation(SetOp::INTERSECTION, std::move(other), pool);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::difference_with(RBTree&& other, ThreadPool& pool) {
+  set_operation(SetOp::DIFFERENCE, std::move(other), pool);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::set_operation(SetOp op, RBTree&& other,
+                                    ThreadPool& pool) {
+  assert(alloc_ == other.alloc_ && links_ == other.links_);
+  Subtree a{root, black_height(root)};
+  Subtree b{other.root, black_height(other.root)};
+  root = other.root = nullptr;
+  // 每层并行把任务数翻倍，任务数达到线程数的4倍左右后不再拆分
+  int max_depth = pool.size() == 0 ? 0 : std::bit_width(pool.size() + 1) + 2;
+  Garbage garbage{links_};
+  root = set_operation(op, a, b, 0, max_depth, pool, garbage).root;
+  reset_bounds();
+  other.reset_bounds();
+  for (Node* node = garbage.head; node != nullptr;) {
+    Node* next = parent_of(node);
+    destroy_subtree(node);
+    node = next;
+  }
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::set_operation(SetOp op, Subtree a, Subtree b, int depth,
+                                    int max_depth, ThreadPool& pool,
+                                    Garbage& garbage) -> Subtree {
+  if (a.root == nullptr || b.root == nullptr) {
+    switch (op) {
+      case SetOp::UNION:
+        return a.root != nullptr ? a : b;
+      case SetOp::INTERSECTION:
+        garbage.push(a.root);
+        garbage.push(b.root);
+        return {nullptr, 0};
+      case SetOp::DIFFERENCE:
+        garbage.push(b.root);
+        return a;
+    }
+  }
+  Node* k = b.root;
+  Subtree bl = detach(lchild_of(k), b.bh - 1), br = detach(rchild_of(k), b.bh - 1);
+  Subtree al, ar, l, r;
+  Node* found = nullptr;
+  split_subtree(a, value_of(k), al, ar, &found);
+  if (depth < max_depth &&
+      std::max(a.bh, b.bh) >= kParallelBlackHeight) {
+    Garbage rgarbage{links_};
+    pool.invoke(
+        [&] {
+          RBTree scratch(ScratchTag{}, *this);
+          l = scratch.set_operation(op, al, bl, depth + 1, max_depth, pool,
+                                    garbage);
+        },
+        [&] {
+          RBTree scratch(ScratchTag{}, *this);
+          r = scratch.set_operation(op, ar, br, depth + 1, max_depth, pool,
+                                    rgarbage);
+        });
+    garbage.append(rgarbage);
+  } else {
+    l = set_operation(op, al, bl, depth + 1, max_depth, pool, garbage);
+    r = set_operation(op, ar, br, depth + 1, max_depth, pool, garbage);
+  }
+  switch (op) {
+    case SetOp::UNION:
+      garbage.drop(found);
+      return join_subtree(l, k, r);
+    case SetOp::INTERSECTION:
+      garbage.drop(k);
+      return found != nullptr ? join_subtree(l, found, r) : join2(l, r);
+    case SetOp::DIFFERENCE:
+      garbage.drop(k);
+      garbage.drop(found);
+      return join2(l, r);
+  }
+  return {nullptr, 0};
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::left_rotate(Node* node) noexcept {
+  if constexpr (kStats) stats_.rotate();
+  Node* rchild = rchild_of(node);
+  set_rchild(node, lchild_of(rchild));
+  if (lchild_of(rchild) != nullptr) {
+    set_parent(lchild_of(rchild), node);
+  }
+  Node* parent = parent_of(node);
+  set_parent(rchild, parent);
   if (parent == nullptr) {
     root = rchild;
-  } else if (node == parent->lchild) {
-    parent->lchild = rchild;
+  } else if (node == lchild_of(parent)) {
+    set_lchild(parent, rchild);
   } else {
-    parent->rchild = rchild;
+    set_rchild(parent, rchild);
   }
-  rchild->lchild = node;
-  node->parent = rchild;
+  set_lchild(rchild, node);
+  set_parent(node, rchild);
+  update(node);
+  update(rchild);
 }
 
-template <Comparable T, class U>
-void RBTree<T, U>::right_rotate(Node* node) noexcept {
-  Node* lchild = node->lchild;
-  node->lchild = lchild->rchild;
-  if (lchild->rchild != nullptr) {
-    lchild->rchild->parent = node;
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::right_rotate(Node* node) noexcept {
+  if constexpr (kStats) stats_.rotate();
+  Node* lchild = lchild_of(node);
+  set_lchild(node, rchild_of(lchild));
+  if (rchild_of(lchild) != nullptr) {
+    set_parent(rchild_of(lchild), node);
   }
-  Node* parent = node->parent;
-  lchild->parent = parent;
+  Node* parent = parent_of(node);
+  set_parent(lchild, parent);
   if (parent == nullptr) {
     root = lchild;
-  } else if (node == parent->lchild) {
-    parent->lchild = lchild;
+  } else if (node == lchild_of(parent)) {
+    set_lchild(parent, lchild);
   } else {
-    parent->rchild = lchild;
+    set_rchild(parent, lchild);
   }
-  lchild->rchild = node;
-  node->parent = lchild;
+  set_rchild(lchild, node);
+  set_parent(node, lchild);
+  update(node);
+  update(lchild);
 }
 
-template <Comparable T, class U>
-void RBTree<T, U>::transplant(Node* node, Node* replace) noexcept {
-  if (node->parent == nullptr) {
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::transplant(Node* node, Node* replace) noexcept {
+  if (parent_of(node) == nullptr) {
     root = replace;
-  } else if (node == node->parent->lchild) {
-    node->parent->lchild = replace;
+  } else if (node == lchild_of(parent_of(node))) {
+    set_lchild(parent_of(node), replace);
+  } else {
+    set_rchild(parent_of(node), replace);
+  }
+  set_parent(replace, parent_of(node));
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::swap_with_successor(Node* node,
+                                                     Node* s) noexcept {
+  Node* parent = parent_of(node);
+  Node* lchild = lchild_of(node);
+  Node* rchild = rchild_of(node);
+  Node* s_parent = parent_of(s);
+  Node* s_rchild = rchild_of(s);  // 后继没有左孩子
+  if (parent == nullptr) {
+    root = s;
+  } else if (node == lchild_of(parent)) {
+    set_lchild(parent, s);
+  } else {
+    set_rchild(parent, s);
+  }
+  set_parent(s, parent);
+  set_lchild(s, lchild);
+  set_parent(lchild, s);
+  if (rchild == s) {
+    set_rchild(s, node);
+    set_parent(node, s);
   } else {
-    node->parent->rchild = replace;
+    set_rchild(s, rchild);
+    set_parent(rchild, s);
+    set_lchild(s_parent, node);
+    set_parent(node, s_parent);
+  }
+  set_lchild(node, nullptr);
+  set_rchild(node, s_rchild);
+  if (s_rchild != nullptr) set_parent(s_rchild, node);
+  Color color = color_of(node);
+  set_color(node, color_of(s));
+  set_color(s, color);
+  std::swap(node->aug, s->aug);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+auto RBTree<T, U, A, Aug, L, S>::lower_bound(const K& key) const
+    -> const_iterator {
+  Node* cur = root;
+  Node* result = nullptr;
+  while (cur != nullptr) {
+    if (key_less(value_of(cur), key)) {
+      cur = rchild_of(cur);
+    } else {
+      result = cur;
+      cur = lchild_of(cur);
+    }
   }
-  replace->parent = node->parent;
+  return {this, result};
 }
 
-template <Comparable T, class U>
-auto RBTree<T, U>::successor(Node* node) noexcept -> Node* {
-  if (node->rchild != nullptr) {
-    Node* p = node->rchild;
-    while (p->lchild != nullptr) {
-      p = p->lchild;
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+auto RBTree<T, U, A, Aug, L, S>::upper_bound(const K& key) const
+    -> const_iterator {
+  Node* cur = root;
+  Node* result = nullptr;
+  while (cur != nullptr) {
+    if (key_less(key, value_of(cur))) {
+      result = cur;
+      cur = lchild_of(cur);
+    } else {
+      cur = rchild_of(cur);
+    }
+  }
+  return {this, result};
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+template <class K>
+  requires LookupKey<U, K, T>
+auto RBTree<T, U, A, Aug, L, S>::equal_range(const K& key) const
+    -> std::pair<const_iterator, const_iterator> {
+  const_iterator first = lower_bound(key);
+  const_iterator last = first;
+  if (last != end() && !comp_(key, *last)) ++last;
+  return {first, last};
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::leftmost(Node* node) const noexcept -> Node* {
+  while (lchild_of(node) != nullptr) node = lchild_of(node);
+  return node;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::rightmost(Node* node) const noexcept -> Node* {
+  while (rchild_of(node) != nullptr) node = rchild_of(node);
+  return node;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::predecessor(Node* node) const noexcept -> Node* {
+  if (lchild_of(node) != nullptr) return rightmost(lchild_of(node));
+  Node* p = parent_of(node);
+  Node* cur = node;
+  while (p != nullptr && cur == lchild_of(p)) {
+    cur = p;
+    p = parent_of(p);
+  }
+  return p;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::successor(Node* node) const noexcept -> Node* {
+  if (rchild_of(node) != nullptr) {
+    Node* p = rchild_of(node);
+    while (lchild_of(p) != nullptr) {
+      p = lchild_of(p);
     }
     return p;
   } else {
-    Node* p = node->parent;
+    Node* p = parent_of(node);
     Node* cur = node;
-    while (p != nullptr && cur == p->rchild) {
+    while (p != nullptr && cur == rchild_of(p)) {
       cur = p;
-      p = p->parent;
+      p = parent_of(p);
     }
     return p;
   }
   return nullptr;
 }
 
-template <Comparable T, class U>
-void RBTree<T, U>::insert_fix(Node* node) noexcept {
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+bool RBTree<T, U, A, Aug, L, S>::insert_fix(Node* node) noexcept {
   while (true) {
-    Node* parent = node->parent;
+    Node* parent = parent_of(node);
     if (parent == nullptr) {
-      node->color = Color::BLACK;
-      return;
+      bool was_red = color_of(node) == Color::RED;
+      set_color(node, Color::BLACK);
+      return was_red;
     }
-    if (node->color == Color::BLACK || parent->color == Color::BLACK) {
-      return;
+    if (color_of(node) == Color::BLACK || color_of(parent) == Color::BLACK) {
+      return false;
     }
-    Node* grandpa = parent->parent;
-    bool is_parent_left = grandpa->lchild == parent;
-    Node* uncle = is_parent_left ? grandpa->rchild : grandpa->lchild;
-    bool is_node_left = parent->lchild == node;
-    if (uncle != nullptr && uncle->color == Color::RED) {
-      uncle->color = Color::BLACK;
-      parent->color = Color::BLACK;
-      grandpa->color = Color::RED;
+    if constexpr (kStats) stats_.insert_fix_loop();
+    Node* grandpa = parent_of(parent);
+    bool is_parent_left = lchild_of(grandpa) == parent;
+    Node* uncle = is_parent_left ? rchild_of(grandpa) : lchild_of(grandpa);
+    bool is_node_left = lchild_of(parent) == node;
+    if (uncle != nullptr && color_of(uncle) == Color::RED) {
+      if constexpr (kStats) stats_.insert_case(InsertCase::kRecolor);
+      set_color(uncle, Color::BLACK);
+      set_color(parent, Color::BLACK);
+      set_color(grandpa, Color::RED);
       node = grandpa;
     } else {
       if (is_node_left == is_parent_left) {
+        if constexpr (kStats) stats_.insert_case(is_node_left ? InsertCase::kLL : InsertCase::kRR);
         is_node_left ? right_rotate(grandpa) : left_rotate(grandpa);
-        std::swap(grandpa->color, parent->color);
+        Color grandpa_color = color_of(grandpa);
+        set_color(grandpa, color_of(parent));
+        set_color(parent, grandpa_color);
         node = grandpa;
       } else {
+        if constexpr (kStats) stats_.insert_case(is_parent_left ? InsertCase::kLR : InsertCase::kRL);
         is_node_left ? right_rotate(parent) : left_rotate(parent);
         node = parent;
       }
@@ -228,71 +1706,216 @@ void RBTree<T, U>::insert_fix(Node* node) noexcept {
   }
 }
 
-template <Comparable T, class U>
-void RBTree<T, U>::remove_fix(Node* node) noexcept {
-  while (node != root && node->color == Color::BLACK) {
-    Node *parent = node->parent, *sibling;
-    if (node == parent->lchild) {
-      sibling = parent->rchild;
-      if (sibling->color == Color::RED) {
-        sibling->color = Color::BLACK;
-        parent->color = Color::RED;
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::remove_fix(Node* node) noexcept {
+  while (node != root && color_of(node) == Color::BLACK) {
+    if constexpr (kStats) stats_.remove_fix_loop();
+    Node *parent = parent_of(node), *sibling;
+    if (node == lchild_of(parent)) {
+      sibling = rchild_of(parent);
+      if (color_of(sibling) == Color::RED) {
+        set_color(sibling, Color::BLACK);
+        set_color(parent, Color::RED);
+        if constexpr (kStats) stats_.remove_case(RemoveCase::kRedSibling);
         left_rotate(parent);
-        parent = node->parent;
-        sibling = parent->rchild;
+        parent = parent_of(node);
+        sibling = rchild_of(parent);
       }
-      if (is_black(sibling->lchild) && is_black(sibling->rchild)) {
-        sibling->color = Color::RED;
+      if (is_black(lchild_of(sibling)) && is_black(rchild_of(sibling))) {
+        if constexpr (kStats) stats_.remove_case(RemoveCase::kRecolor);
+        set_color(sibling, Color::RED);
         node = parent;
       } else {
-        if (is_black(sibling->rchild)) {
+        if (is_black(rchild_of(sibling))) {
+          if constexpr (kStats) stats_.remove_case(RemoveCase::kNearNephew);
           right_rotate(sibling);
-          sibling = parent->rchild;
+          sibling = rchild_of(parent);
         }
-        sibling->color = parent->color;
-        parent->color = Color::BLACK;
-        sibling->rchild->color = Color::BLACK;
+        if constexpr (kStats) stats_.remove_case(RemoveCase::kFarNephew);
+        set_color(sibling, color_of(parent));
+        set_color(parent, Color::BLACK);
+        set_color(rchild_of(sibling), Color::BLACK);
         left_rotate(parent);
         node = root;
       }
     } else {
-      sibling = parent->lchild;
-      if (sibling->color == Color::RED) {
-        sibling->color = Color::BLACK;
-        parent->color = Color::RED;
+      sibling = lchild_of(parent);
+      if (color_of(sibling) == Color::RED) {
+        set_color(sibling, Color::BLACK);
+        set_color(parent, Color::RED);
+        if constexpr (kStats) stats_.remove_case(RemoveCase::kRedSibling);
         right_rotate(parent);
-        parent = node->parent;
-        sibling = parent->lchild;
+        parent = parent_of(node);
+        sibling = lchild_of(parent);
       }
-      if (is_black(sibling->lchild) && is_black(sibling->rchild)) {
-        sibling->color = Color::RED;
+      if (is_black(lchild_of(sibling)) && is_black(rchild_of(sibling))) {
+        if constexpr (kStats) stats_.remove_case(RemoveCase::kRecolor);
+        set_color(sibling, Color::RED);
         node = parent;
       } else {
-        if (is_black(sibling->lchild)) {
+        if (is_black(lchild_of(sibling))) {
+          if constexpr (kStats) stats_.remove_case(RemoveCase::kNearNephew);
           left_rotate(sibling);
-          sibling = parent->lchild;
+          sibling = lchild_of(parent);
         }
-        sibling->color = parent->color;
-        parent->color = Color::BLACK;
-        sibling->lchild->color = Color::BLACK;
+        if constexpr (kStats) stats_.remove_case(RemoveCase::kFarNephew);
+        set_color(sibling, color_of(parent));
+        set_color(parent, Color::BLACK);
+        set_color(lchild_of(sibling), Color::BLACK);
         right_rotate(parent);
         node = root;
       }
     }
   }
-  node->color = Color::BLACK;
+  set_color(node, Color::BLACK);
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+RBTree<T, U, A, Aug, L, S>::RBTree(const RBTree& other, ThreadPool& pool)
+    : links_(other.links_),
+      comp_(other.comp_),
+      alloc_(NodeAllocTraits::select_on_container_copy_construction(
+          other.alloc_)) {
+  if (other.root == nullptr) return;
+  // 与 assign 相同，分配器支持预留时所有节点来自同一块内存，按先序连续存放
+  if constexpr (requires(NodeAllocator& alloc) { alloc.reserve(size_t()); }) {
+    if constexpr (SizeAugment<Aug, Node>) {
+      alloc_.reserve(other.size());
+    } else {
+      alloc_.reserve(std::distance(other.begin(), other.end()));
+    }
+  }
+  root = copy_node(other.root);
+  int max_depth = kParallelCopy && pool.size() != 0
+                      ? std::bit_width(pool.size() + 1) + 2
+                      : 0;
+  try {
+    copy_children(other.root, root, other.black_height(other.root), 0,
+                  max_depth, pool);
+  } catch (...) {
+    // 已复制的节点都已挂在树上
+    destroy_subtree(root);
+    throw;
+  }
+  reset_bounds();
 }
 
-template <Comparable T, class U>
-RBTree<T, U>::~RBTree() {
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+auto RBTree<T, U, A, Aug, L, S>::copy_node(const Node* src) -> Node* {
+  Node* node = create_node(value_of(src));
+  set_color(node, color_of(src));
+  node->aug = src->aug;
+  return node;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::copy_children(const Node* src, Node* dst,
+                                               int bh, int depth, int max_depth,
+                                               ThreadPool& pool) {
+  int child_bh = bh - (color_of(src) == Color::BLACK);
+  // 先挂到 dst 下再继续复制，出错时已复制的部分仍连在树上
+  auto copy_child = [&](const Node* child, bool is_left) {
+    if (child == nullptr) return;
+    Node* node = copy_node(child);
+    set_parent(node, dst);
+    if (is_left) {
+      set_lchild(dst, node);
+    } else {
+      set_rchild(dst, node);
+    }
+    copy_children(child, node, child_bh, depth + 1, max_depth, pool);
+  };
+  if (depth < max_depth && bh >= kParallelBlackHeight) {
+    // 工作线程中的异常带回当前线程
+    std::exception_ptr lerror, rerror;
+    pool.invoke(
+        [&] {
+          try {
+            copy_child(lchild_of(src), true);
+          } catch (...) {
+            lerror = std::current_exception();
+          }
+        },
+        [&] {
+          try {
+            copy_child(rchild_of(src), false);
+          } catch (...) {
+            rerror = std::current_exception();
+          }
+        });
+    if (lerror) std::rethrow_exception(lerror);
+    if (rerror) std::rethrow_exception(rerror);
+  } else {
+    copy_child(lchild_of(src), true);
+    copy_child(rchild_of(src), false);
+  }
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+RBTree<T, U, A, Aug, L, S>::~RBTree() {
+  dispose();
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::dispose() noexcept {
+  if constexpr (PersistentLinks<Links, Node>) {
+    if (opened_) {
+      links_.set_root(root);
+      return;
+    }
+  }
+  clear();
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::clear() noexcept {
   if (root == nullptr) return;
-  std::queue<Node*> q;
-  q.push(root);
-  while (!q.empty()) {
-    Node* node = q.front();
-    q.pop();
-    if (node->lchild != nullptr) q.push(node->lchild);
-    if (node->rchild != nullptr) q.push(node->rchild);
-    delete node;
+  leftmost_ = rightmost_ = nullptr;
+  // 节点无需析构且节点存储支持整体释放时（如PoolAllocator、IndexLayout），
+  // 直接归还所有内存
+  if constexpr (std::is_trivially_destructible_v<Node> &&
+                requires(Links& links) {
+                  { links.release() } -> std::same_as<bool>;
+                }) {
+    if (links_.release()) {
+      root = nullptr;
+      return;
+    }
+  } else if constexpr (std::is_trivially_destructible_v<Node> &&
+                       requires(NodeAllocator& alloc) {
+                         { alloc.release() } -> std::same_as<bool>;
+                       }) {
+    if (alloc_.release()) {
+      root = nullptr;
+      return;
+    }
+  }
+  destroy_subtree(root);
+  root = nullptr;
+}
+
+template <class T, class U, class A, class Aug, class L, class S>
+  requires KeyComparator<U, T>
+void RBTree<T, U, A, Aug, L, S>::destroy_subtree(Node* node) noexcept {
+  // 有左孩子时右旋，把左子树逐步转到右侧；没有左孩子时释放节点并走向右孩子。
+  // 每个节点至多被右旋一次，总共 O(n)
+  while (node != nullptr) {
+    Node* l = lchild_of(node);
+    if (l == nullptr) {
+      Node* r = rchild_of(node);
+      destroy_node(node);
+      node = r;
+    } else {
+      set_lchild(node, rchild_of(l));
+      set_rchild(l, node);
+      node = l;
+    }
   }
 }
\ No newline at end of file
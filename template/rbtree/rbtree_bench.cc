@@ -0,0 +1,635 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "bench/bench.h"
+#include "template/btree/btree.h"
+#include "template/pool_allocator.h"
+#include "template/rbtree/concurrent_rbtree.h"
+#include "template/rbtree/durable_rbtree.h"
+#include "template/rbtree/frozen_set.h"
+#include "template/rbtree/mapped_layout.h"
+#include "template/rbtree/persistent_rbtree.h"
+#include "template/rbtree/rbtree.h"
+#include "template/rbtree/rbtree_map.h"
+#include "template/rbtree/sharded_rbtree.h"
+
+// 只用 RBTree 与 BTree 相同的接口，共用同一个适配器
+template <class Tree>
+struct TreeSet {
+  Tree tree;
+  bool insert(int key) { return tree.insert(key); }
+  void append(int key) { tree.insert(tree.end(), key); }
+  bool contains(int key) const { return tree.contains(key); }
+  bool remove(int key) { return tree.remove(key); }
+  void clear() { tree.clear(); }
+  void contains_batch(const int* keys, size_t n, bool* out) const {
+    if constexpr (requires { tree.contains_batch({keys, n}, {out, n}); }) {
+      tree.contains_batch({keys, n}, {out, n});
+    } else {
+      for (size_t i = 0; i < n; ++i) out[i] = contains(keys[i]);
+    }
+  }
+  size_t scan(int lo, size_t count) const {
+    size_t read = 0, sum = 0;
+    for (auto it = tree.lower_bound(lo); it != tree.end() && read < count;
+         ++it, ++read) {
+      sum += *it;
+    }
+    bench::sink = sum;
+    return read;
+  }
+};
+
+struct StdSet {
+  std::set<int> set;
+  bool insert(int key) { return set.insert(key).second; }
+  void append(int key) { set.insert(set.end(), key); }
+  bool contains(int key) const { return set.find(key) != set.end(); }
+  void contains_batch(const int* keys, size_t n, bool* out) const {
+    for (size_t i = 0; i < n; ++i) out[i] = contains(keys[i]);
+  }
+  bool remove(int key) { return set.erase(key) == 1; }
+  void clear() { set.clear(); }
+  size_t scan(int lo, size_t count) const {
+    size_t read = 0, sum = 0;
+    for (auto it = set.lower_bound(lo); it != set.end() && read < count;
+         ++it, ++read) {
+      sum += *it;
+    }
+    bench::sink = sum;
+    return read;
+  }
+};
+
+// 两棵 n 个元素、重叠一半的树做集合运算，按线程数统计每个元素的耗时
+void setops_bench(const bench::Options& opt) {
+  const char* ops[] = {"union", "intersect", "difference"};
+  for (size_t n : opt.sizes) {
+    std::vector<int> a(n), b(n);
+    for (size_t i = 0; i < n; ++i) {
+      a[i] = bench::scrambled_key(i);
+      b[i] = bench::scrambled_key(i + n / 2);
+    }
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    for (unsigned threads : opt.threads) {
+      ThreadPool pool(threads - 1);
+      std::string workload = "threads=" + std::to_string(threads);
+      for (int op = 0; op < 3; ++op) {
+        RBTree<int> ta(sorted_unique, a.begin(), a.end());
+        RBTree<int> tb(sorted_unique, b.begin(), b.end());
+        bench::Recorder recorder(1);
+        auto start = bench::Clock::now();
+        if (op == 0) {
+          ta.union_with(std::move(tb), pool);
+        } else if (op == 1) {
+          ta.intersect_with(std::move(tb), pool);
+        } else {
+          ta.difference_with(std::move(tb), pool);
+        }
+        recorder.add(2 * n, bench::ns_between(start, bench::Clock::now()));
+        recorder.report("rbtree", workload.c_str(), n, ops[op]);
+      }
+    }
+  }
+}
+
+// 字符串键：以 string_view 查找。透明比较器下直接比较，否则每次查找都要构造 std::string
+template <class Set>
+void string_find(const char* impl, const std::vector<std::string>& keys,
+                 const std::vector<std::string_view>& lookups) {
+  Set set;
+  for (auto& key : keys) set.insert(key);
+  bench::Recorder find(lookups.size());
+  size_t hits = 0;
+  find.run(lookups.size(), [&](size_t i) {
+    if constexpr (requires { typename Set::key_compare::is_transparent; }) {
+      hits += set.find(lookups[i]) != set.end();
+    } else {
+      hits += set.find(std::string(lookups[i])) != set.end();
+    }
+  });
+  bench::sink = hits;
+  find.report(impl, "strings", keys.size(), "find");
+}
+
+template <class Comparator>
+struct RBTreeStringSet {
+  using key_compare = Comparator;
+  RBTree<std::string, Comparator> tree;
+  void insert(const std::string& key) { tree.insert(key); }
+  template <class K>
+  auto find(const K& key) const {
+    return tree.find(key);
+  }
+  auto end() const -> typename RBTree<std::string, Comparator>::Node* {
+    return nullptr;
+  }
+};
+
+void strings_bench(const bench::Options& opt) {
+  for (size_t n : opt.sizes) {
+    std::vector<std::string> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+      // 长于短字符串优化的阈值，构造临时键需要申请内存
+      keys[i] = "user:" + std::to_string(bench::scrambled_key(i)) + ":profile";
+    }
+    std::mt19937_64 gen(opt.seed);
+    std::uniform_int_distribution<size_t> dis(0, n - 1);
+    std::vector<std::string_view> lookups(n);
+    for (auto& key : lookups) key = keys[dis(gen)];
+    if (opt.has_impl("rbtree")) {
+      string_find<RBTreeStringSet<std::less<>>>("rbtree", keys, lookups);
+    }
+    if (opt.has_impl("rbtree_copy")) {
+      string_find<RBTreeStringSet<std::less<std::string>>>("rbtree_copy", keys,
+                                                           lookups);
+    }
+    if (opt.has_impl("std::set")) {
+      string_find<std::set<std::string, std::less<>>>("std::set", keys,
+                                                      lookups);
+    }
+  }
+}
+
+struct Payload {
+  uint64_t id;
+  uint64_t version;
+  double score;
+  uint32_t flags;
+};
+
+// 预填充 n 个key后执行 n 次操作：一半为查找并读取 value，一半为 insert_or_assign，
+// key 均匀取自 [0, 2n)，查找约一半命中，upsert 约一半为插入新key
+template <class Map>
+void map_upsert(const char* impl, size_t n, const bench::Options& opt) {
+  std::mt19937_64 gen(opt.seed);
+  std::uniform_int_distribution<uint64_t> dis(0, 2 * n - 1);
+  std::vector<int> keys(n);
+  std::vector<uint8_t> is_read(n);
+  for (size_t i = 0; i < n; ++i) {
+    keys[i] = bench::scrambled_key(dis(gen));
+    is_read[i] = gen() % 2;
+  }
+  Map map;
+  for (size_t i = 0; i < n; ++i) {
+    map.insert_or_assign(bench::scrambled_key(i), Payload{i, 0, 0, 0});
+  }
+  bench::Recorder recorder(n);
+  uint64_t sum = 0;
+  recorder.run(n, [&](size_t i) {
+    if (is_read[i]) {
+      auto it = map.find(keys[i]);
+      if (it != map.end()) sum += it->second.version;
+    } else {
+      map.insert_or_assign(keys[i], Payload{i, i, 1.0, 1});
+    }
+  });
+  bench::sink = sum;
+  recorder.report(impl, "upsert50", n, "mixed");
+}
+
+void map_bench(const bench::Options& opt) {
+  for (size_t n : opt.sizes) {
+    if (opt.has_impl("rbtree_map")) {
+      map_upsert<RBTreeMap<int, Payload>>("rbtree_map", n, opt);
+    }
+    if (opt.has_impl("std::map")) {
+      map_upsert<std::map<int, Payload>>("std::map", n, opt);
+    }
+  }
+}
+
+// 以全局互斥锁保护的 RBTree，作为并发读的对照
+struct MutexRBTree {
+  mutable std::mutex mutex;
+  RBTree<int> tree;
+  bool insert(int key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tree.insert(key);
+  }
+  bool remove(int key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tree.remove(key);
+  }
+  bool contains(int key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tree.find(key) != nullptr;
+  }
+};
+
+// 预填充 n 个key，threads 个读者各做 n 次均匀随机查找，同时一个写者不断插入新key、
+// 删除最旧的key。find 为读者的总吞吐，write 为同一时间段内写者完成的操作数
+template <class Index>
+void concurrent_read(const char* impl, size_t n, unsigned threads,
+                     const bench::Options& opt) {
+  Index index;
+  for (size_t i = 0; i < n; ++i) index.insert(bench::scrambled_key(i));
+  std::mt19937_64 gen(opt.seed);
+  std::uniform_int_distribution<uint64_t> dis(0, n - 1);
+  std::vector<int> lookups(n);
+  for (auto& key : lookups) key = bench::scrambled_key(dis(gen));
+
+  std::atomic<unsigned> running = threads;
+  std::atomic<size_t> hits = 0;
+  auto start = bench::Clock::now();
+  std::vector<std::thread> readers;
+  for (unsigned t = 0; t < threads; ++t) {
+    readers.emplace_back([&, t] {
+      size_t local = 0;
+      for (size_t i = 0; i < n; ++i) {
+        local += index.contains(lookups[(i + t * 7919) % n]);
+      }
+      hits += local;
+      --running;
+    });
+  }
+  size_t writes = 0;
+  for (size_t next = n; running.load(std::memory_order_relaxed) > 0; ++next) {
+    index.insert(bench::scrambled_key(next));
+    index.remove(bench::scrambled_key(next - n));
+    writes += 2;
+  }
+  for (auto& reader : readers) reader.join();
+  double ns = bench::ns_between(start, bench::Clock::now());
+  bench::sink = hits;
+
+  std::string workload = "threads=" + std::to_string(threads);
+  bench::Recorder find(1), write(1);
+  find.add(threads * n, ns);
+  find.report(impl, workload.c_str(), n, "find");
+  write.add(writes, ns);
+  write.report(impl, workload.c_str(), n, "write");
+}
+
+void concurrent_bench(const bench::Options& opt) {
+  for (size_t n : opt.sizes) {
+    for (unsigned threads : opt.threads) {
+      if (opt.has_impl("concurrent_rbtree")) {
+        concurrent_read<ConcurrentRBTree<int>>("concurrent_rbtree", n, threads,
+                                               opt);
+      }
+      if (opt.has_impl("rbtree_mutex")) {
+        concurrent_read<MutexRBTree>("rbtree_mutex", n, threads, opt);
+      }
+    }
+  }
+}
+
+// 预填充 key 空间 [0, 2n) 中的一半，threads 个线程各执行 n 次操作：read_ratio 比例为
+// 均匀随机查找，其余一半插入一半删除，key 同样均匀取自 [0, 2n)。按总吞吐统计
+template <class Index>
+void mixed_scaling(const char* impl, size_t n, unsigned threads,
+                   const bench::Options& opt) {
+  Index index;
+  for (size_t i = 0; i < 2 * n; i += 2) index.insert(bench::scrambled_key(i));
+  std::vector<std::thread> workers;
+  std::atomic<size_t> hits = 0;
+  auto start = bench::Clock::now();
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      std::mt19937_64 gen(opt.seed + t);
+      std::uniform_int_distribution<uint64_t> dis(0, 2 * n - 1);
+      std::bernoulli_distribution coin(opt.read_ratio);
+      size_t local = 0;
+      for (size_t i = 0; i < n; ++i) {
+        int key = bench::scrambled_key(dis(gen));
+        if (coin(gen)) {
+          local += index.contains(key);
+        } else if (i % 2 == 0) {
+          index.insert(key);
+        } else {
+          index.remove(key);
+        }
+      }
+      hits += local;
+    });
+  }
+  for (auto& worker : workers) worker.join();
+  bench::sink = hits;
+  std::string workload = "threads=" + std::to_string(threads);
+  bench::Recorder mixed(1);
+  mixed.add(threads * n, bench::ns_between(start, bench::Clock::now()));
+  mixed.report(impl, workload.c_str(), n, "mixed");
+}
+
+void sharded_bench(const bench::Options& opt) {
+  for (size_t n : opt.sizes) {
+    for (unsigned threads : opt.threads) {
+      if (opt.has_impl("sharded_rbtree")) {
+        mixed_scaling<ShardedRBTree<int>>("sharded_rbtree", n, threads, opt);
+      }
+      if (opt.has_impl("rbtree_mutex")) {
+        mixed_scaling<MutexRBTree>("rbtree_mutex", n, threads, opt);
+      }
+    }
+  }
+}
+
+// n 次乱序插入后 n 次乱序删除，versions 决定修改期间保留多少个快照：
+//   none   不取快照，持久化树原地修改
+//   latest 每次修改前取快照并只保留最新的一个，即每次修改都要复制路径
+//   all    保留每次修改前的快照，peak_rss_kb 与 none 之差除以 2n 即每个版本的内存开销
+template <class Tree>
+void persistent_update(const char* impl, const char* versions, size_t n) {
+  Tree tree;
+  std::vector<typename Tree::Snapshot> kept;
+  typename Tree::Snapshot latest;
+  bool keep_all = strcmp(versions, "all") == 0;
+  bool keep_latest = strcmp(versions, "latest") == 0;
+  if (keep_all) kept.reserve(2 * n);
+  auto take = [&] {
+    if (keep_all) {
+      kept.push_back(tree.snapshot());
+    } else if (keep_latest) {
+      latest = tree.snapshot();
+    }
+  };
+  std::string workload = std::string("versions=") + versions;
+  bench::reset_peak_rss();
+  bench::Recorder insert(n);
+  insert.run(n, [&](size_t i) {
+    take();
+    tree.insert(bench::scrambled_key(i));
+  });
+  insert.report(impl, workload.c_str(), n, "insert");
+  bench::Recorder remove(n);
+  remove.run(n, [&](size_t i) {
+    take();
+    tree.remove(bench::scrambled_key(i));
+  });
+  remove.report(impl, workload.c_str(), n, "remove");
+}
+
+// 可变 RBTree 作为对照，接口与 PersistentRBTree 一致但没有快照
+struct MutableRBTree {
+  struct Snapshot {};
+  RBTree<int> tree;
+  bool insert(int key) { return tree.insert(key); }
+  bool remove(int key) { return tree.remove(key); }
+  auto snapshot() const -> Snapshot { return {}; }
+};
+
+void persistent_bench(const bench::Options& opt) {
+  for (size_t n : opt.sizes) {
+    if (opt.has_impl("rbtree")) {
+      persistent_update<MutableRBTree>("rbtree", "none", n);
+    }
+    if (opt.has_impl("persistent_rbtree")) {
+      for (const char* versions : {"none", "latest", "all"}) {
+        persistent_update<PersistentRBTree<int>>("persistent_rbtree",
+                                                 versions, n);
+      }
+    }
+  }
+}
+
+// RBTree 冻结前后的只读查找对比：n 次均匀随机查找，一半命中。
+// sorted_vector 在同样数据的有序数组上二分，作为只改为连续存放、不改变查找顺序的对照
+void frozen_bench(const bench::Options& opt) {
+  for (size_t n : opt.sizes) {
+    RBTree<int> tree;
+    for (size_t i = 0; i < n; ++i) tree.insert(bench::scrambled_key(i));
+    std::mt19937_64 gen(opt.seed);
+    std::uniform_int_distribution<uint64_t> dis(0, n - 1);
+    std::vector<int> lookups(n);
+    // [n, 2n) 的乱序 key 不在树中
+    for (auto& key : lookups) {
+      key = bench::scrambled_key(dis(gen) + gen() % 2 * n);
+    }
+
+    auto lookup = [&](const char* impl, auto&& contains) {
+      if (!opt.has_impl(impl)) return;
+      bench::Recorder find(n);
+      size_t hits = 0;
+      find.run(n, [&](size_t i) { hits += contains(lookups[i]); });
+      bench::sink = hits;
+      find.report(impl, "uniform", n, "find");
+    };
+    lookup("rbtree", [&](int key) { return tree.find(key) != nullptr; });
+
+    bench::Recorder freeze(1);
+    auto start = bench::Clock::now();
+    FrozenSet<int> frozen = tree.freeze();
+    freeze.add(n, bench::ns_between(start, bench::Clock::now()));
+    freeze.report("frozen_set", "uniform", n, "freeze");
+    lookup("frozen_set", [&](int key) { return frozen.contains(key); });
+
+    std::vector<int> sorted(tree.begin(), tree.end());
+    lookup("sorted_vector", [&](int key) {
+      return std::binary_search(sorted.begin(), sorted.end(), key);
+    });
+  }
+}
+
+// 重启后恢复索引：rbtree 重新插入全部 key，mapped_rbtree 直接打开文件。
+// reopen 的 ops 为1，即打开一次的总耗时；之后的 find 含按需读入页面的开销
+void mapped_bench(const bench::Options& opt) {
+  using Layout = MappedLayout::links<int, NoAugment>;
+  using MappedTree =
+      RBTree<int, std::less<int>, std::allocator<int>, NoAugment, MappedLayout>;
+  for (size_t n : opt.sizes) {
+    if (opt.has_impl("rbtree")) {
+      bench::Recorder rebuild(n);
+      RBTree<int> tree;
+      rebuild.run(n, [&](size_t i) { tree.insert(bench::scrambled_key(i)); });
+      rebuild.report("rbtree", "restart", n, "rebuild");
+    }
+    if (!opt.has_impl("mapped_rbtree")) continue;
+    char path[] = "/tmp/rbtree_bench.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return;
+    close(fd);
+    unlink(path);
+    {
+      bench::Recorder insert(n), flush(1);
+      MappedTree tree{Layout(path)};
+      insert.run(n, [&](size_t i) { tree.insert(bench::scrambled_key(i)); });
+      insert.report("mapped_rbtree", "restart", n, "insert");
+      flush.run(1, [&](size_t) { tree.flush(); });
+      flush.report("mapped_rbtree", "restart", n, "flush");
+    }
+    bench::Recorder reopen(1), find(n);
+    auto start = bench::Clock::now();
+    MappedTree tree{Layout(path)};
+    reopen.add(1, bench::ns_between(start, bench::Clock::now()));
+    reopen.report("mapped_rbtree", "restart", n, "reopen");
+    std::mt19937_64 gen(opt.seed);
+    std::uniform_int_distribution<uint64_t> dis(0, n - 1);
+    size_t hits = 0;
+    find.run(n, [&](size_t) {
+      hits += tree.find(bench::scrambled_key(dis(gen))) != nullptr;
+    });
+    bench::sink = hits;
+    find.report("mapped_rbtree", "restart", n, "find");
+    unlink(path);
+  }
+}
+
+// 持续写入时的可持久化吞吐：每 group 次插入一次 fdatasync（不按时间提交），
+// workload 列为组大小。文件放在 /var/tmp（通常不是 tmpfs）。组大小为1时每次插入都要等待落盘，
+// 只测 min(n, 10000) 次。replay 为重新打开时重放日志的平均每条耗时
+void durable_bench(const bench::Options& opt) {
+  if (!opt.has_impl("durable_rbtree")) return;
+  for (size_t n : opt.sizes) {
+    for (size_t group : {1, 16, 256, 4096}) {
+      char dir[] = "/var/tmp/rbtree_bench.XXXXXX";
+      if (mkdtemp(dir) == nullptr) return;
+      DurableRBTree<int>::Config config;
+      config.log.group_ops = group;
+      config.log.group_interval = std::chrono::microseconds(0);
+      config.checkpoint_ops = 0;
+      size_t ops = group == 1 ? std::min<size_t>(n, 10000) : n;
+      std::string workload = "group" + std::to_string(group);
+      {
+        bench::Recorder insert(ops);
+        DurableRBTree<int> tree(dir, config);
+        insert.run(ops, [&](size_t i) { tree.insert(bench::scrambled_key(i)); });
+        tree.sync();
+        insert.report("durable_rbtree", workload.c_str(), n, "insert");
+      }
+      bench::Recorder replay(1);
+      auto start = bench::Clock::now();
+      DurableRBTree<int> tree(dir, config);
+      replay.add(tree.replayed(), bench::ns_between(start, bench::Clock::now()));
+      replay.report("durable_rbtree", workload.c_str(), n, "replay");
+      std::filesystem::remove_all(dir);
+    }
+  }
+}
+
+// 复制整棵树：reinsert 逐个插入原树的值，copy 为复制构造（按线程数）。
+// 下标布局的节点存储不是线程安全的，只顺序复制
+template <class Tree>
+void copy_tree(const char* impl, size_t n, const bench::Options& opt,
+               bool parallel) {
+  if (!opt.has_impl(impl)) return;
+  std::vector<int> keys(n);
+  for (size_t i = 0; i < n; ++i) keys[i] = bench::scrambled_key(i);
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  Tree tree(sorted_unique, keys.begin(), keys.end());
+  keys = std::vector<int>();
+  {
+    bench::Recorder reinsert(1);
+    auto start = bench::Clock::now();
+    Tree copy(tree.get_allocator(), tree.get_layout());
+    for (int key : tree) copy.insert(key);
+    reinsert.add(n, bench::ns_between(start, bench::Clock::now()));
+    reinsert.report(impl, "reinsert", n, "copy");
+  }
+  for (unsigned threads : opt.threads) {
+    if (!parallel && threads > 1) break;
+    ThreadPool pool(threads - 1);
+    bench::Recorder copy(1);
+    auto start = bench::Clock::now();
+    Tree copied(tree, pool);
+    copy.add(n, bench::ns_between(start, bench::Clock::now()));
+    std::string workload = "threads=" + std::to_string(threads);
+    copy.report(impl, workload.c_str(), n, "copy");
+  }
+}
+
+void copy_bench(const bench::Options& opt) {
+  for (size_t n : opt.sizes) {
+    copy_tree<RBTree<int>>("rbtree", n, opt, true);
+    copy_tree<RBTree<int, std::less<int>, std::allocator<int>, NoAugment,
+                     IndexLayout>>("rbtree_index", n, opt, false);
+  }
+}
+
+// 区间查询：n 个 [start, end) 区间，start 在 [0, 16n) 中均匀分布，长度在 [1, 1024) 中，
+// 每次查询平均命中约 32 个。stab 查询包含一个点的区间，overlap 查询与长为 1024 的窗口
+// 相交的区间。sorted_vector 按 start 排序，二分找到 start 不小于查询上界的位置后，
+// 向前扫描之前的全部区间逐个检查 end，只测 min(n, 1000) 次
+void interval_bench(const bench::Options& opt) {
+  for (size_t n : opt.sizes) {
+    int range = static_cast<int>(std::min<size_t>(n * 16, INT_MAX - 2048));
+    std::mt19937_64 gen(opt.seed);
+    std::uniform_int_distribution<int> start_dis(0, range - 1), len_dis(1, 1023);
+    std::vector<Interval<int>> intervals(n);
+    for (auto& x : intervals) {
+      x.start = start_dis(gen);
+      x.end = x.start + len_dis(gen);
+    }
+    std::vector<int> points(n);
+    for (int& p : points) p = start_dis(gen);
+
+    auto query = [&](const char* impl, size_t ops, auto&& overlaps) {
+      for (int window : {1, 1024}) {
+        bench::Recorder recorder(ops);
+        size_t hits = 0;
+        recorder.run(ops, [&](size_t i) {
+          hits += overlaps(points[i], points[i] + window);
+        });
+        bench::sink = hits;
+        recorder.report(impl, window == 1 ? "stab" : "overlap", n, "query");
+      }
+    };
+    if (opt.has_impl("interval_tree")) {
+      IntervalTree<int> tree;
+      bench::Recorder insert(n);
+      insert.run(n, [&](size_t i) { tree.insert(intervals[i]); });
+      insert.report("interval_tree", "uniform", n, "insert");
+      query("interval_tree", n, [&](int lo, int hi) {
+        size_t count = 0;
+        if (hi == lo + 1) {
+          tree.stab(lo, [&](const Interval<int>&) { ++count; });
+        } else {
+          tree.overlaps(lo, hi, [&](const Interval<int>&) { ++count; });
+        }
+        return count;
+      });
+    }
+    if (opt.has_impl("sorted_vector")) {
+      std::vector<Interval<int>> sorted = intervals;
+      std::sort(sorted.begin(), sorted.end());
+      query("sorted_vector", std::min<size_t>(n, 1000), [&](int lo, int hi) {
+        auto last = std::lower_bound(
+            sorted.begin(), sorted.end(), hi,
+            [](const Interval<int>& x, int hi) { return x.start < hi; });
+        size_t count = 0;
+        for (auto it = sorted.begin(); it != last; ++it) count += lo < it->end;
+        return count;
+      });
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  bench::Options opt = bench::parse_options(argc, argv);
+  bench::print_header();
+  if (opt.has_suite("workloads")) {
+    bench::run<TreeSet<RBTree<int>>>("rbtree", opt);
+    bench::run<TreeSet<RBTree<int, std::less<int>, PoolAllocator<int>>>>(
+        "rbtree_pool", opt);
+    bench::run<TreeSet<RBTree<int, std::less<int>, std::allocator<int>,
+                                NoAugment, PackedLayout>>>("rbtree_packed", opt);
+    bench::run<TreeSet<RBTree<int, std::less<int>, std::allocator<int>,
+                                NoAugment, IndexLayout>>>("rbtree_index", opt);
+    bench::run<TreeSet<BTree<int>>>("btree", opt);
+    bench::run<StdSet>("std::set", opt);
+  }
+  if (opt.has_suite("setops")) setops_bench(opt);
+  if (opt.has_suite("strings")) strings_bench(opt);
+  if (opt.has_suite("map")) map_bench(opt);
+  if (opt.has_suite("concurrent")) concurrent_bench(opt);
+  if (opt.has_suite("persistent")) persistent_bench(opt);
+  if (opt.has_suite("sharded")) sharded_bench(opt);
+  if (opt.has_suite("frozen")) frozen_bench(opt);
+  if (opt.has_suite("mapped")) mapped_bench(opt);
+  if (opt.has_suite("durable")) durable_bench(opt);
+  if (opt.has_suite("copy")) copy_bench(opt);
+  if (opt.has_suite("interval")) interval_bench(opt);
+  return 0;
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "template/rbtree/rbtree.h"
+
+// Comparator 透明时可以直接用 Key 查找；否则 Key 需要能转换为 K，查找前先构造一个 K
+template <class Comparator, class Key, class K>
+concept MapLookupKey =
+    LookupKey<Comparator, Key, K> || std::constructible_from<K, const Key&>;
+
+/*
+有序 key -> value 映射，平衡部分直接复用 RBTree：
+树中存放 std::pair<const K, V>，只按 key 比较，key 与 value 位于同一个节点内。
+try_emplace / insert_or_assign / operator[] 都只查找一次，
+value 只在真正插入时构造，已存在时不会先默认构造再赋值。
+*/
+template <class K, class V, class Comparator = std::less<K>,
+          class Allocator = std::allocator<std::pair<const K, V>>,
+          class Layout = PointerLayout>
+class RBTreeMap {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<const K, V>;
+  using key_compare = Comparator;
+  using allocator_type = Allocator;
+  using size_type = size_t;
+
+ private:
+  // 按 key 比较 value_type；Comparator 透明时同样接受其它可比较的 key 类型
+  struct KeyCompare {
+    using is_transparent = void;
+    [[no_unique_address]] Comparator comp;
+
+    bool operator()(const value_type& a, const value_type& b) const {
+      return comp(a.first, b.first);
+    }
+    template <class Key>
+      requires LookupKey<Comparator, Key, K>
+    bool operator()(const value_type& a, const Key& b) const {
+      return comp(a.first, b);
+    }
+    template <class Key>
+      requires LookupKey<Comparator, Key, K>
+    bool operator()(const Key& a, const value_type& b) const {
+      return comp(a, b.first);
+    }
+  };
+  using Tree = RBTree<value_type, KeyCompare, Allocator, NoAugment, Layout>;
+
+  template <bool kConst>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = RBTreeMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<kConst, const value_type*, value_type*>;
+    using reference = std::conditional_t<kConst, const value_type&, value_type&>;
+
+    Iterator() = default;
+    // iterator 可以隐式转换为 const_iterator
+    template <bool kOther>
+      requires(kConst && !kOther)
+    Iterator(const Iterator<kOther>& other) : it_(other.it_) {}
+
+    reference operator*() const { return it_.node()->value; }
+    pointer operator->() const { return &it_.node()->value; }
+    Iterator& operator++() {
+      ++it_;
+      return *this;
+    }
+    Iterator& operator--() {
+      --it_;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++it_;
+      return old;
+    }
+    Iterator operator--(int) {
+      Iterator old = *this;
+      --it_;
+      return old;
+    }
+    bool operator==(const Iterator& other) const { return it_ == other.it_; }
+
+   private:
+    friend class RBTreeMap;
+    friend class Iterator<!kConst>;
+    explicit Iterator(typename Tree::const_iterator it) : it_(it) {}
+
+    typename Tree::const_iterator it_;
+  };
+
+ public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  RBTreeMap() = default;
+  explicit RBTreeMap(const Comparator& comp,
+                     const Allocator& alloc = Allocator())
+      : tree_(KeyCompare{comp}, alloc) {}
+
+  template <class... Args>
+  auto try_emplace(const K& key, Args&&... args) -> std::pair<iterator, bool> {
+    return emplace_key(key, key, std::forward<Args>(args)...);
+  }
+  template <class... Args>
+  auto try_emplace(K&& key, Args&&... args) -> std::pair<iterator, bool> {
+    return emplace_key(key, std::move(key), std::forward<Args>(args)...);
+  }
+
+  template <class M>
+  auto insert_or_assign(const K& key, M&& obj) -> std::pair<iterator, bool> {
+    return assign_key(key, key, std::forward<M>(obj));
+  }
+  template <class M>
+  auto insert_or_assign(K&& key, M&& obj) -> std::pair<iterator, bool> {
+    return assign_key(key, std::move(key), std::forward<M>(obj));
+  }
+
+  auto insert(const value_type& value) -> std::pair<iterator, bool> {
+    return emplace_key(value.first, value.first, value.second);
+  }
+  auto insert(value_type&& value) -> std::pair<iterator, bool> {
+    return emplace_key(value.first, std::move(value.first),
+                       std::move(value.second));
+  }
+
+  // key 不存在时插入值初始化的 value
+  V& operator[](const K& key) { return try_emplace(key).first->second; }
+  V& operator[](K&& key) { return try_emplace(std::move(key)).first->second; }
+
+  template <class Key = K>
+    requires MapLookupKey<Comparator, Key, K>
+  auto find(const Key& key) -> iterator {
+    return make_iterator(tree_.find(as_key(key)));
+  }
+  template <class Key = K>
+    requires MapLookupKey<Comparator, Key, K>
+  auto find(const Key& key) const -> const_iterator {
+    return const_iterator(make_iterator(tree_.find(as_key(key))));
+  }
+  template <class Key = K>
+    requires MapLookupKey<Comparator, Key, K>
+  bool contains(const Key& key) const {
+    return tree_.find(as_key(key)) != nullptr;
+  }
+  // key 不存在时抛出 std::out_of_range
+  template <class Key = K>
+    requires MapLookupKey<Comparator, Key, K>
+  V& at(const Key& key) {
+    auto node = tree_.find(as_key(key));
+    if (node == nullptr) throw std::out_of_range("RBTreeMap::at");
+    return node->value.second;
+  }
+  template <class Key = K>
+    requires MapLookupKey<Comparator, Key, K>
+  const V& at(const Key& key) const {
+    auto node = tree_.find(as_key(key));
+    if (node == nullptr) throw std::out_of_range("RBTreeMap::at");
+    return node->value.second;
+  }
+
+  template <class Key = K>
+    requires MapLookupKey<Comparator, Key, K>
+  auto lower_bound(const Key& key) const -> const_iterator {
+    return const_iterator(tree_.lower_bound(as_key(key)));
+  }
+  template <class Key = K>
+    requires MapLookupKey<Comparator, Key, K>
+  auto upper_bound(const Key& key) const -> const_iterator {
+    return const_iterator(tree_.upper_bound(as_key(key)));
+  }
+  template <class Key = K>
+    requires MapLookupKey<Comparator, Key, K>
+  auto lower_bound(const Key& key) -> iterator {
+    return iterator(tree_.lower_bound(as_key(key)));
+  }
+  template <class Key = K>
+    requires MapLookupKey<Comparator, Key, K>
+  auto upper_bound(const Key& key) -> iterator {
+    return iterator(tree_.upper_bound(as_key(key)));
+  }
+
+  // 返回删除的元素个数
+  template <class Key = K>
+    requires MapLookupKey<Comparator, Key, K>
+  size_t erase(const Key& key) {
+    if (!tree_.remove(as_key(key))) return 0;
+    --size_;
+    return 1;
+  }
+  // 返回被删除元素的下一个位置
+  auto erase(const_iterator pos) -> iterator {
+    iterator next(pos.it_);
+    ++next;
+    tree_.erase(pos.it_.node());
+    --size_;
+    return next;
+  }
+
+  auto begin() -> iterator { return iterator(tree_.begin()); }
+  auto end() -> iterator { return iterator(tree_.end()); }
+  auto begin() const -> const_iterator { return const_iterator(tree_.begin()); }
+  auto end() const -> const_iterator { return const_iterator(tree_.end()); }
+
+  size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  // for debug
+  void check() const { tree_.check(); }
+
+  Allocator get_allocator() const { return tree_.get_allocator(); }
+
+ private:
+  auto make_iterator(typename Tree::Node* node) const -> iterator {
+    return iterator(tree_.iterator_to(node));
+  }
+
+  template <class Key>
+  static decltype(auto) as_key(const Key& key) {
+    if constexpr (LookupKey<Comparator, Key, K>) {
+      return (key);
+    } else {
+      return K(key);
+    }
+  }
+
+  // 以 key 查找一次，不存在时由 key_arg 和 args 原地构造 pair
+  template <class KeyArg, class... Args>
+  auto emplace_key(const K& key, KeyArg&& key_arg, Args&&... args)
+      -> std::pair<iterator, bool> {
+    auto [node, inserted] = tree_.try_emplace(
+        key, std::piecewise_construct,
+        std::forward_as_tuple(std::forward<KeyArg>(key_arg)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    size_ += inserted;
+    return {iterator(tree_.iterator_to(node)), inserted};
+  }
+
+  template <class KeyArg, class M>
+  auto assign_key(const K& key, KeyArg&& key_arg, M&& obj)
+      -> std::pair<iterator, bool> {
+    auto result =
+        emplace_key(key, std::forward<KeyArg>(key_arg), std::forward<M>(obj));
+    // 未插入时 obj 没有被使用，直接赋给已有的 value
+    if (!result.second) result.first->second = std::forward<M>(obj);
+    return result;
+  }
+
+  Tree tree_;
+  size_t size_ = 0;
+};
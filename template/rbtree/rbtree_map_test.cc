@@ -0,0 +1,124 @@
+#include "template/rbtree/rbtree_map.h"
+
+#include <cassert>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+
+std::random_device rd;
+std::mt19937 gen(rd());
+std::uniform_int_distribution<> dis(1, 1000000);
+int random_int() { return dis(gen); }
+
+// 记录构造与赋值次数的 value
+struct Payload {
+  static inline int default_constructed = 0;
+  static inline int assigned = 0;
+  int data = 0;
+
+  Payload() { ++default_constructed; }
+  explicit Payload(int d) : data(d) {}
+  Payload(const Payload&) = default;
+  Payload& operator=(const Payload& other) {
+    ++assigned;
+    data = other.data;
+    return *this;
+  }
+};
+
+void basic_test() {
+  static_assert(std::bidirectional_iterator<RBTreeMap<int, int>::iterator>);
+  static_assert(std::bidirectional_iterator<RBTreeMap<int, int>::const_iterator>);
+  RBTreeMap<int, int> map;
+  std::map<int, int> expect;
+  for (int i = 0; i < 20000; ++i) {
+    int key = random_int() % 5000;
+    switch (i % 4) {
+      case 0:
+        map[key] += i;
+        expect[key] += i;
+        break;
+      case 1:
+        assert(map.insert_or_assign(key, i).second ==
+               expect.insert_or_assign(key, i).second);
+        break;
+      case 2:
+        assert(map.try_emplace(key, i).second ==
+               expect.try_emplace(key, i).second);
+        break;
+      case 3:
+        assert(map.erase(key) == expect.erase(key));
+        break;
+    }
+  }
+  map.check();
+  assert(map.size() == expect.size());
+  assert(std::equal(map.begin(), map.end(), expect.begin(), expect.end()));
+  for (int key = 0; key < 5000; ++key) {
+    assert(map.contains(key) == expect.contains(key));
+    auto it = map.find(key);
+    if (it != map.end()) assert(it->second == expect[key]);
+    auto lower = map.lower_bound(key);
+    auto expect_lower = expect.lower_bound(key);
+    assert(lower == map.end() ? expect_lower == expect.end()
+                              : lower->first == expect_lower->first);
+  }
+
+  // 通过迭代器原地修改 value，按迭代器删除
+  for (auto& [key, value] : map) value = -key;
+  for (auto it = map.begin(); it != map.end();) {
+    assert(it->second == -it->first);
+    it = it->first % 2 == 0 ? map.erase(it) : std::next(it);
+  }
+  map.check();
+  for (const auto& [key, value] : std::as_const(map)) assert(key % 2 == 1);
+
+  bool thrown = false;
+  try {
+    map.at(-1);
+  } catch (const std::out_of_range&) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void upsert_test() {
+  // 已存在时 try_emplace 不构造 value，insert_or_assign 只赋值一次
+  RBTreeMap<int, Payload> map;
+  for (int i = 0; i < 100; ++i) map.try_emplace(i, i);
+  assert(Payload::default_constructed == 0);
+  for (int i = 0; i < 100; ++i) {
+    assert(!map.try_emplace(i, -1).second);
+    assert(!map.insert_or_assign(i, Payload(i * 2)).second);
+  }
+  assert(Payload::default_constructed == 0 && Payload::assigned == 100);
+  for (int i = 0; i < 100; ++i) assert(map.at(i).data == i * 2);
+  // operator[] 只在插入时值初始化
+  map[0].data = 7;
+  assert(Payload::default_constructed == 0);
+  map[100].data = 8;
+  assert(Payload::default_constructed == 1 && map.size() == 101);
+
+  // 字符串键，透明比较器可以直接用 string_view 查找
+  RBTreeMap<std::string, std::string, std::less<>> strings;
+  strings["apple"] = "red";
+  strings.try_emplace("banana", 3, 'y');
+  strings.insert_or_assign(std::string("cherry"), "dark red");
+  assert(strings.find(std::string_view("banana"))->second == "yyy");
+  assert(strings.at(std::string_view("cherry")) == "dark red");
+  assert(strings.erase(std::string_view("apple")) == 1);
+  assert(!strings.contains(std::string_view("apple")) && strings.size() == 2);
+  strings.check();
+
+  // 非透明比较器下，可转换的 key 先构造 K 再查找
+  RBTreeMap<std::string, int> plain;
+  plain["key"] = 1;
+  assert(plain.contains("key") && plain.at("key") == 1);
+}
+
+int main() {
+  basic_test();
+  upsert_test();
+  return 0;
+}
@@ -1,9 +1,19 @@
 #include "template/rbtree/rbtree.h"
 
+#include "template/pool_allocator.h"
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <climits>
 #include <iostream>
+#include <map>
 #include <random>
+#include <ranges>
 #include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <unordered_set>
 
 std::random_device rd;
@@ -27,7 +37,7 @@ void insert_test() {
     std::vector<int> nums = {17, 18, 23, 34, 27, 15, 9, 6, 8, 5, 25};
     for (auto num : nums) {
       rbtree.insert(num);
-      // rbtree.check();
+      rbtree.check();
     }
   }
 }
@@ -44,7 +54,7 @@ void remove_test() {
   assert(s.find(3) != nullptr);
   s.remove(4);
   s.remove(3);
-  // s.check();
+  s.check();
   s.remove(2);
   s.remove(1);
   assert(s.find(5) != nullptr);
@@ -74,9 +84,965 @@ void batch_test() {
   }
 }
 
+void pool_allocator_test() {
+  using PoolTree = RBTree<int, std::less<int>, PoolAllocator<int>>;
+  {
+    PoolTree rbtree;
+    std::set<int> s;
+    for (int i = 0; i < 100000; ++i) {
+      int temp = random_int();
+      assert(rbtree.insert(temp) == s.insert(temp).second);
+    }
+    for (int i = 0; i < 100000; ++i) {
+      int temp = random_int();
+      assert(rbtree.remove(temp) == (s.erase(temp) == 1));
+    }
+    for (auto num : s) {
+      assert(rbtree.find(num) != nullptr);
+    }
+  }
+  {
+    // 释放的节点会被复用
+    PoolTree rbtree;
+    rbtree.insert(1);
+    auto* node = rbtree.find(1);
+    rbtree.remove(1);
+    rbtree.insert(2);
+    assert(rbtree.find(2) == node);
+  }
+  {
+    // 共享内存池的两棵树，各自析构时不能整体释放内存池
+    PoolAllocator<int> alloc;
+    PoolTree a(alloc), b(alloc);
+    for (int i = 0; i < 1000; ++i) {
+      a.insert(i);
+      b.insert(-i);
+    }
+    assert(a.get_allocator() == b.get_allocator());
+  }
+}
+
+void sorted_build_test() {
+  for (int n = 0; n <= 200; ++n) {
+    std::vector<int> nums(n);
+    for (int i = 0; i < n; ++i) nums[i] = i * 2;
+    RBTree<int> rbtree(sorted_unique, nums.begin(), nums.end());
+    rbtree.check();
+    for (int i = 0; i < n; ++i) {
+      assert(rbtree.find(i * 2) != nullptr);
+      assert(rbtree.find(i * 2 + 1) == nullptr);
+    }
+    for (int i = 0; i < n; ++i) {
+      assert(rbtree.insert(i * 2 + 1));
+      assert(rbtree.remove(i * 2));
+      rbtree.check();
+    }
+  }
+  {
+    // 直接使用std::set的迭代器，且在已有数据的树上重新构建
+    std::set<int> s;
+    for (int i = 0; i < 100000; ++i) s.insert(random_int());
+    RBTree<int> rbtree;
+    rbtree.insert(-1);
+    rbtree.assign(sorted_unique, s.begin(), s.end());
+    rbtree.check();
+    assert(rbtree.find(-1) == nullptr);
+    for (auto num : s) assert(rbtree.find(num) != nullptr);
+  }
+  {
+    // 使用内存池时所有节点来自同一块slab，按中序连续排列
+    std::vector<int> nums(10000);
+    for (int i = 0; i < 10000; ++i) nums[i] = i;
+    RBTree<int, std::less<int>, PoolAllocator<int>> rbtree(
+        sorted_unique, nums.begin(), nums.end());
+    rbtree.check();
+    auto* first = rbtree.find(0);
+    for (int i = 0; i < 10000; ++i) assert(rbtree.find(i) == first + i);
+    // 另一棵树共用内存池，clear 逐个释放节点，重建时池中已有空闲链表，仍然连续
+    RBTree<int, std::less<int>, PoolAllocator<int>> other(rbtree.get_allocator());
+    other.insert(-1);
+    rbtree.assign(sorted_unique, nums.begin(), nums.end());
+    first = rbtree.find(0);
+    for (int i = 0; i < 10000; ++i) assert(rbtree.find(i) == first + i);
+  }
+}
+
+void split_join_test() {
+  for (int round = 0; round < 200; ++round) {
+    int n = round < 100 ? round : random_int() % 5000;
+    RBTree<int> rbtree;
+    std::set<int> s;
+    for (int i = 0; i < n; ++i) {
+      int temp = random_int() % 10000;
+      rbtree.insert(temp);
+      s.insert(temp);
+    }
+    int key = random_int() % 10001;
+    RBTree<int> greater;
+    greater.insert(-1);
+    rbtree.split(key, greater);
+    rbtree.check();
+    greater.check();
+    assert(greater.find(-1) == nullptr);
+    for (auto num : s) {
+      assert((rbtree.find(num) != nullptr) == (num < key));
+      assert((greater.find(num) != nullptr) == (num >= key));
+    }
+    // 带 pivot 连接，再切开 pivot，最后无 pivot 连接回原树
+    if (s.count(key) == 0) {
+      rbtree.join(key, greater);
+      rbtree.check();
+      assert(greater.find(key) == nullptr);
+      assert(rbtree.find(key) != nullptr);
+      rbtree.split(key, greater);
+      s.insert(key);
+    }
+    rbtree.join(greater);
+    rbtree.check();
+    for (auto num : s) assert(rbtree.find(num) != nullptr);
+    for (int i = 0; i < 100; ++i) {
+      int temp = random_int() % 10000;
+      assert(rbtree.remove(temp) == (s.erase(temp) == 1));
+    }
+    rbtree.check();
+  }
+  {
+    // 高度差很大的两棵树连接
+    std::vector<int> nums(100000);
+    for (int i = 0; i < 100000; ++i) nums[i] = i;
+    RBTree<int> big(sorted_unique, nums.begin(), nums.end()), small, empty;
+    small.insert(120000);
+    small.join(150000, empty);
+    big.join(small);
+    big.check();
+    empty.join(big);
+    empty.check();
+    assert(empty.find(150000) != nullptr && empty.find(99999) != nullptr);
+  }
+  {
+    // 节点直接移入另一棵树，且切分结果沿用原树的内存池
+    RBTree<int, std::less<int>, PoolAllocator<int>> rbtree, greater;
+    for (int i = 0; i < 1000; ++i) rbtree.insert(i);
+    auto* node = rbtree.find(700);
+    rbtree.split(500, greater);
+    assert(greater.find(700) == node);
+    assert(greater.get_allocator() == rbtree.get_allocator());
+    rbtree.join(greater);
+    rbtree.check();
+  }
+}
+
+template <class Tree>
+std::vector<int> to_vector(const Tree& tree, const std::set<int>& universe) {
+  std::vector<int> nums;
+  for (auto num : universe) {
+    if (tree.find(num) != nullptr) nums.push_back(num);
+  }
+  return nums;
+}
+
+void set_operation_test() {
+  ThreadPool pool(3);
+  for (int round = 0; round < 53; ++round) {
+    int n = round < 50 ? round * 3 : 100000;
+    int range = round % 2 == 0 ? n * 2 + 1 : n * 20 + 1;
+    std::set<int> a, b, universe;
+    for (int i = 0; i < n; ++i) a.insert(random_int() % range);
+    for (int i = 0; i < n / (round % 3 + 1); ++i) b.insert(random_int() % range);
+    universe.insert(a.begin(), a.end());
+    universe.insert(b.begin(), b.end());
+    for (int op = 0; op < 3; ++op) {
+      RBTree<int> ta(sorted_unique, a.begin(), a.end());
+      RBTree<int> tb(sorted_unique, b.begin(), b.end());
+      std::vector<int> expect;
+      if (op == 0) {
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                       std::back_inserter(expect));
+        ta.union_with(std::move(tb), pool);
+      } else if (op == 1) {
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                              std::back_inserter(expect));
+        ta.intersect_with(std::move(tb), pool);
+      } else {
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(),
+                            std::back_inserter(expect));
+        ta.difference_with(std::move(tb), pool);
+      }
+      ta.check();
+      tb.check();
+      assert(tb.find(*universe.begin()) == nullptr);
+      assert(to_vector(ta, universe) == expect);
+    }
+  }
+  {
+    // 默认线程池 + 内存池分配器
+    RBTree<int, std::less<int>, PoolAllocator<int>> ta;
+    RBTree<int, std::less<int>, PoolAllocator<int>> tb(ta.get_allocator());
+    for (int i = 0; i < 10000; ++i) {
+      ta.insert(i * 2);
+      tb.insert(i * 3);
+    }
+    ta.union_with(std::move(tb));
+    ta.check();
+    for (int i = 0; i < 30000; ++i) {
+      assert((ta.find(i) != nullptr) == ((i % 2 == 0 && i < 20000) || i % 3 == 0));
+    }
+  }
+}
+
+void order_statistic_test() {
+  // 不开启增强时节点没有额外开销
+  static_assert(sizeof(RBTreeNode<int>) == 3 * sizeof(void*) + 2 * sizeof(int));
+  using OSTree = RBTree<int, std::less<int>, std::allocator<int>, OrderStatistic>;
+  OSTree rbtree;
+  std::set<int> s;
+  for (int i = 0; i < 20000; ++i) {
+    int temp = random_int() % 50000;
+    if (i % 3 == 0) {
+      assert(rbtree.remove(temp) == (s.erase(temp) == 1));
+    } else {
+      assert(rbtree.insert(temp) == s.insert(temp).second);
+    }
+    if (i % 1000 == 0) rbtree.check();
+  }
+  rbtree.check();
+  assert(rbtree.size() == s.size());
+  std::vector<int> nums(s.begin(), s.end());
+  for (size_t k = 0; k < nums.size(); ++k) {
+    assert(rbtree.select(k)->value == nums[k]);
+  }
+  assert(rbtree.select(nums.size()) == nullptr);
+  for (int i = 0; i < 1000; ++i) {
+    int lo = random_int() % 50000, hi = random_int() % 50000;
+    size_t rank = std::lower_bound(nums.begin(), nums.end(), lo) - nums.begin();
+    assert(rbtree.rank(lo) == rank);
+    size_t count = lo < hi ? std::lower_bound(nums.begin(), nums.end(), hi) -
+                                 std::lower_bound(nums.begin(), nums.end(), lo)
+                           : 0;
+    assert(rbtree.count_range(lo, hi) == count);
+  }
+
+  // 有序构建、split/join 与集合运算之后子树大小仍然正确
+  OSTree built(sorted_unique, nums.begin(), nums.end());
+  built.check();
+  assert(built.size() == nums.size());
+  OSTree greater;
+  built.split(25000, greater);
+  built.check();
+  greater.check();
+  assert(built.size() == rbtree.rank(25000));
+  assert(greater.size() == nums.size() - rbtree.rank(25000));
+  built.join(greater);
+  built.check();
+  assert(built.size() == nums.size());
+  OSTree other;
+  for (int i = 0; i < 50000; i += 7) other.insert(i);
+  size_t other_size = other.size();
+  built.intersect_with(std::move(other));
+  built.check();
+  size_t expect = 0;
+  for (auto num : nums) expect += num % 7 == 0;
+  assert(built.size() == expect && other_size > expect);
+}
+
+template <class Layout>
+void interval_test() {
+  using Tree = IntervalTree<int, std::allocator<Interval<int>>, Layout>;
+  Tree tree;
+  std::set<Interval<int>> s;
+  auto random_interval = [] {
+    int start = random_int() % 20000;
+    return Interval<int>{start, start + 1 + random_int() % 500};
+  };
+  for (int i = 0; i < 20000; ++i) {
+    Interval<int> temp = random_interval();
+    if (i % 3 == 0) {
+      // 删除已有的区间，否则很少命中
+      auto it = s.lower_bound(temp);
+      if (it != s.end()) temp = *it;
+      assert(tree.remove(temp) == (s.erase(temp) == 1));
+    } else {
+      assert(tree.insert(temp) == s.insert(temp).second);
+    }
+    if (i % 1000 == 0) tree.check();
+  }
+  tree.check();
+
+  // 与逐个检查的结果对照，结果按 start 升序
+  auto check_query = [&](const Tree& tree, int lo, int hi) {
+    std::vector<Interval<int>> expect, found;
+    for (auto& x : s) {
+      if (lo < hi && x.start < hi && lo < x.end) expect.push_back(x);
+    }
+    tree.overlaps(lo, hi, [&](const Interval<int>& x) { found.push_back(x); });
+    assert(found == expect);
+    expect.clear();
+    found.clear();
+    for (auto& x : s) {
+      if (x.start <= lo && lo < x.end) expect.push_back(x);
+    }
+    tree.stab(lo, [&](const Interval<int>& x) { found.push_back(x); });
+    assert(found == expect);
+  };
+  for (int i = 0; i < 1000; ++i) {
+    int lo = random_int() % 21000, hi = lo + random_int() % 1000 - 100;
+    check_query(tree, lo, hi);
+  }
+  check_query(tree, INT_MIN, INT_MAX);
+
+  // 有序构建、split/join 之后子树的最大终点仍然正确
+  Tree built(sorted_unique, s.begin(), s.end());
+  built.check();
+  Tree greater;
+  built.split({10000, 0}, greater);
+  built.check();
+  greater.check();
+  int lo = 9900;
+  size_t left = 0;
+  built.overlaps(lo, lo + 200, [&](const Interval<int>&) { ++left; });
+  greater.overlaps(lo, lo + 200, [&](const Interval<int>&) { ++left; });
+  built.join(greater);
+  built.check();
+  size_t total = 0;
+  built.overlaps(lo, lo + 200, [&](const Interval<int>&) { ++total; });
+  assert(left == total);
+  check_query(built, lo, lo + 200);
+}
+
+// 按 key 排序的记录，按 key 查找
+struct Entry {
+  int key;
+  int bytes;
+};
+struct EntryLess {
+  using is_transparent = void;
+  bool operator()(const Entry& a, const Entry& b) const { return a.key < b.key; }
+  bool operator()(const Entry& a, int b) const { return a.key < b; }
+  bool operator()(int a, const Entry& b) const { return a < b.key; }
+};
+// bytes 的和、最小值、最大值
+struct BytesSummary {
+  struct value_type {
+    long long sum;
+    int min, max;
+    bool operator==(const value_type&) const = default;
+  };
+  static value_type identity() { return {0, INT_MAX, INT_MIN}; }
+  static value_type lift(const Entry& e) { return {e.bytes, e.bytes, e.bytes}; }
+  static value_type combine(const value_type& a, const value_type& b) {
+    return {a.sum + b.sum, std::min(a.min, b.min), std::max(a.max, b.max)};
+  }
+};
+// 不满足交换律：key 序列的多项式哈希，合并顺序错误时结果不同
+struct KeyHash {
+  struct value_type {
+    uint64_t hash, pow;
+    bool operator==(const value_type&) const = default;
+  };
+  static value_type identity() { return {0, 1}; }
+  static value_type lift(int key) { return {uint64_t(key), 1000003}; }
+  static value_type combine(const value_type& a, const value_type& b) {
+    return {a.hash * b.pow + b.hash, a.pow * b.pow};
+  }
+};
+
+void aggregate_test() {
+  using Tree =
+      RBTree<Entry, EntryLess, std::allocator<Entry>, Aggregate<BytesSummary>>;
+  Tree tree;
+  std::map<int, int> m;
+  for (int i = 0; i < 20000; ++i) {
+    int key = random_int() % 50000;
+    if (i % 3 == 0) {
+      assert(tree.remove(key) == (m.erase(key) == 1));
+    } else {
+      int bytes = random_int();
+      assert(tree.insert({key, bytes}) == m.emplace(key, bytes).second);
+    }
+    if (i % 1000 == 0) tree.check();
+  }
+  tree.check();
+  auto expect_reduce = [&](int lo, int hi) {
+    auto agg = BytesSummary::identity();
+    for (auto it = m.lower_bound(lo); lo < hi && it != m.lower_bound(hi); ++it) {
+      agg = BytesSummary::combine(agg, BytesSummary::lift({it->first, it->second}));
+    }
+    return agg;
+  };
+  for (int i = 0; i < 1000; ++i) {
+    int lo = random_int() % 50000, hi = random_int() % 50000;
+    assert(tree.reduce(lo, hi) == expect_reduce(lo, hi));
+  }
+  assert(tree.reduce() == expect_reduce(INT_MIN, INT_MAX));
+  assert(tree.reduce(0, 0) == BytesSummary::identity());
+
+  // 合并顺序：与按升序逐个合并的结果一致
+  using HashTree =
+      RBTree<int, std::less<int>, std::allocator<int>, Aggregate<KeyHash>>;
+  std::vector<int> keys;
+  for (auto& [key, bytes] : m) keys.push_back(key);
+  HashTree hashes(sorted_unique, keys.begin(), keys.end());
+  HashTree greater;
+  hashes.split(25000, greater);
+  hashes.join(greater);
+  hashes.check();
+  for (int i = 0; i < 1000; ++i) {
+    int lo = random_int() % 50000, hi = lo + random_int() % 5000;
+    auto expect = KeyHash::identity();
+    for (auto it = std::lower_bound(keys.begin(), keys.end(), lo);
+         it != keys.end() && *it < hi; ++it) {
+      expect = KeyHash::combine(expect, KeyHash::lift(*it));
+    }
+    assert(hashes.reduce(lo, hi) == expect);
+  }
+}
+
+void iterator_test() {
+  static_assert(std::bidirectional_iterator<RBTree<int>::const_iterator>);
+  RBTree<int> rbtree;
+  assert(rbtree.begin() == rbtree.end());
+  assert(rbtree.lower_bound(0) == rbtree.end());
+  std::set<int> s;
+  for (int i = 0; i < 20000; ++i) {
+    int temp = random_int() % 50000;
+    if (i % 3 == 0) {
+      rbtree.remove(temp);
+      s.erase(temp);
+    } else {
+      rbtree.insert(temp);
+      s.insert(temp);
+    }
+  }
+  assert(std::ranges::equal(rbtree, s));
+  assert(std::ranges::equal(std::views::reverse(rbtree), std::views::reverse(s)));
+  for (int i = 0; i < 1000; ++i) {
+    int temp = random_int() % 50002 - 1;
+    auto lower = rbtree.lower_bound(temp);
+    auto upper = rbtree.upper_bound(temp);
+    assert(lower == rbtree.end() ? s.lower_bound(temp) == s.end()
+                                 : *lower == *s.lower_bound(temp));
+    assert(upper == rbtree.end() ? s.upper_bound(temp) == s.end()
+                                 : *upper == *s.upper_bound(temp));
+    auto [first, last] = rbtree.equal_range(temp);
+    assert(first == lower && last == upper);
+    assert((lower != upper) == s.contains(temp));
+    // 区间扫描
+    auto it = s.lower_bound(temp);
+    for (auto num : std::ranges::subrange(lower, rbtree.end()) | std::views::take(100)) {
+      assert(num == *it++);
+    }
+  }
+}
+
+template <class Layout>
+void layout_test() {
+  using Tree =
+      RBTree<int, std::less<int>, std::allocator<int>, OrderStatistic, Layout>;
+  Tree rbtree;
+  std::set<int> s;
+  for (int i = 0; i < 30000; ++i) {
+    int temp = random_int() % 50000;
+    if (i % 3 == 0) {
+      assert(rbtree.remove(temp) == (s.erase(temp) == 1));
+    } else {
+      assert(rbtree.insert(temp) == s.insert(temp).second);
+    }
+    if (i % 1000 == 0) rbtree.check();
+  }
+  rbtree.check();
+  assert(rbtree.size() == s.size());
+  assert(std::ranges::equal(rbtree, s));
+  assert(std::ranges::equal(std::views::reverse(rbtree), std::views::reverse(s)));
+
+  Tree greater;
+  rbtree.split(25000, greater);
+  rbtree.check();
+  greater.check();
+  assert(greater.get_layout() == rbtree.get_layout());
+  assert(rbtree.size() + greater.size() == s.size());
+  rbtree.join(greater);
+  rbtree.check();
+
+  // 共享布局对象的树之间才能做集合运算
+  Tree other(rbtree.get_allocator(), rbtree.get_layout());
+  for (int i = 0; i < 50000; i += 7) {
+    other.insert(i);
+    s.insert(i);
+  }
+  rbtree.union_with(std::move(other));
+  rbtree.check();
+  assert(std::ranges::equal(rbtree, s));
+
+  Tree built(sorted_unique, s.begin(), s.end());
+  built.check();
+  assert(std::ranges::equal(built, s));
+}
+
+void node_layout_test() {
+  // int 节点：指针布局32字节，下标布局16字节
+  static_assert(sizeof(RBTree<int>::Node) == 32);
+  static_assert(sizeof(RBTree<int, std::less<int>, std::allocator<int>,
+                              NoAugment, IndexLayout>::Node) == 16);
+  // 8字节的值：颜色并入父指针后省去一个字的填充
+  static_assert(sizeof(RBTree<long, std::less<long>, std::allocator<long>,
+                              NoAugment, PackedLayout>::Node) ==
+                4 * sizeof(void*));
+  layout_test<PointerLayout>();
+  layout_test<PackedLayout>();
+  layout_test<IndexLayout>();
+
+  // 下标布局释放的节点会被复用，清空后整体归还
+  RBTree<int, std::less<int>, std::allocator<int>, NoAugment, IndexLayout> rbtree;
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 10000; ++i) rbtree.insert(i);
+    rbtree.check();
+    for (int i = 0; i < 10000; i += 2) rbtree.remove(i);
+    rbtree.check();
+    for (int i = 0; i < 10000; ++i) assert((rbtree.find(i) != nullptr) == (i % 2 == 1));
+    for (int i = 1; i < 10000; i += 2) rbtree.remove(i);
+    assert(rbtree.empty());
+  }
+  std::vector<int> nums(1000);
+  for (int i = 0; i < 1000; ++i) nums[i] = i;
+  rbtree.assign(sorted_unique, nums.begin(), nums.end());
+  rbtree.check();
+  assert(std::ranges::equal(rbtree, nums));
+}
+
+// 移动和交换只转移根，节点不变；clear 之后可以继续使用
+template <class Layout>
+void move_test() {
+  using Tree =
+      RBTree<int, std::less<int>, std::allocator<int>, OrderStatistic, Layout>;
+  std::vector<int> nums(5000);
+  for (int i = 0; i < 5000; ++i) nums[i] = i * 2;
+  Tree a(sorted_unique, nums.begin(), nums.end());
+  typename Tree::Node* node = a.find(100);
+  Tree b(std::move(a));
+  assert(a.empty() && a.begin() == a.end());
+  assert(b.find(100) == node && b.size() == nums.size());
+  b.check();
+  // 被移动的树仍可使用
+  a.insert(1);
+  a.insert(3);
+  a.check();
+
+  swap(a, b);
+  assert(a.find(100) == node && b.size() == 2);
+  a.check();
+  b.check();
+  b = std::move(a);
+  assert(a.empty() && b.find(100) == node);
+  assert(std::ranges::equal(b, nums));
+  b.check();
+
+  b.clear();
+  assert(b.empty() && b.begin() == b.end());
+  b.check();
+  for (int i = 0; i < 1000; ++i) b.insert(random_int());
+  b.check();
+}
+
+void move_clear_test() {
+  move_test<PointerLayout>();
+  move_test<PackedLayout>();
+  move_test<IndexLayout>();
+  // 值需要析构，由 ASan 检查没有泄漏
+  RBTree<std::string> strs;
+  for (int i = 0; i < 10000; ++i) {
+    strs.insert(std::string(20, 'a') + std::to_string(i % 2 ? i : random_int()));
+  }
+  RBTree<std::string> moved(std::move(strs));
+  strs = std::move(moved);
+  strs.clear();
+  assert(strs.empty());
+  PoolAllocator<int> alloc;
+  RBTree<int, std::less<int>, PoolAllocator<int>> pooled(alloc);
+  for (int i = 0; i < 10000; ++i) pooled.insert(i);
+  RBTree<int, std::less<int>, PoolAllocator<int>> other(alloc);
+  other = std::move(pooled);
+  assert(pooled.empty() && other.find(9999) != nullptr);
+}
+
+// 副本与原树形状、颜色、增强数据相同，之后互不影响
+template <class Layout>
+void copy_test(ThreadPool& pool) {
+  using Tree =
+      RBTree<int, std::less<int>, std::allocator<int>, OrderStatistic, Layout>;
+  std::set<int> s;
+  for (int i = 0; i < 200000; ++i) s.insert(random_int());
+  // 有序构建的树黑高约为 log2(n)，超过 kParallelBlackHeight，会并行复制
+  Tree a(sorted_unique, s.begin(), s.end());
+  for (int i = 0; i < 20000; ++i) {
+    int x = random_int();
+    if (i % 2) {
+      assert(a.remove(x) == (s.erase(x) == 1));
+    } else {
+      assert(a.insert(x) == s.insert(x).second);
+    }
+  }
+  Tree b(a, pool);
+  b.check();
+  assert(b.size() == a.size() && std::ranges::equal(a, b));
+  for (int x : {1, 1000, 500000, 999999}) assert(a.rank(x) == b.rank(x));
+  for (size_t k = 0; k < a.size(); k += 997) {
+    assert(a.select(k)->value == b.select(k)->value);
+  }
+  for (int i = 0; i < 1000; ++i) b.remove(random_int());
+  b.insert(0);
+  assert(std::ranges::equal(a, s));
+  a.check();
+
+  Tree c = b.clone(pool);
+  c.check();
+  assert(std::ranges::equal(b, c));
+  c = a;
+  c.check();
+  assert(std::ranges::equal(c, s));
+  c = Tree();
+  c = c;
+  assert(c.empty());
+}
+
+// 第 copies_left 次复制时抛出异常的值，可能在多个线程中复制
+struct ThrowingKey {
+  static inline std::atomic<int> copies_left = INT_MAX;
+  int value;
+
+  ThrowingKey(int v) : value(v) {}
+  ThrowingKey(const ThrowingKey& other) : value(other.value) {
+    if (copies_left.fetch_sub(1) == 0) throw std::runtime_error("copy");
+  }
+  auto operator<=>(const ThrowingKey&) const = default;
+};
+
+void deep_copy_test() {
+  ThreadPool pool(3);
+  copy_test<PointerLayout>(pool);
+  copy_test<PackedLayout>(pool);
+  copy_test<IndexLayout>(pool);
+
+  // 节点按先序申请并预先留出整棵树：即使池中有空闲链表和用了一部分的 slab，
+  // 副本的先序相邻节点也都紧挨着
+  using PoolTree = RBTree<int, std::less<int>, PoolAllocator<int>>;
+  PoolTree pooled;
+  for (int i = 0; i < 10000; ++i) pooled.insert(random_int() % 20000);
+  for (int i = 0; i < 1000; ++i) pooled.remove(random_int() % 20000);
+  pooled.insert(-1);
+  PoolTree copy(pooled);
+  std::vector<PoolTree::Node*> preorder;
+  auto walk = [&](auto&& self, PoolTree::Node* node) -> void {
+    if (node == nullptr) return;
+    preorder.push_back(node);
+    self(self, node->lchild);
+    self(self, node->rchild);
+  };
+  PoolTree::Node* root = copy.begin().node();
+  while (root->parent != nullptr) root = root->parent;
+  walk(walk, root);
+  size_t adjacent = 0;
+  for (size_t i = 1; i < preorder.size(); ++i) {
+    adjacent += preorder[i] == preorder[i - 1] + 1;
+  }
+  assert(preorder.size() == size_t(std::distance(pooled.begin(), pooled.end())));
+  assert(adjacent + 1 == preorder.size());
+
+  // 复制到一半时抛出异常，已复制的节点被释放（由 ASan 检查），原树不变
+  RBTree<ThrowingKey> keys;
+  for (int i = 0; i < 200000; ++i) keys.insert(i);
+  for (int copies : {0, 1000, 150000}) {
+    ThrowingKey::copies_left = copies;
+    bool thrown = false;
+    try {
+      RBTree<ThrowingKey> copy(keys, pool);
+    } catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    assert(thrown);
+  }
+  ThrowingKey::copies_left = INT_MAX;
+  keys.check();
+  RBTree<ThrowingKey> copied(keys);
+  assert(std::ranges::equal(keys, copied));
+}
+
+// 复制 pivot 时抛出异常，两棵树都不变
+void join_exception_test() {
+  RBTree<ThrowingKey> left, right;
+  for (int i = 0; i < 1000; ++i) left.insert(i);
+  for (int i = 1001; i < 2000; ++i) right.insert(i);
+  ThrowingKey::copies_left = 0;
+  bool thrown = false;
+  try {
+    left.join(ThrowingKey(1000), right);
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  ThrowingKey::copies_left = INT_MAX;
+  assert(thrown);
+  left.check();
+  right.check();
+  assert(std::distance(left.begin(), left.end()) == 1000);
+  assert(std::distance(right.begin(), right.end()) == 999);
+  left.join(ThrowingKey(1000), right);
+  left.check();
+  assert(right.empty() && std::distance(left.begin(), left.end()) == 2000);
+}
+
+// 统计构造次数的字符串键，用于确认查找时没有构造临时键
+struct CountedKey {
+  static inline int constructed = 0;
+  std::string str;
+
+  CountedKey(std::string_view s) : str(s) { ++constructed; }
+  CountedKey(const CountedKey& other) : str(other.str) { ++constructed; }
+  CountedKey(CountedKey&& other) noexcept = default;
+  CountedKey& operator=(const CountedKey&) = default;
+  CountedKey& operator=(CountedKey&&) noexcept = default;
+  auto operator<=>(const CountedKey&) const = default;
+  bool operator==(const CountedKey&) const = default;
+  auto operator<=>(std::string_view s) const { return str <=> s; }
+  bool operator==(std::string_view s) const { return str == s; }
+};
+
+struct PtrLess {
+  using is_transparent = void;
+  bool operator()(const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) const {
+    return *a < *b;
+  }
+  bool operator()(const std::unique_ptr<int>& a, int b) const { return *a < b; }
+  bool operator()(int a, const std::unique_ptr<int>& b) const { return a < *b; }
+};
+
+void key_type_test() {
+  // 字符串键：透明比较器下用 string_view 查找与删除，不构造临时键
+  RBTree<CountedKey, std::less<>> strings;
+  std::set<std::string> s;
+  for (int i = 0; i < 5000; ++i) {
+    std::string key = std::to_string(random_int() % 3000);
+    if (i % 3 == 0) {
+      assert(strings.remove(std::string_view(key)) == (s.erase(key) == 1));
+    } else {
+      assert(strings.emplace(std::string_view(key)) == s.insert(key).second);
+    }
+  }
+  strings.check();
+  int constructed = CountedKey::constructed;
+  for (int i = 0; i < 3000; ++i) {
+    std::string key = std::to_string(i);
+    auto node = strings.find(std::string_view(key));
+    assert((node != nullptr) == s.contains(key));
+    if (node != nullptr) assert(node->value == std::string_view(key));
+    auto lower = strings.lower_bound(std::string_view(key));
+    auto expect = s.lower_bound(key);
+    assert(lower == strings.end() ? expect == s.end() : lower->str == *expect);
+  }
+  assert(CountedKey::constructed == constructed);
+  // 已存在时 insert 不拷贝
+  if (!s.empty()) {
+    CountedKey key(*s.begin());
+    constructed = CountedKey::constructed;
+    assert(!strings.insert(key));
+    assert(CountedKey::constructed == constructed);
+  }
+
+  // 只能移动的键
+  RBTree<std::unique_ptr<int>, PtrLess> ptrs;
+  for (int i = 0; i < 1000; ++i) {
+    assert(ptrs.insert(std::make_unique<int>(i * 2)));
+    assert(ptrs.emplace(new int(i * 2 + 1)));
+  }
+  assert(!ptrs.insert(std::make_unique<int>(10)));
+  ptrs.check();
+  for (int i = 0; i < 2000; i += 3) assert(ptrs.remove(i));
+  ptrs.check();
+  for (int i = 0; i < 2000; ++i) {
+    assert((ptrs.find(i) != nullptr) == (i % 3 != 0));
+  }
+
+  // erase 通过重新链接节点完成，其它节点的地址和值都不变
+  RBTree<int> rbtree;
+  std::vector<std::pair<RBTree<int>::Node*, int>> nodes;
+  for (int i = 0; i < 2000; ++i) rbtree.insert(i);
+  for (int i = 0; i < 2000; ++i) nodes.emplace_back(rbtree.find(i), i);
+  for (int i = 0; i < 2000; i += 2) rbtree.erase(nodes[i].first);
+  rbtree.check();
+  for (int i = 1; i < 2000; i += 2) {
+    assert(rbtree.find(i) == nodes[i].first && nodes[i].first->value == i);
+  }
+}
+
+void hint_insert_test() {
+  // 升序追加：不带提示时与缓存的最大节点比较，带提示时直接挂在最大节点右侧
+  RBTree<int> rbtree, hinted;
+  for (int i = 0; i < 100000; ++i) {
+    assert(rbtree.insert(i));
+    auto it = hinted.insert(hinted.end(), i);
+    assert(*it == i && std::next(it) == hinted.end());
+  }
+  rbtree.check();
+  hinted.check();
+  assert(std::ranges::equal(rbtree, hinted));
+  for (int i = -1; i > -1000; --i) rbtree.insert(hinted.begin(), i);
+  rbtree.check();
+  assert(*rbtree.begin() == -999 && *--rbtree.end() == 99999);
+
+  // 任意提示：紧邻时走快速路径，否则退化为普通插入，结果都与 std::set 一致
+  using OSTree = RBTree<int, std::less<int>, std::allocator<int>, OrderStatistic>;
+  OSTree ostree;
+  std::set<int> s;
+  for (int i = 0; i < 20000; ++i) {
+    int temp = random_int() % 30000;
+    OSTree::const_iterator it;
+    switch (i % 4) {
+      case 0:
+        it = ostree.insert(ostree.lower_bound(temp), temp);
+        break;
+      case 1:
+        it = ostree.insert(ostree.begin(), temp);
+        break;
+      case 2:
+        it = ostree.emplace_hint(ostree.end(), temp);
+        break;
+      case 3:
+        ostree.remove(temp);
+        s.erase(temp);
+        continue;
+    }
+    s.insert(temp);
+    assert(*it == temp);
+    if (i % 1000 == 0) ostree.check();
+  }
+  ostree.check();
+  assert(std::ranges::equal(ostree, s) && ostree.size() == s.size());
+  // 已存在时返回已有元素
+  int first = *s.begin();
+  assert(ostree.insert(ostree.end(), first) == ostree.begin());
+  assert(ostree.size() == s.size());
+}
+
+void find_batch_test() {
+  RBTree<int> empty;
+  std::vector<int> keys{1, 2, 3};
+  bool found[1000];
+  empty.contains_batch(keys, found);
+  assert(!found[0] && !found[1] && !found[2]);
+
+  RBTree<int, std::less<int>, std::allocator<int>, NoAugment, IndexLayout> rbtree;
+  std::set<int> s;
+  for (int i = 0; i < 5000; ++i) {
+    int temp = random_int() % 10000;
+    rbtree.insert(temp);
+    s.insert(temp);
+  }
+  // 批的大小覆盖小于、等于和大于同时进行的查找个数，含重复的 key
+  std::vector<decltype(rbtree)::Node*> nodes(1000);
+  for (size_t n : {0, 1, 15, 16, 17, 1000}) {
+    keys.clear();
+    for (size_t i = 0; i < n; ++i) keys.push_back(random_int() % 10002 - 1);
+    rbtree.find_batch(keys, nodes);
+    rbtree.contains_batch(keys, found);
+    for (size_t i = 0; i < n; ++i) {
+      assert(nodes[i] == rbtree.find(keys[i]));
+      assert(found[i] == s.contains(keys[i]));
+    }
+  }
+
+  RBTree<std::string> strings;
+  for (int i = 0; i < 100; ++i) strings.insert(std::to_string(i));
+  std::vector<std::string> names{"7", "70", "700", "-1"};
+  strings.contains_batch(names, found);
+  assert(found[0] && found[1] && !found[2] && !found[3]);
+}
+
+void stats_test() {
+  using Tree = RBTree<int, std::less<int>, std::allocator<int>, NoAugment,
+                      PointerLayout, TreeStats>;
+  auto cases = [](const TreeStats& st) {
+    return std::vector<uint64_t>(std::begin(st.insert_cases),
+                                 std::end(st.insert_cases));
+  };
+  {
+    // 插入 3 时父亲、节点都是右孩子，RR 旋转一次
+    Tree s;
+    s.insert(1);
+    s.insert(2);
+    s.insert(3);
+    const TreeStats& st = s.stats();
+    assert(st.inserts == 3 && st.rotations == 1);
+    assert(cases(st) == std::vector<uint64_t>({0, 0, 0, 0, 1}));
+    assert(st.allocations == 3 && st.allocated_bytes == 3 * sizeof(Tree::Node));
+    s.reset_stats();
+    assert(s.find(2) != nullptr && s.find(0) == nullptr);
+    // 2 在根，命中时比较两次；0 经过 2 和 1，每个节点比较一次
+    assert(st.finds == 2 && st.depth[1] == 1 && st.depth[2] == 1);
+    assert(st.compares == 2 + 2);
+  }
+  {
+    Tree s;
+    std::set<int> expect;
+    for (int i = 0; i < 20000; ++i) {
+      int x = random_int();
+      if (i % 3 == 2) {
+        assert(s.remove(x) == (expect.erase(x) == 1));
+      } else {
+        assert(s.insert(x) == expect.insert(x).second);
+      }
+    }
+    const TreeStats& st = s.stats();
+    const uint64_t* ic = st.insert_cases;
+    const uint64_t* rc = st.remove_cases;
+    // 每次旋转都属于一种情形
+    assert(st.rotations == ic[1] + ic[2] + ic[3] + ic[4] + rc[0] + rc[2] + rc[3]);
+    // insert_fix 每轮恰好一种情形；remove_fix 的红兄弟与其后的情形同属一轮
+    assert(st.insert_fix_loops == ic[0] + ic[1] + ic[2] + ic[3] + ic[4]);
+    assert(st.remove_fix_loops == rc[1] + rc[3]);
+    assert(st.allocations - st.deallocations == expect.size());
+    assert(st.inserts - st.removes == expect.size());
+    uint64_t exported = 0;
+    st.for_each([&](const char* name, uint64_t value) {
+      if (std::string_view(name) == "rotations") exported = value;
+    });
+    assert(exported == st.rotations);
+    uint64_t finds = 0;
+    st.for_each_depth([&](int, uint64_t count) { finds += count; });
+    assert(finds == st.finds && st.mean_depth() > 1);
+
+    // 批量查找与逐个查找的比较次数和深度分布相同
+    std::vector<int> keys(3000);
+    for (int& key : keys) key = random_int();
+    s.reset_stats();
+    for (int key : keys) s.find(key);
+    TreeStats one_by_one = st;
+    s.reset_stats();
+    std::vector<Tree::Node*> out(keys.size());
+    s.find_batch(keys, out);
+    assert(st.finds == keys.size() && st.compares == one_by_one.compares);
+    assert(std::equal(std::begin(st.depth), std::end(st.depth),
+                      std::begin(one_by_one.depth)));
+  }
+}
+
 int main() {
   insert_test();
   remove_test();
   batch_test();
+  pool_allocator_test();
+  sorted_build_test();
+  split_join_test();
+  set_operation_test();
+  order_statistic_test();
+  interval_test<PointerLayout>();
+  interval_test<IndexLayout>();
+  aggregate_test();
+  iterator_test();
+  node_layout_test();
+  key_type_test();
+  hint_insert_test();
+  find_batch_test();
+  stats_test();
+  move_clear_test();
+  deep_copy_test();
+  join_exception_test();
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+
+#include "template/define.h"
+#include "template/epoch.h"
+#include "template/rbtree/rbtree.h"
+#include "template/rw_spin_lock.h"
+
+/*
+按 key 区间分片的线程安全有序集合：每个分片是一棵 RBTree，由各自的读写自旋锁保护，
+落在不同分片上的读写互不影响。
+
+  分片目录（各分片的下界和分片指针）只读，分裂时整体替换，旧目录经 EpochDomain 回收。
+  分片的下界在其生命周期内不变，上界只会在分裂时缩小：操作先按目录定位分片，
+  加锁后确认 key 仍小于该分片的上界，否则说明目录已过期，重新定位。
+  分片过大或等锁次数过多（变热）时，在中位数处一分为二，O(分片大小)，
+  期间只锁住这一个分片。分片只分裂不合并。
+
+  有序遍历逐个分片加读锁进行，每个分片内部是一致的，跨分片不是同一时刻的快照。
+*/
+template <class T, class Comparator = std::less<T>>
+  requires KeyComparator<Comparator, T>
+class ShardedRBTree {
+ public:
+  struct Config {
+    // 分片元素个数超过该值时分裂
+    size_t max_shard_size = size_t(1) << 14;
+    // 自上次分裂以来等锁次数达到该值时分裂
+    uint64_t split_contention = 4096;
+  };
+
+  struct ShardStats {
+    size_t size;
+    uint64_t contended;  // 加锁时需要等待的次数
+  };
+
+  ShardedRBTree() : ShardedRBTree(Config()) {}
+  explicit ShardedRBTree(Config config, const Comparator& comp = Comparator())
+      : ShardedRBTree({}, config, comp) {}
+  // 以严格升序的 bounds 为初始分界，共 bounds.size() + 1 个分片
+  ShardedRBTree(const std::vector<T>& bounds, Config config,
+                const Comparator& comp = Comparator());
+  ShardedRBTree(const ShardedRBTree&) = delete;
+  ShardedRBTree& operator=(const ShardedRBTree&) = delete;
+  // 要求此时没有并发的操作
+  ~ShardedRBTree();
+
+  bool insert(const T& val);
+  bool remove(const T& key);
+  bool contains(const T& key) const;
+  // 从第一个 >= lo 的值开始按升序对至多 count 个值调用 f，返回调用次数。
+  // f 执行期间持有当前分片的读锁，不能修改本集合
+  template <class F>
+  size_t scan(const T& lo, size_t count, F&& f) const {
+    return scan_from(&lo, count, f);
+  }
+  template <class F>
+  void for_each(F&& f) const {
+    scan_from(nullptr, SIZE_MAX, f);
+  }
+
+  // 各分片大小之和，O(分片数)
+  size_t size() const;
+  bool empty() const { return size() == 0; }
+  size_t shard_count() const;
+  // 按 key 顺序列出各分片的大小和等锁次数
+  auto shard_stats() const -> std::vector<ShardStats>;
+  // 在中位数处分裂第 index 个分片，元素少于两个时返回 false
+  bool split_shard(size_t index);
+
+  // for debug，要求此时没有并发的操作
+  void check() const;
+
+ private:
+  struct alignas(64) Shard {
+    mutable RWSpinLock lock;
+    RBTree<T, Comparator> tree;
+    std::optional<T> hi;  // 上界（不含），为空表示正无穷
+    std::atomic<size_t> size{0};
+    mutable std::atomic<uint64_t> contended{0};
+    uint64_t contended_at_split = 0;
+
+    explicit Shard(const Comparator& comp) : tree(comp) {}
+  };
+
+  struct Directory {
+    std::vector<T> bounds;  // bounds[i] 为 shards[i + 1] 的下界
+    std::vector<Shard*> shards;
+  };
+
+  auto route(const Directory& dir, const T& key) const -> size_t {
+    return std::upper_bound(dir.bounds.begin(), dir.bounds.end(), key, comp_) -
+           dir.bounds.begin();
+  }
+  bool covers(const Shard& shard, const T& key) const {
+    return !shard.hi || comp_(key, *shard.hi);
+  }
+  bool is_hot(const Shard& shard) const {
+    return shard.size.load(std::memory_order_relaxed) >
+               config_.max_shard_size ||
+           shard.contended.load(std::memory_order_relaxed) -
+                   shard.contended_at_split >=
+               config_.split_contention;
+  }
+
+  // 加锁，需要等待时计入分片的等锁次数
+  template <class Lock>
+  static auto lock_counted(const Shard& shard) -> Lock {
+    Lock lock(shard.lock, std::try_to_lock);
+    if (!lock.owns_lock()) {
+      shard.contended.fetch_add(1, std::memory_order_relaxed);
+      lock.lock();
+    }
+    return lock;
+  }
+  // 定位 key 所在的分片并加锁
+  template <class Lock>
+  auto lock_shard(const T& key) const -> std::pair<Shard*, Lock>;
+
+  template <class F>
+  size_t scan_from(const T* lo, size_t count, F& f) const;
+  // 持有 split_mutex_ 时调用。only_if_hot 为 true 时，加锁后确认分片仍然需要分裂
+  bool split(Shard* shard, bool only_if_hot);
+
+  std::atomic<Directory*> dir_;
+  Comparator comp_;
+  Config config_;
+  std::mutex split_mutex_;
+  mutable EpochDomain epoch_;
+};
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+ShardedRBTree<T, U>::ShardedRBTree(const std::vector<T>& bounds, Config config,
+                                   const U& comp)
+    : comp_(comp), config_(config) {
+  auto dir = new Directory{bounds, {}};
+  for (size_t i = 0; i <= bounds.size(); ++i) {
+    Shard* shard = new Shard(comp_);
+    if (i < bounds.size()) shard->hi = bounds[i];
+    dir->shards.push_back(shard);
+  }
+  dir_.store(dir, std::memory_order_release);
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+ShardedRBTree<T, U>::~ShardedRBTree() {
+  Directory* dir = dir_.load(std::memory_order_relaxed);
+  for (Shard* shard : dir->shards) delete shard;
+  delete dir;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+template <class Lock>
+auto ShardedRBTree<T, U>::lock_shard(const T& key) const
+    -> std::pair<Shard*, Lock> {
+  EpochDomain::Guard guard = epoch_.pin();
+  while (true) {
+    const Directory* dir = dir_.load(std::memory_order_acquire);
+    Shard* shard = dir->shards[route(*dir, key)];
+    Lock lock = lock_counted<Lock>(*shard);
+    if (covers(*shard, key)) return {shard, std::move(lock)};
+  }
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool ShardedRBTree<T, U>::insert(const T& val) {
+  auto [shard, lock] = lock_shard<std::unique_lock<RWSpinLock>>(val);
+  if (!shard->tree.insert(val)) return false;
+  shard->size.fetch_add(1, std::memory_order_relaxed);
+  bool hot = is_hot(*shard);
+  lock.unlock();
+  if (hot) {
+    // 已有线程在分裂时直接跳过，之后的插入会再次检查
+    std::unique_lock<std::mutex> split_lock(split_mutex_, std::try_to_lock);
+    if (split_lock.owns_lock()) split(shard, true);
+  }
+  return true;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool ShardedRBTree<T, U>::remove(const T& key) {
+  auto [shard, lock] = lock_shard<std::unique_lock<RWSpinLock>>(key);
+  if (!shard->tree.remove(key)) return false;
+  shard->size.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool ShardedRBTree<T, U>::contains(const T& key) const {
+  auto [shard, lock] = lock_shard<std::shared_lock<RWSpinLock>>(key);
+  return shard->tree.find(key) != nullptr;
+}
+
+// 读完一个分片后以它的上界为下一个分片的起点，每次都按最新的目录定位，
+// 遍历期间发生的分裂不会导致遗漏或重复
+template <class T, class U>
+  requires KeyComparator<U, T>
+template <class F>
+size_t ShardedRBTree<T, U>::scan_from(const T* lo, size_t count, F& f) const {
+  EpochDomain::Guard guard = epoch_.pin();
+  std::optional<T> cursor;
+  if (lo != nullptr) cursor = *lo;
+  size_t visited = 0;
+  while (visited < count) {
+    const Directory* dir = dir_.load(std::memory_order_acquire);
+    // 最左侧的分片分裂后仍保留左半部分，始终是 shards[0]
+    Shard* shard = dir->shards[cursor ? route(*dir, *cursor) : 0];
+    auto lock = lock_counted<std::shared_lock<RWSpinLock>>(*shard);
+    if (cursor && !covers(*shard, *cursor)) continue;
+    auto it = cursor ? shard->tree.lower_bound(*cursor) : shard->tree.begin();
+    for (; it != shard->tree.end() && visited < count; ++it, ++visited) f(*it);
+    if (!shard->hi) break;
+    cursor = *shard->hi;
+  }
+  return visited;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+size_t ShardedRBTree<T, U>::size() const {
+  EpochDomain::Guard guard = epoch_.pin();
+  size_t total = 0;
+  for (Shard* shard : dir_.load(std::memory_order_acquire)->shards) {
+    total += shard->size.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+size_t ShardedRBTree<T, U>::shard_count() const {
+  EpochDomain::Guard guard = epoch_.pin();
+  return dir_.load(std::memory_order_acquire)->shards.size();
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+auto ShardedRBTree<T, U>::shard_stats() const -> std::vector<ShardStats> {
+  EpochDomain::Guard guard = epoch_.pin();
+  std::vector<ShardStats> stats;
+  for (Shard* shard : dir_.load(std::memory_order_acquire)->shards) {
+    stats.push_back({shard->size.load(std::memory_order_relaxed),
+                     shard->contended.load(std::memory_order_relaxed)});
+  }
+  return stats;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool ShardedRBTree<T, U>::split_shard(size_t index) {
+  std::lock_guard<std::mutex> split_lock(split_mutex_);
+  // 目录只在持有 split_mutex_ 时替换，这里读到的就是最新的目录
+  Directory* dir = dir_.load(std::memory_order_relaxed);
+  if (index >= dir->shards.size()) return false;
+  return split(dir->shards[index], false);
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+bool ShardedRBTree<T, U>::split(Shard* shard, bool only_if_hot) {
+  std::unique_lock<RWSpinLock> lock(shard->lock);
+  size_t size = shard->size.load(std::memory_order_relaxed);
+  if ((only_if_hot && !is_hot(*shard)) || size < 2) return false;
+  T key = *std::next(shard->tree.begin(), size / 2);
+  Shard* right = new Shard(comp_);
+  shard->tree.split(key, right->tree);
+  right->hi = std::move(shard->hi);
+  shard->hi = key;
+  right->size.store(size - size / 2, std::memory_order_relaxed);
+  shard->size.store(size / 2, std::memory_order_relaxed);
+  shard->contended_at_split = shard->contended.load(std::memory_order_relaxed);
+
+  // 新分片完整之后再发布新目录；旧分片的上界在解锁前已经缩小
+  Directory* old = dir_.load(std::memory_order_relaxed);
+  auto dir = new Directory(*old);
+  size_t index =
+      std::find(dir->shards.begin(), dir->shards.end(), shard) -
+      dir->shards.begin();
+  dir->bounds.insert(dir->bounds.begin() + index, key);
+  dir->shards.insert(dir->shards.begin() + index + 1, right);
+  dir_.store(dir, std::memory_order_release);
+  epoch_.retire(old, [](void* p) { delete static_cast<Directory*>(p); });
+  epoch_.try_advance();
+  return true;
+}
+
+template <class T, class U>
+  requires KeyComparator<U, T>
+void ShardedRBTree<T, U>::check() const {
+  const Directory* dir = dir_.load(std::memory_order_acquire);
+  assert(dir->shards.size() == dir->bounds.size() + 1);
+  for (size_t i = 0; i < dir->shards.size(); ++i) {
+    const Shard* shard = dir->shards[i];
+    shard->tree.check();
+    assert(static_cast<size_t>(std::distance(shard->tree.begin(),
+                                             shard->tree.end())) ==
+           shard->size.load());
+    assert(shard->hi.has_value() == (i < dir->bounds.size()));
+    if (i < dir->bounds.size()) {
+      assert(!comp_(*shard->hi, dir->bounds[i]) &&
+             !comp_(dir->bounds[i], *shard->hi));
+    }
+    if (shard->tree.begin() == shard->tree.end()) continue;
+    if (i > 0) assert(!comp_(*shard->tree.begin(), dir->bounds[i - 1]));
+    if (shard->hi) assert(comp_(*std::prev(shard->tree.end()), *shard->hi));
+  }
+}
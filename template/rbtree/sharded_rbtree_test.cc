@@ -0,0 +1,107 @@
+#include "template/rbtree/sharded_rbtree.h"
+
+#include <cassert>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+std::random_device rd;
+std::mt19937 gen(rd());
+std::uniform_int_distribution<> dis(1, 1000000);
+int random_int() { return dis(gen); }
+
+using Config = ShardedRBTree<int>::Config;
+
+void basic_test() {
+  // 分片很小，插入过程中不断分裂
+  ShardedRBTree<int> tree(Config{.max_shard_size = 64});
+  std::set<int> expect;
+  for (int i = 0; i < 30000; ++i) {
+    int temp = random_int() % 10000;
+    if (i % 3 == 0) {
+      assert(tree.remove(temp) == (expect.erase(temp) == 1));
+    } else {
+      assert(tree.insert(temp) == expect.insert(temp).second);
+    }
+  }
+  tree.check();
+  assert(tree.size() == expect.size());
+  assert(tree.shard_count() > expect.size() / 64);
+  for (int i = 0; i < 10000; ++i) assert(tree.contains(i) == expect.count(i));
+
+  std::vector<int> all;
+  tree.for_each([&](int v) { all.push_back(v); });
+  assert(std::equal(all.begin(), all.end(), expect.begin(), expect.end()));
+  for (int i = 0; i < 100; ++i) {
+    int lo = random_int() % 10002 - 1;
+    std::vector<int> scanned;
+    tree.scan(lo, 200, [&](int v) { scanned.push_back(v); });
+    auto it = expect.lower_bound(lo);
+    size_t expect_count = std::min<size_t>(200, std::distance(it, expect.end()));
+    assert(scanned.size() == expect_count);
+    assert(std::equal(scanned.begin(), scanned.end(), it));
+  }
+}
+
+void split_test() {
+  // 初始分界，手动分裂，分片统计
+  ShardedRBTree<int> tree({100, 200}, Config{});
+  assert(tree.shard_count() == 3);
+  for (int i = 0; i < 300; ++i) tree.insert(i);
+  auto stats = tree.shard_stats();
+  assert(stats.size() == 3 && stats[0].size == 100 && stats[2].size == 100);
+  assert(tree.split_shard(1));
+  assert(!tree.split_shard(5));
+  stats = tree.shard_stats();
+  assert(stats.size() == 4 && stats[1].size == 50 && stats[2].size == 50);
+  tree.check();
+  for (int i = 0; i < 300; ++i) assert(tree.contains(i));
+
+  ShardedRBTree<int> empty;
+  assert(!empty.split_shard(0) && empty.empty());
+  empty.for_each([](int) { assert(false); });
+}
+
+// 多个线程各自修改互不相交的 key，同时扫描检查有序，过程中分片不断分裂
+void thread_test() {
+  constexpr int kThreads = 4;
+  ShardedRBTree<int> tree(Config{.max_shard_size = 256, .split_contention = 64});
+  std::vector<std::set<int>> expects(kThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 gen(t);
+      for (int i = 0; i < 40000; ++i) {
+        int key = gen() % 20000 * kThreads + t;
+        if (gen() % 3 == 0) {
+          assert(tree.remove(key) == (expects[t].erase(key) == 1));
+        } else {
+          assert(tree.insert(key) == expects[t].insert(key).second);
+        }
+        if (i % 1000 == 0) {
+          int prev = INT32_MIN;
+          tree.scan(gen() % 80000, 500, [&](int v) {
+            assert(v > prev);
+            prev = v;
+          });
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  tree.check();
+  std::set<int> expect;
+  for (auto& s : expects) expect.insert(s.begin(), s.end());
+  std::vector<int> all;
+  tree.for_each([&](int v) { all.push_back(v); });
+  assert(std::equal(all.begin(), all.end(), expect.begin(), expect.end()));
+  assert(tree.size() == expect.size() && tree.shard_count() > 1);
+}
+
+int main() {
+  basic_test();
+  split_test();
+  thread_test();
+  return 0;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// insert_fix 每一轮的情形：叔叔为红时变色上移；叔叔为黑时按父亲、节点各自是左(L)还是
+// 右(R)孩子旋转。LR/RL 旋转父亲后，下一轮必然是 LL/RR
+enum class InsertCase { kRecolor, kLL, kLR, kRL, kRR };
+// remove_fix 每一轮的情形：兄弟为红时先旋转父亲（之后兄弟为黑）；兄弟的孩子都为黑时变色上移；
+// 否则远侄子为黑时先旋转兄弟(kNearNephew)，再旋转父亲结束(kFarNephew)
+enum class RemoveCase { kRedSibling, kRecolor, kNearNephew, kFarNephew };
+
+/*
+统计策略 Stats：RBTree 在以下位置调用，启用统计时 const 的查找也会修改计数，不能再并发读
+  compare()                    查找路径上的一次 key 比较（find、插入位置、lower/upper_bound）
+  find(depth)                  一次 find 结束，depth 为经过的节点数
+  insert() / remove()          挂上、摘下一个节点
+  insert_fix_loop() / insert_case(InsertCase)
+  remove_fix_loop() / remove_case(RemoveCase)
+                               修复循环的一轮，以及这一轮的情形
+  rotate()                     一次旋转，含 join/split/集合运算中的
+  allocate(bytes) / deallocate(bytes)
+                               节点的申请与归还，整体释放（release）时不逐个计入
+kEnabled 为 false（NoStats）时树中的调用都不会实例化，生成的机器码与没有统计时相同。
+*/
+struct NoStats {
+  static constexpr bool kEnabled = false;
+  void compare() noexcept {}
+  void find(int) noexcept {}
+  void insert() noexcept {}
+  void remove() noexcept {}
+  void insert_fix_loop() noexcept {}
+  void insert_case(InsertCase) noexcept {}
+  void remove_fix_loop() noexcept {}
+  void remove_case(RemoveCase) noexcept {}
+  void rotate() noexcept {}
+  void allocate(size_t) noexcept {}
+  void deallocate(size_t) noexcept {}
+};
+
+struct TreeStats {
+  static constexpr bool kEnabled = true;
+  // 超过 kMaxDepth 的深度计入最后一格
+  static constexpr int kMaxDepth = 64;
+
+  uint64_t compares = 0;
+  uint64_t finds = 0;
+  uint64_t inserts = 0;
+  uint64_t removes = 0;
+  uint64_t insert_fix_loops = 0;
+  uint64_t insert_cases[5] = {};  // 按 InsertCase 下标
+  uint64_t remove_fix_loops = 0;
+  uint64_t remove_cases[4] = {};  // 按 RemoveCase 下标
+  uint64_t rotations = 0;
+  uint64_t allocations = 0;
+  uint64_t allocated_bytes = 0;
+  uint64_t deallocations = 0;
+  uint64_t deallocated_bytes = 0;
+  uint64_t depth[kMaxDepth + 1] = {};  // find 经过的节点数的分布
+
+  void compare() noexcept { ++compares; }
+  void find(int d) noexcept {
+    ++finds;
+    ++depth[d < kMaxDepth ? d : kMaxDepth];
+  }
+  void insert() noexcept { ++inserts; }
+  void remove() noexcept { ++removes; }
+  void insert_fix_loop() noexcept { ++insert_fix_loops; }
+  void insert_case(InsertCase c) noexcept { ++insert_cases[int(c)]; }
+  void remove_fix_loop() noexcept { ++remove_fix_loops; }
+  void remove_case(RemoveCase c) noexcept { ++remove_cases[int(c)]; }
+  void rotate() noexcept { ++rotations; }
+  void allocate(size_t bytes) noexcept {
+    ++allocations;
+    allocated_bytes += bytes;
+  }
+  void deallocate(size_t bytes) noexcept {
+    ++deallocations;
+    deallocated_bytes += bytes;
+  }
+
+  // 平均每次 find 的深度
+  double mean_depth() const noexcept {
+    uint64_t sum = 0;
+    for (int d = 0; d <= kMaxDepth; ++d) sum += depth[d] * d;
+    return finds == 0 ? 0 : double(sum) / finds;
+  }
+
+  // 导出：对每个计数器调用 f(const char* name, uint64_t value)
+  template <class F>
+  void for_each(F&& f) const {
+    static const char* const kInsertCases[] = {
+        "insert_recolor", "insert_ll", "insert_lr", "insert_rl", "insert_rr"};
+    static const char* const kRemoveCases[] = {
+        "remove_red_sibling", "remove_recolor", "remove_near_nephew",
+        "remove_far_nephew"};
+    f("compares", compares);
+    f("finds", finds);
+    f("inserts", inserts);
+    f("removes", removes);
+    f("insert_fix_loops", insert_fix_loops);
+    for (int i = 0; i < 5; ++i) f(kInsertCases[i], insert_cases[i]);
+    f("remove_fix_loops", remove_fix_loops);
+    for (int i = 0; i < 4; ++i) f(kRemoveCases[i], remove_cases[i]);
+    f("rotations", rotations);
+    f("allocations", allocations);
+    f("allocated_bytes", allocated_bytes);
+    f("deallocations", deallocations);
+    f("deallocated_bytes", deallocated_bytes);
+  }
+  // 对深度直方图中非0的格调用 f(int depth, uint64_t count)
+  template <class F>
+  void for_each_depth(F&& f) const {
+    for (int d = 0; d <= kMaxDepth; ++d) {
+      if (depth[d] != 0) f(d, depth[d]);
+    }
+  }
+};
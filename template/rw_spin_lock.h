@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// 读写自旋锁：一个 32 位原子变量，最高位为写者，其余位为读者个数。
+// 写者先占住写者位阻止新的读者进入，再等待已有读者离开，读者多时写者不会饿死。
+// 临界区应当很短；等待时让出 CPU，持锁线程被换出时不会空转整个时间片。
+// 满足 Lockable 和 SharedLockable，可以配合 std::unique_lock / std::shared_lock 使用
+class RWSpinLock {
+ public:
+  RWSpinLock() = default;
+  RWSpinLock(const RWSpinLock&) = delete;
+  RWSpinLock& operator=(const RWSpinLock&) = delete;
+
+  bool try_lock() noexcept {
+    uint32_t expected = 0;
+    return state_.compare_exchange_strong(expected, kWriter,
+                                          std::memory_order_acquire);
+  }
+  void lock() noexcept {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while (true) {
+      if ((state & kWriter) == 0 &&
+          state_.compare_exchange_weak(state, state | kWriter,
+                                       std::memory_order_acquire)) {
+        break;
+      }
+      if (state & kWriter) {
+        std::this_thread::yield();
+        state = state_.load(std::memory_order_relaxed);
+      }
+    }
+    while (state_.load(std::memory_order_acquire) != kWriter) {
+      std::this_thread::yield();
+    }
+  }
+  void unlock() noexcept { state_.store(0, std::memory_order_release); }
+
+  bool try_lock_shared() noexcept {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while ((state & kWriter) == 0) {
+      if (state_.compare_exchange_weak(state, state + 1,
+                                       std::memory_order_acquire)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  void lock_shared() noexcept {
+    while (!try_lock_shared()) std::this_thread::yield();
+  }
+  void unlock_shared() noexcept {
+    state_.fetch_sub(1, std::memory_order_release);
+  }
+
+ private:
+  static constexpr uint32_t kWriter = uint32_t(1) << 31;
+  std::atomic<uint32_t> state_{0};
+};
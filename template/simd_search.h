@@ -0,0 +1,122 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// 32/64 位的有符号、无符号整数与 float/double 配合 std::less 时，可以按 SIMD 整段比较
+template <class T, class Comparator>
+concept SimdSearchable =
+    (std::same_as<T, int32_t> || std::same_as<T, uint32_t> ||
+     std::same_as<T, int64_t> || std::same_as<T, uint64_t> ||
+     std::same_as<T, float> || std::same_as<T, double>) &&
+    (std::same_as<Comparator, std::less<T>> ||
+     std::same_as<Comparator, std::less<>>);
+
+namespace simd_detail {
+
+#if defined(__AVX2__)
+// p[0..lanes) < x 的比较结果，每个通道为 -1 或 0。无符号数翻转最高位后按有符号比较
+template <class T>
+__m256i less_mask(const T* p, const T& x) {
+  auto v = reinterpret_cast<const __m256i*>(p);
+  if constexpr (std::same_as<T, float>) {
+    return _mm256_castps_si256(
+        _mm256_cmp_ps(_mm256_loadu_ps(p), _mm256_set1_ps(x), _CMP_LT_OQ));
+  } else if constexpr (std::same_as<T, double>) {
+    return _mm256_castpd_si256(
+        _mm256_cmp_pd(_mm256_loadu_pd(p), _mm256_set1_pd(x), _CMP_LT_OQ));
+  } else if constexpr (sizeof(T) == 4) {
+    __m256i flip = _mm256_set1_epi32(std::is_signed_v<T> ? 0 : INT32_MIN);
+    return _mm256_cmpgt_epi32(
+        _mm256_xor_si256(_mm256_set1_epi32(x), flip),
+        _mm256_xor_si256(_mm256_loadu_si256(v), flip));
+  } else {
+    __m256i flip = _mm256_set1_epi64x(std::is_signed_v<T> ? 0 : INT64_MIN);
+    return _mm256_cmpgt_epi64(
+        _mm256_xor_si256(_mm256_set1_epi64x(x), flip),
+        _mm256_xor_si256(_mm256_loadu_si256(v), flip));
+  }
+}
+#elif defined(__SSE2__)
+// 64 位整数的比较需要 SSE4.2，否则只走标量
+template <class T>
+constexpr bool kVectorizable =
+#if defined(__SSE4_2__)
+    true;
+#else
+    sizeof(T) == 4 || std::floating_point<T>;
+#endif
+
+template <class T>
+__m128i less_mask(const T* p, const T& x) {
+  auto v = reinterpret_cast<const __m128i*>(p);
+  if constexpr (std::same_as<T, float>) {
+    return _mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(p), _mm_set1_ps(x)));
+  } else if constexpr (std::same_as<T, double>) {
+    return _mm_castpd_si128(_mm_cmplt_pd(_mm_loadu_pd(p), _mm_set1_pd(x)));
+  } else if constexpr (sizeof(T) == 4) {
+    __m128i flip = _mm_set1_epi32(std::is_signed_v<T> ? 0 : INT32_MIN);
+    return _mm_cmplt_epi32(_mm_xor_si128(_mm_loadu_si128(v), flip),
+                           _mm_xor_si128(_mm_set1_epi32(x), flip));
+  } else {
+#if defined(__SSE4_2__)
+    __m128i flip = _mm_set1_epi64x(std::is_signed_v<T> ? 0 : INT64_MIN);
+    return _mm_cmpgt_epi64(_mm_xor_si128(_mm_set1_epi64x(x), flip),
+                           _mm_xor_si128(_mm_loadu_si128(v), flip));
+#else
+    return _mm_setzero_si128();
+#endif
+  }
+}
+#endif
+
+}  // namespace simd_detail
+
+// 有序数组 [first, first + n) 中小于 x 的元素个数，即 lower_bound 的下标。
+// 不提前退出、没有分支：每 32 字节（SSE2 为 16 字节）的元素一次比较，比较结果
+// （-1 或 0）按通道累加在向量寄存器中，最后求一次水平和；不足一组的尾部逐个比较。
+// 只读取 n 个元素以内的内存。没有 SSE4.2 时 64 位整数只走标量
+template <class T, class Comparator>
+  requires SimdSearchable<T, Comparator>
+size_t simd_count_less(const T* first, size_t n, const T& x) {
+  constexpr bool kWide = sizeof(T) == 8;
+  size_t i = 0;
+  size_t count = 0;
+#if defined(__AVX2__)
+  constexpr size_t kLanes = 32 / sizeof(T);
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + kLanes <= n; i += kLanes) {
+    __m256i lt = simd_detail::less_mask(first + i, x);
+    acc = kWide ? _mm256_sub_epi64(acc, lt) : _mm256_sub_epi32(acc, lt);
+  }
+  __m128i lo = _mm256_castsi256_si128(acc), hi = _mm256_extracti128_si256(acc, 1);
+  __m128i sum = kWide ? _mm_add_epi64(lo, hi) : _mm_add_epi32(lo, hi);
+#elif defined(__SSE2__)
+  constexpr size_t kLanes = 16 / sizeof(T);
+  __m128i sum = _mm_setzero_si128();
+  if constexpr (simd_detail::kVectorizable<T>) {
+    for (; i + kLanes <= n; i += kLanes) {
+      __m128i lt = simd_detail::less_mask(first + i, x);
+      sum = kWide ? _mm_sub_epi64(sum, lt) : _mm_sub_epi32(sum, lt);
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  if constexpr (kWide) {
+    sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+  } else {
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  }
+  count = static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+#endif
+  for (const T* p = first + i; p != first + n; ++p) count += *p < x;
+  return count;
+}
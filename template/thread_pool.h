@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// fork-join 线程池：invoke(a, b) 把 a 放入队列，当前线程执行 b。
+// 执行完 b 后如果 a 还没有被工作线程取走，就由当前线程自己执行；
+// 否则一边帮忙执行队列中的其它任务，一边等待 a 完成。
+// 等待的任务一定已经在某个线程上运行，所以嵌套调用 invoke 不会死锁。
+class ThreadPool {
+ public:
+  // workers 为工作线程数，不含调用 invoke 的线程；为0时 invoke 退化为顺序执行
+  explicit ThreadPool(unsigned workers) {
+    for (unsigned i = 0; i < workers; ++i) {
+      workers_.emplace_back([this] { worker_loop(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) worker.join();
+  }
+
+  unsigned size() const noexcept { return workers_.size(); }
+
+  template <class A, class B>
+  void invoke(A&& a, B&& b) {
+    if (workers_.empty()) {
+      a();
+      b();
+      return;
+    }
+    Task task{[](void* f) { (*static_cast<std::remove_cvref_t<A>*>(f))(); },
+              const_cast<std::remove_cvref_t<A>*>(&a)};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(&task);
+    }
+    cv_.notify_one();
+    b();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = std::find(queue_.rbegin(), queue_.rend(), &task);
+    if (it != queue_.rend()) {
+      queue_.erase(std::next(it).base());
+      lock.unlock();
+      a();
+      return;
+    }
+    while (!task.done) {
+      if (!run_one(lock)) done_cv_.wait(lock);
+    }
+  }
+
+  // 进程内共享的线程池，工作线程数为 hardware_concurrency() - 1
+  static ThreadPool& shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) -
+                           1);
+    return pool;
+  }
+
+ private:
+  struct Task {
+    void (*call)(void*);
+    void* arg;
+    bool done = false;
+  };
+
+  // 持有锁时调用，取出最早入队的任务执行，队列为空时返回false
+  bool run_one(std::unique_lock<std::mutex>& lock) {
+    if (queue_.empty()) return false;
+    Task* task = queue_.front();
+    queue_.pop_front();
+    lock.unlock();
+    task->call(task->arg);
+    lock.lock();
+    task->done = true;
+    done_cv_.notify_all();
+    return true;
+  }
+
+  void worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) return;
+      run_one(lock);
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;       // 通知工作线程有新任务
+  std::condition_variable done_cv_;  // 通知等待者有任务完成
+  std::deque<Task*> queue_;
+  std::vector<std::thread> workers_;
+  bool stop_ = false;
+};
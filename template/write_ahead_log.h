@@ -0,0 +1,240 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+追加写的操作日志，记录为任意字节串，组提交（group commit）：
+  append() 只把记录追加到内存缓冲区；缓冲区中积累 group_ops 条记录，或最早的一条
+  已等待 group_interval 时，把整组一次 write 并 fdatasync，多条记录分摊一次落盘。
+  append() 返回时记录不一定已落盘，崩溃时至多丢失最近一组；sync() 返回后此前的记录均已落盘。
+文件由若干组构成，每组为 GroupHeader 加 count 条定长记录，校验和覆盖整组记录。
+读取时遇到不完整或校验失败的组即停止，并截掉文件的剩余部分（崩溃时写了一半的组）。
+append/sync 可以在多个线程中调用；写盘期间其它线程可以继续追加到新的缓冲区。
+write 或 fdatasync 失败后截掉这一组已写入的部分，日志不再可用：之后的 append/sync
+都抛出同一个错误，sync() 不会在它等待的组失败时正常返回。
+*/
+class WriteAheadLog {
+ public:
+  struct Options {
+    size_t group_ops = 256;
+    // 为0时不按时间提交，只按条数或 sync()
+    std::chrono::microseconds group_interval{1000};
+  };
+
+  // 打开（不存在时创建）path，记录长度固定为 record_bytes
+  WriteAheadLog(const std::string& path, size_t record_bytes, Options options)
+      : record_bytes_(record_bytes), options_(options) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) throw_errno("open");
+    if (options_.group_interval.count() > 0) {
+      flusher_ = std::thread([this] { flush_loop(); });
+    }
+  }
+  WriteAheadLog(const WriteAheadLog&) = delete;
+  WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+  // 提交缓冲区中剩余的记录，失败时丢弃
+  ~WriteAheadLog() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stop_ = true;
+      try {
+        commit(lock);
+      } catch (...) {
+      }
+    }
+    cv_.notify_all();
+    if (flusher_.joinable()) flusher_.join();
+    ::close(fd_);
+  }
+
+  // 按写入顺序对文件中每条完整的记录调用 f(const char* record)，返回记录条数。
+  // 只能在 append 之前调用
+  template <class F>
+  size_t replay(F&& f) {
+    std::vector<char> data;
+    char buf[1 << 16];
+    ssize_t n;
+    while ((n = ::pread(fd_, buf, sizeof(buf), data.size())) > 0) {
+      data.insert(data.end(), buf, buf + n);
+    }
+    if (n < 0) throw_errno("pread");
+    size_t offset = 0, records = 0;
+    while (offset + sizeof(GroupHeader) <= data.size()) {
+      GroupHeader header;
+      std::memcpy(&header, data.data() + offset, sizeof(header));
+      size_t bytes = size_t(header.count) * record_bytes_;
+      const char* first = data.data() + offset + sizeof(header);
+      if (header.magic != kGroupMagic ||
+          offset + sizeof(header) + bytes > data.size() ||
+          header.checksum != checksum(first, bytes)) {
+        break;
+      }
+      for (size_t i = 0; i < header.count; ++i) f(first + i * record_bytes_);
+      records += header.count;
+      offset += sizeof(header) + bytes;
+    }
+    if (offset != data.size()) truncate(offset);
+    return records;
+  }
+
+  void append(const void* record) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    rethrow();
+    if (pending_ == 0 && options_.group_interval.count() > 0) {
+      first_pending_ = Clock::now();
+      cv_.notify_all();
+    }
+    auto p = static_cast<const char*>(record);
+    buffer_.insert(buffer_.end(), p, p + record_bytes_);
+    if (++pending_ >= options_.group_ops) commit(lock);
+  }
+
+  // 提交缓冲区中的全部记录并等待落盘
+  void sync() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    rethrow();
+    commit(lock);
+  }
+
+  // 丢弃全部记录（检查点之后），调用前应先 sync()
+  void reset() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !writing_; });
+    buffer_.clear();
+    pending_ = 0;
+    truncate(0);
+  }
+
+  // 已落盘的组数，即 fdatasync 的次数
+  uint64_t groups() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return groups_;
+  }
+
+  // FNV-1a，hash 为之前部分的结果时可以分段计算
+  static uint64_t checksum(const char* data, size_t n,
+                           uint64_t hash = 14695981039346656037ull) noexcept {
+    for (size_t i = 0; i < n; ++i) {
+      hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    }
+    return hash;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  static constexpr uint32_t kGroupMagic = 0x57414c47;  // "WALG"
+
+  struct GroupHeader {
+    uint32_t magic;
+    uint32_t count;
+    uint64_t checksum;
+  };
+
+  [[noreturn]] static void throw_errno(const char* what) {
+    throw std::system_error(errno, std::generic_category(),
+                            std::string("WriteAheadLog: ") + what);
+  }
+
+  void truncate(size_t bytes) {
+    if (::ftruncate(fd_, bytes) != 0) throw_errno("ftruncate");
+    if (::fdatasync(fd_) != 0) throw_errno("fdatasync");
+  }
+
+  // 写盘失败后每次 append/sync 都抛出该错误
+  void rethrow() {
+    if (error_) std::rethrow_exception(error_);
+  }
+
+  // 把缓冲区作为一组写入并落盘。同一时间只有一个线程写文件，
+  // 写盘时释放锁，返回时调用前缓冲区中的记录均已落盘
+  void commit(std::unique_lock<std::mutex>& lock) {
+    cv_.wait(lock, [this] { return !writing_; });
+    // 等待的可能正是包含调用者记录的组
+    rethrow();
+    if (pending_ == 0) return;
+    GroupHeader header{kGroupMagic, static_cast<uint32_t>(pending_),
+                       checksum(buffer_.data(), buffer_.size())};
+    std::vector<char> group(sizeof(header));
+    std::memcpy(group.data(), &header, sizeof(header));
+    group.insert(group.end(), buffer_.begin(), buffer_.end());
+    buffer_.clear();
+    pending_ = 0;
+    writing_ = true;
+    lock.unlock();
+    std::exception_ptr error;
+    // 只有持有 writing_ 的线程写文件，当前大小即这一组的起点
+    off_t offset = ::lseek(fd_, 0, SEEK_END);
+    for (size_t written = 0; written < group.size();) {
+      ssize_t n = ::write(fd_, group.data() + written, group.size() - written);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) {
+        error = std::make_exception_ptr(std::system_error(
+            errno, std::generic_category(), "WriteAheadLog: write"));
+        break;
+      }
+      written += n;
+    }
+    if (!error && ::fdatasync(fd_) != 0) {
+      error = std::make_exception_ptr(std::system_error(
+          errno, std::generic_category(), "WriteAheadLog: fdatasync"));
+    }
+    // 截掉写了一半的组，否则之后的组接在它后面，replay 时会随它一起被丢弃
+    if (error && offset >= 0) (void)::ftruncate(fd_, offset);
+    lock.lock();
+    writing_ = false;
+    groups_ += !error;
+    if (error) error_ = error;
+    cv_.notify_all();
+    rethrow();
+  }
+
+  // 定时提交等待超过 group_interval 的记录
+  void flush_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+      if (pending_ == 0 || writing_ || error_) {
+        cv_.wait(lock);
+        continue;
+      }
+      auto deadline = first_pending_ + options_.group_interval;
+      if (Clock::now() < deadline) {
+        cv_.wait_until(lock, deadline);
+        continue;
+      }
+      try {
+        commit(lock);
+      } catch (...) {
+        // 错误已记入 error_
+      }
+    }
+  }
+
+  int fd_ = -1;
+  size_t record_bytes_;
+  Options options_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<char> buffer_;
+  size_t pending_ = 0;
+  Clock::time_point first_pending_;
+  bool writing_ = false;
+  bool stop_ = false;
+  uint64_t groups_ = 0;
+  std::exception_ptr error_;
+  std::thread flusher_;
+};